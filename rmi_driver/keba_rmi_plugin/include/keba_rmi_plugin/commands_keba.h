@@ -49,6 +49,10 @@
  * ptp joints : 1 2 3 4 5 6; dyn : 1 2 3 4 5 6 7 8 9;
  * get version;
  *
+ * The controller answers "get version;" with its version.  If it can use the binary wire format (see
+ * rmi_driver::wire) it adds "binary", like "0.0.9 binary".  "wire : binary;" switches the socket it's sent on to
+ * binary frames after the controller answers it.
+ *
  */
 
 using namespace rmi_driver;
@@ -221,6 +225,12 @@ public:
     handler_name_ = "Keba JTA";
   }
 
+  /// Only processLastJtaPoint() is overridden
+  bool usesPointHooks() const override
+  {
+    return true;
+  }
+
   /**
    * \brief Add a WaitIsFinished to the end of the trajectory.
    *
@@ -253,6 +263,18 @@ public:
     return version;
   }
 
+  /**
+   * \brief Use binary frames if the connection's wire_format is binary and the controller reports "binary" after its
+   * version.
+   */
+  wire::Format negotiateWireFormat(const std::string &version_response) const override;
+
+  /// "wire : binary;" or "wire : text;"
+  RobotCommandPtr makeWireFormatCommand(wire::Format format) const override;
+
+  /// "subscribe status : <rate>;"
+  RobotCommandPtr makeStatusStreamCommand(double rate) const override;
+
   /// vector of joint names.  @todo move it to CommandRegister?  Could there ever be a robot where they don't want to
   /// specify joint names?
   std::vector<std::string> joint_names_;
@@ -294,7 +316,7 @@ protected:
 };
 
 /**
- * \brief Special command handler used by Connector::getThread()
+ * \brief Special command handler used by the Connector Get loop
  *
  * \details This handler implements the standard gets.  @todo define these!\n
  * \par Required:
@@ -344,6 +366,15 @@ class KebaCommandGetToolFrame : public KebaCommandHandler
      * @param response Modified string
      */
     void processResponse(std::string &response) const override;
+
+    /// Binary version.  1 group with the tool frame
+    void processResponse(wire::FloatGroups &groups) const override;
+
+    /// Both processResponse() versions do the same conversion
+    bool hasNumericConversion() const override
+    {
+      return true;
+    }
   };
 
 public:
@@ -366,7 +397,11 @@ class KebaCommandGetStatus : public KebaCommandHandler
      */
     void processResponse(std::string &response) const override;
 
-    void updateData(std::string &response) override;
+    /// Binary version.  Changes the tcp frame's rotation.  See RobotCommandStatus for the groups.
+    void processResponse(wire::FloatGroups &groups) const override;
+
+    /// Parse the groups and change the tcp frame's rotation.  @return false if the response couldn't be parsed
+    bool updateData(const std::string &response) override;
   };
 
 public:
@@ -80,6 +80,29 @@ double radToDeg(double rad);
  */
 bool processKebaAux(const robot_movement_interface::Command &cmd_msg, RobotCommand &telnet_cmd);
 
+/**
+ * \brief Change a Keba tool frame's ZYZ' rotation into ZYX
+ *
+ * @param frame [in,out] x y z rotZ rotY rotZ'
+ * @return false if it doesn't have 6 values
+ */
+bool convertToolFrame(std::vector<double> &frame);
+
+/**
+ * \brief Change a Keba tool frame's ZYZ' rotation into ZYX in place.  Used on the Get hot path.
+ *
+ * @param frame [in,out] x y z rotZ rotY rotZ'
+ * @param size Number of values in frame
+ * @return false if size != 6
+ */
+bool convertToolFrame(double *frame, std::size_t size);
+
+/**
+ * \brief Text version of convertToolFrame() for compatibility.  Parses the frame, converts it and formats it again.
+ *
+ * @param response "x y z rotZ rotY rotZ'"
+ * @return "x y z rotZ rotY rotX" with 4 decimals, or "error"
+ */
 std::string convertToolFrameStr(const std::string &response);
 
 // bool processKebaPose(const robot_movement_interface::Command &cmd_msg, std::string &pose_value_str);
@@ -53,12 +53,45 @@ void KebaCommandRegister::initialize(const std::vector<std::string> &joints)
   registerCommandHandlers();
 }
 
+wire::Format KebaCommandRegister::negotiateWireFormat(const std::string &version_response) const
+{
+  if (getRequestedWireFormat() != wire::Format::Binary)
+    return wire::Format::Text;
+
+  // Controllers that support it add "binary" after the version
+  std::vector<std::string> tokens;
+  boost::split(tokens, version_response, boost::is_any_of(" "), boost::token_compress_on);
+  for (auto &&token : tokens)
+  {
+    if (boost::iequals(token, "binary"))
+      return wire::Format::Binary;
+  }
+
+  ROS_WARN_STREAM("Binary wire format was requested but the controller doesn't support it.  Version: "
+                  << version_response);
+  return wire::Format::Text;
+}
+
+RobotCommandPtr KebaCommandRegister::makeWireFormatCommand(wire::Format format) const
+{
+  RobotCommandPtr cmd_ptr = makeRobotCommand<KebaCommand>(RobotCommand::CommandType::Get);
+  cmd_ptr->setCommand("wire", format == wire::Format::Binary ? "binary" : "text");
+  return cmd_ptr;
+}
+
+RobotCommandPtr KebaCommandRegister::makeStatusStreamCommand(double rate) const
+{
+  RobotCommandPtr cmd_ptr = makeRobotCommand<KebaCommand>(RobotCommand::CommandType::Get);
+  cmd_ptr->setCommand("subscribe status", std::vector<float>{ static_cast<float>(rate) });
+  return cmd_ptr;
+}
+
 void KebaCommandRegister::registerCommandHandlers()
 {
   if (commands_registered_)
     return;
 
-  // Add the required Connector::getThread handler
+  // Add the required Connector Get loop handler
   this->addHandler<KebaCommandGet>();
   this->addHandler<KebaCommandGetToolFrame>();
   this->addHandler<KebaCommandGetStatus>();
@@ -81,7 +114,7 @@ void KebaCommandRegister::registerCommandHandlers()
   cmd.command_type = "TEST";
 
   auto chtest = CommandHandler::createHandler(cmd, [](const robot_movement_interface::Command &cmd_msg) {
-    return std::make_shared<RobotCommand>(RobotCommand::CommandType::Cmd, cmd_msg.command_type, cmd_msg.pose_type);
+    return makeRobotCommand<RobotCommand>(RobotCommand::CommandType::Cmd, cmd_msg.command_type, cmd_msg.pose_type);
   });
 
   this->addHandler(std::move(chtest));
@@ -106,7 +139,7 @@ KebaCommandGet::KebaCommandGet()
 RobotCommandPtr KebaCommandGet::processMsg(const robot_movement_interface::Command &cmd_msg) const
 {
   std::string cmd_str = "get ";
-  RobotCommandPtr cmd_ptr = std::make_shared<KebaCommand>(RobotCommand::RobotCommand::CommandType::Get);
+  RobotCommandPtr cmd_ptr = makeRobotCommand<KebaCommand>(RobotCommand::RobotCommand::CommandType::Get);
   if (boost::iequals("JOINT_POSITION", cmd_msg.pose_type))
     cmd_str += "joint position";
   else if (boost::iequals("TOOL_FRAME", cmd_msg.pose_type))
@@ -141,11 +174,17 @@ void KebaCommandGetToolFrame::KebaCommandToolFrame::processResponse(std::string
   response = convertToolFrameStr(response);
 }
 
+void KebaCommandGetToolFrame::KebaCommandToolFrame::processResponse(wire::FloatGroups &groups) const
+{
+  if (groups.size() != 1 || !convertToolFrame(groups[0]))
+    groups.clear();
+}
+
 RobotCommandPtr KebaCommandGetToolFrame::processMsg(const robot_movement_interface::Command &cmd_msg) const
 {
   std::string cmd_str = "get tool frame ros";
   RobotCommandPtr cmd_ptr =
-      std::make_shared<KebaCommandGetToolFrame::KebaCommandToolFrame>(RobotCommand::RobotCommand::CommandType::Get);
+      makeRobotCommand<KebaCommandGetToolFrame::KebaCommandToolFrame>(RobotCommand::RobotCommand::CommandType::Get);
 
   cmd_ptr->setCommand(cmd_str, "");
   return cmd_ptr;
@@ -171,7 +210,7 @@ RobotCommandPtr KebaCommandGetStatus::processMsg(const robot_movement_interface:
 {
   std::string cmd_str = "get status";
   RobotCommandPtr cmd_ptr =
-      std::make_shared<KebaCommandGetStatus::KebaCommandStatus>(RobotCommand::RobotCommand::CommandType::Get);
+      makeRobotCommand<KebaCommandGetStatus::KebaCommandStatus>(RobotCommand::RobotCommand::CommandType::Get);
 
   cmd_ptr->setCommand(cmd_str, "");
   return cmd_ptr;
@@ -181,31 +220,26 @@ void KebaCommandGetStatus::KebaCommandStatus::processResponse(std::string &respo
 {
 }
 
-void KebaCommandGetStatus::KebaCommandStatus::updateData(std::string &response)
+void KebaCommandGetStatus::KebaCommandStatus::processResponse(wire::FloatGroups &groups) const
 {
-  std::vector<std::string> strVec;
-
-  if (!response.empty() && *(response.end() - 1) == ';')
-    response.erase(response.end() - 1, response.end());
-
-  boost::split(strVec, response, boost::is_any_of(";"), boost::token_compress_on);
-  if (strVec.size() != 3)
+  if (groups.size() != 3 || !convertToolFrame(groups[2]))
   {
-    ROS_ERROR_STREAM("KebaCommandGetStatus size wrong!");
-    ROS_ERROR_STREAM("Size: " << strVec.size() << " Msg: " << response);
-    for (auto &&str : strVec)
-    {
-      ROS_ERROR_STREAM(str);
-    }
-    // ROS_ERROR_STREAM(response.c_str()[response.length() - 1]);
-    response = "error";
+    ROS_ERROR_STREAM("KebaCommandGetStatus binary response has " << groups.size() << " groups");
+    groups.clear();
+  }
+}
 
-    return;
+bool KebaCommandGetStatus::KebaCommandStatus::updateData(const std::string &response)
+{
+  if (!parseGroups(response))
+  {
+    ROS_ERROR_STREAM("KebaCommandGetStatus failed to parse: " << response);
+    return false;
   }
 
-  last_joint_state = strVec[0];
-  last_joint_vel = strVec[1];
-  last_tcp_frame = convertToolFrameStr(strVec[2]);
+  // Only fails if the frame doesn't have 6 values, which the Connector reports.  The joints are still good.
+  convertToolFrame(tcp_frame_.data(), tcp_frame_.size());
+  return true;
 }
 
 KebaCommandLin::KebaCommandLin()
@@ -234,7 +268,7 @@ void KebaCommandLin::initialize()
 
 RobotCommandPtr KebaCommandLin::processMsg(const robot_movement_interface::Command &cmd_msg) const
 {
-  RobotCommandPtr cmd_ptr = std::make_shared<KebaCommand>(RobotCommand::RobotCommand::CommandType::Cmd);
+  RobotCommandPtr cmd_ptr = makeRobotCommand<KebaCommand>(RobotCommand::RobotCommand::CommandType::Cmd);
 
   std::string command_str = "lin " + boost::to_lower_copy(cmd_msg.pose_type);
 
@@ -272,7 +306,7 @@ RobotCommandPtr KebaCommandLin::processMsg(const robot_movement_interface::Comma
     }
   }
 
-  cmd_ptr->setCommand(command_str, RobotCommand::paramsToString(pose_temp));
+  cmd_ptr->setCommand(command_str, pose_temp);
 
   try
   {
@@ -318,7 +352,7 @@ void KebaCommandPtp::initialize()
 
 RobotCommandPtr KebaCommandPtp::processMsg(const robot_movement_interface::Command &cmd_msg) const
 {
-  RobotCommandPtr cmd_ptr = std::make_shared<KebaCommand>(RobotCommand::RobotCommand::CommandType::Cmd);
+  RobotCommandPtr cmd_ptr = makeRobotCommand<KebaCommand>(RobotCommand::RobotCommand::CommandType::Cmd);
 
   std::string command_str = "ptp " + boost::to_lower_copy(cmd_msg.pose_type);
 
@@ -336,7 +370,7 @@ RobotCommandPtr KebaCommandPtp::processMsg(const robot_movement_interface::Comma
     processKebaAux(cmd_msg, *cmd_ptr);
   }
 
-  cmd_ptr->setCommand(command_str, RobotCommand::paramsToString(pose_temp));
+  cmd_ptr->setCommand(command_str, pose_temp);
 
   try
   {
@@ -379,7 +413,7 @@ KebaCommandSetting::KebaCommandSetting()
 
 RobotCommandPtr KebaCommandSetting::processMsg(const robot_movement_interface::Command &cmd_msg) const
 {
-  RobotCommandPtr cmd_ptr = std::make_shared<KebaCommand>(RobotCommand::RobotCommand::CommandType::Cmd);
+  RobotCommandPtr cmd_ptr = makeRobotCommand<KebaCommand>(RobotCommand::RobotCommand::CommandType::Cmd);
   std::string command_str = "setting";
 
   bool has_dyn = false;
@@ -421,7 +455,7 @@ KebaCommandAbort::KebaCommandAbort()
 
 RobotCommandPtr KebaCommandAbort::processMsg(const robot_movement_interface::Command &cmd_msg) const
 {
-  RobotCommandPtr cmd_ptr = std::make_shared<KebaCommand>(RobotCommand::RobotCommand::CommandType::Get);
+  RobotCommandPtr cmd_ptr = makeRobotCommand<KebaCommand>(RobotCommand::RobotCommand::CommandType::Get);
   cmd_ptr->setCommand("abort", "");
   return cmd_ptr;
 }
@@ -439,9 +473,9 @@ KebaCommandSync::KebaCommandSync()
 
 RobotCommandPtr KebaCommandSync::processMsg(const robot_movement_interface::Command &cmd_msg) const
 {
-  RobotCommandPtr cmd_ptr = std::make_shared<KebaCommand>(RobotCommand::RobotCommand::CommandType::Cmd);
+  RobotCommandPtr cmd_ptr = makeRobotCommand<KebaCommand>(RobotCommand::RobotCommand::CommandType::Cmd);
 
-  cmd_ptr->setCommand("sync", RobotCommand::paramsToString(cmd_msg.pose));
+  cmd_ptr->setCommand("sync", cmd_msg.pose);
   return cmd_ptr;
 }
 
@@ -457,7 +491,7 @@ KebaCommandWait::KebaCommandWait()
 
 RobotCommandPtr KebaCommandWait::processMsg(const robot_movement_interface::Command &cmd_msg) const
 {
-  RobotCommandPtr cmd_ptr = std::make_shared<KebaCommand>(RobotCommand::RobotCommand::CommandType::Cmd);
+  RobotCommandPtr cmd_ptr = makeRobotCommand<KebaCommand>(RobotCommand::RobotCommand::CommandType::Cmd);
 
   std::string command_str = "wait " + boost::to_lower_copy(cmd_msg.pose_type);
   cmd_ptr->setCommand(command_str, "");
@@ -490,7 +524,7 @@ KebaCommandSetFrame::KebaCommandSetFrame()
 
 RobotCommandPtr KebaCommandSetFrame::processMsg(const robot_movement_interface::Command &cmd_msg) const
 {
-  RobotCommandPtr cmd_ptr = std::make_shared<KebaCommand>(RobotCommand::RobotCommand::CommandType::Cmd);
+  RobotCommandPtr cmd_ptr = makeRobotCommand<KebaCommand>(RobotCommand::RobotCommand::CommandType::Cmd);
   cmd_ptr->setCommand("frame", "");
 
   bool is_tool = boost::iequals(cmd_msg.pose_reference, "TOOL");
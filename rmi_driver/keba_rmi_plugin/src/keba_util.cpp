@@ -46,7 +46,7 @@ bool processKebaDyn(const robot_movement_interface::Command &cmd_msg, RobotComma
       throw KebaException(oss.str());
     }
 
-    telnet_cmd.addParam("dyn", RobotCommand::paramsToString(cmd_msg.velocity));
+    telnet_cmd.addParam("dyn", cmd_msg.velocity);
     return true;
   }
   else
@@ -87,7 +87,7 @@ bool processKebaOvl(const robot_movement_interface::Command &cmd_msg, RobotComma
     return false;
   }
 
-  telnet_cmd.addParam(boost::to_lower_copy(blending_type), RobotCommand::paramsToString(blending));
+  telnet_cmd.addParam(boost::to_lower_copy(blending_type), blending);
 
   return true;
 }
@@ -110,7 +110,7 @@ bool processKebaFrame(const robot_movement_interface::Command &cmd_msg, RobotCom
     pose_copy[4] = radToDeg(pose_copy[4]);
     pose_copy[5] = radToDeg(pose_copy[5]);
 
-    telnet_cmd.addParam("tool", RobotCommand::paramsToString(pose_copy, 2));
+    telnet_cmd.addParam("tool", pose_copy, 2);
   }
   else
   {
@@ -125,12 +125,12 @@ bool processRosDyn(const robot_movement_interface::Command &cmd_msg, RobotComman
   bool ret = false;
   if (cmd_msg.velocity_type.compare("ROS") == 0)
   {
-    telnet_cmd.addParam("velros", RobotCommand::paramsToString(cmd_msg.velocity));
+    telnet_cmd.addParam("velros", cmd_msg.velocity);
     ret = true;
   }
   if (cmd_msg.acceleration_type.compare("ROS") == 0)
   {
-    telnet_cmd.addParam("accros", RobotCommand::paramsToString(cmd_msg.acceleration));
+    telnet_cmd.addParam("accros", cmd_msg.acceleration);
     ret = true;
   }
   return ret;
@@ -188,41 +188,32 @@ bool processKebaAux(const robot_movement_interface::Command &cmd_msg, RobotComma
   return ret;
 }
 
-std::string convertToolFrameStr(const std::string &response)
+bool convertToolFrame(std::vector<double> &frame)
 {
-  std::string ret = "";
-  try
-  {
-    auto vals = util::stringToDoubleVec(response);  // x y z rotZ rotY rotZ'
-    if (vals.size() != 6)
-    {
-      ret = "error";
-      return ret;
-    }
-
-    auto Z = vals[3];
-    auto Y = vals[4];
-    auto ZZ = vals[5];
-
-    // I'm bad at rotation math so I make a rotation matrix in ZYZ (easy to make) then use the built in getEulerYPR
-    // function (hard to make) which is the same as ZYX.
-    auto rot_zyz = util::RotationUtils::rotZYZ(Z, Y, ZZ);
-    tf2::Matrix3x3 roz_xyz;
+  return convertToolFrame(frame.data(), frame.size());
+}
 
-    tf2Scalar euler_Z, euler_Y, euler_X;
-    rot_zyz.getEulerYPR(euler_Z, euler_Y, euler_X);
+bool convertToolFrame(double *frame, std::size_t size)
+{
+  if (size != 6)  // x y z rotZ rotY rotZ'
+    return false;
 
-    vals[3] = euler_Z;
-    vals[4] = euler_Y;
-    vals[5] = euler_X;
+  util::RotationUtils::zyzToZyx(frame[3], frame[4], frame[5], frame[3], frame[4], frame[5]);
 
-    ret = util::vecToString(vals, 4);
-  }
-  catch (const boost::bad_lexical_cast &)
-  {
-    ret = "error";
-  }
+  return true;
+}
 
+std::string convertToolFrameStr(const std::string &response)
+{
+  // Like stringToDoubleVec, a frame followed by something that isn't a number is still used
+  RobotCommandStatus::Values vals;
+  util::parseDoubles(response, vals);
+  if (!convertToolFrame(vals.data(), vals.size()))
+    return "error";
+
+  std::string ret;
+  ret.reserve(64);
+  util::appendVecToString(ret, vals, 4);
   return ret;
 }
 
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+/**
+ * CPU time and context switches per Cmd for the 2 Cmd socket designs: the Cmd thread that blocks on futures for every
+ * write/read, and the coroutines that run on the io_service (async_cmd).  1 Connector sends a burst of ptp commands to
+ * a simulated robot.  The robot's thread is included in both.
+ *
+ * The Connector advertises its topics, so this one needs a ROS master.  It's skipped without one.
+ */
+
+#include <sys/resource.h>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include "bench_util.h"
+#include "sim_robot.h"
+
+using namespace rmi_driver;
+using namespace rmi_driver::bench;
+
+namespace
+{
+long contextSwitches()
+{
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+void runCmdCpu(bool async_cmd, int depth, int commands)
+{
+  boost::asio::io_service sim_io_service;
+  SimRobot robot(sim_io_service);
+  std::thread sim_thread([&sim_io_service]() { sim_io_service.run(); });
+
+  boost::asio::io_service io_service;
+  std::unique_ptr<boost::asio::io_service::work> work(new boost::asio::io_service::work(io_service));
+  std::thread io_thread([&io_service]() { io_service.run(); });
+
+  auto cmd_register = std::make_shared<SimCommandRegister>();
+  cmd_register->initialize(kSimJoints);
+
+  ConnectionConfig con_cfg;
+  con_cfg.async_cmd_ = async_cmd;
+  con_cfg.cmd_pipeline_depth_ = depth;
+  // Keep the Get loop out of the numbers
+  con_cfg.get_rate_ = 1;
+
+  Connector connector("/bench", io_service, "127.0.0.1", robot.port(), kSimJoints, nullptr, cmd_register, true,
+                      con_cfg);
+  connector.connect();
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  robot_movement_interface::CommandList list;
+  for (int i = 0; i < commands; ++i)
+  {
+    robot_movement_interface::Command cmd;
+    cmd.command_id = i;
+    cmd.command_type = "PTP";
+    cmd.pose = { 0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f, static_cast<float>(i) };
+    list.commands.push_back(cmd);
+  }
+
+  auto responses = [&connector]() {
+    std::size_t count = 0;
+    connector.getLatencyStats().forEach([&count](const std::string& name, const CommandLatency& latency) {
+      if (name == "ptp joints")
+        count = latency.response.count();
+    });
+    return count;
+  };
+
+  double cpu_start = cpuSeconds();
+  long switches_start = contextSwitches();
+  auto start = std::chrono::steady_clock::now();
+
+  connector.commandListCb(list);
+
+  while (responses() < std::size_t(commands) && std::chrono::steady_clock::now() - start < std::chrono::seconds(30))
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double cpu = cpuSeconds() - cpu_start;
+  long switches = contextSwitches() - switches_start;
+
+  std::printf("%-12s depth %d %12.0f cmds/s %9.2f us cpu/cmd %7.2f ctx switches/cmd %s\n",
+              async_cmd ? "coroutines" : "Cmd thread", depth, commands / seconds, cpu * 1e6 / commands,
+              static_cast<double>(switches) / commands, responses() < std::size_t(commands) ? "(timed out)" : "");
+  std::fflush(stdout);
+
+  connector.stop();
+  work.reset();
+  io_service.stop();
+  io_thread.join();
+
+  sim_io_service.stop();
+  sim_thread.join();
+}
+
+}  // namespace
+
+RMI_BENCHMARK(cmd_cpu)
+{
+  if (!initRos())
+    return;
+
+  const int commands = 20000;
+
+  for (int depth : { 1, 4 })
+    for (bool async_cmd : { false, true })
+      runCmdCpu(async_cmd, depth, commands);
+}
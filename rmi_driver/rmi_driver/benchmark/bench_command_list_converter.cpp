@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+/**
+ * Turns a 10k point, 7 joint JTA CommandList into RobotCommands the way Connector::commandListCb does: on 1 thread, and
+ * with a CommandListConverter on 1 to 4 worker threads.  Prints how long it takes until the first chunk could be queued.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include "bench_util.h"
+#include "keba_rmi_plugin/commands_keba.h"
+#include "rmi_driver/command_list_converter.h"
+#include "rmi_driver/commands.h"
+
+using namespace rmi_driver;
+
+RMI_BENCHMARK(command_list_converter)
+{
+  const std::vector<std::string> joints{ "joint_1", "joint_2", "joint_3", "joint_4", "joint_5", "joint_6", "rail" };
+  const std::size_t num_points = 10000;
+  const std::size_t iterations = 20;
+
+  keba_rmi_plugin::KebaCommandRegister cmd_register;
+  cmd_register.initialize(joints);
+
+  trajectory_msgs::JointTrajectory traj;
+  traj.points.resize(num_points);
+  for (std::size_t i = 0; i < num_points; ++i)
+  {
+    double t = static_cast<double>(i) / num_points;
+    for (std::size_t j = 0; j < joints.size(); ++j)
+    {
+      traj.points[i].positions.push_back(std::sin(t * 6.28 + j));
+      traj.points[i].velocities.push_back(std::cos(t * 6.28 + j));
+      traj.points[i].accelerations.push_back(-std::sin(t * 6.28 + j));
+    }
+  }
+  auto cmd_list = cmd_register.getJtaCommandHandler()->processJta(traj);
+
+  // Everything is converted before the first command is queued
+  std::vector<RobotCommandPtr> commands;
+  bench::run("serial, 10k points", iterations, [&]() {
+    commands.clear();
+    for (const auto& msg : cmd_list.commands)
+    {
+      auto handler = cmd_register.findHandler(msg);
+      auto command = handler->processMsg(msg);
+      command->setCommandId(msg.command_id);
+      command->getText();
+      commands.push_back(command);
+    }
+    bench::doNotOptimize(commands);
+  });
+
+  std::vector<const CommandHandler*> handlers;
+  for (const auto& msg : cmd_list.commands)
+    handlers.push_back(cmd_register.findHandler(msg));
+
+  for (int threads : { 1, 2, 4 })
+  {
+    CommandListConverter converter(threads, 256);
+    double first_chunk_us = 0;
+    std::size_t runs = 0;
+
+    bench::run("converter, 10k points, " + std::to_string(threads) + " threads", iterations, [&]() {
+      commands.clear();
+      auto start = std::chrono::steady_clock::now();
+      converter.convert(cmd_list, handlers, [&](std::vector<RobotCommandPtr>& chunk) {
+        if (commands.empty())
+          first_chunk_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        commands.insert(commands.end(), chunk.begin(), chunk.end());
+        return true;
+      });
+      ++runs;
+      bench::doNotOptimize(commands);
+    });
+
+    std::printf("  first chunk of %zu ready after %.0f us\n", converter.getChunkSize(), first_chunk_us / runs);
+  }
+
+  if (commands.size() != cmd_list.commands.size())
+    std::printf("only %zu of %zu commands were converted\n", commands.size(), cmd_list.commands.size());
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+/**
+ * The per command work of a CommandList: find the handler for each message, let the Keba handler build the
+ * RobotCommand, and turn it into the string that is sent.  Also the text helpers the commands are built from.
+ */
+
+#include <cstdio>
+#include "bench_util.h"
+#include "keba_rmi_plugin/commands_keba.h"
+#include "rmi_driver/commands.h"
+#include "rmi_driver/util.h"
+
+using namespace rmi_driver;
+
+namespace
+{
+const std::vector<std::string> kJoints{ "joint_1", "joint_2", "joint_3", "joint_4", "joint_5", "joint_6", "rail" };
+
+robot_movement_interface::Command makePtpJoints()
+{
+  robot_movement_interface::Command cmd;
+  cmd.command_type = "PTP";
+  cmd.pose_type = "JOINTS";
+  cmd.pose = { 0.1f, -1.2f, 1.3f, -0.4f, 1.5f, 0.6f, 1.0f };
+  cmd.velocity_type = "ROS";
+  cmd.velocity = { 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f };
+  cmd.acceleration_type = "ROS";
+  cmd.acceleration = { 1.5f, 1.5f, 1.5f, 1.5f, 1.5f, 1.5f, 1.5f };
+  return cmd;
+}
+
+robot_movement_interface::Command makePtpQuaternion()
+{
+  robot_movement_interface::Command cmd;
+  cmd.command_type = "PTP";
+  cmd.pose_type = "QUATERNION";
+  cmd.pose = { 0.5f, -0.6f, 0.35f, 0.0f, 1.0f, 0.0f, 0.0f };
+  cmd.velocity_type = "DYN";
+  cmd.velocity = { 100, 100, 100, 100, 250, 1000, 1000, 10000, 1000, 10000, 1000, 10000 };
+  return cmd;
+}
+
+robot_movement_interface::Command makeWait()
+{
+  robot_movement_interface::Command cmd;
+  cmd.command_type = "WAIT";
+  cmd.pose_type = "IS_FINISHED";
+  return cmd;
+}
+
+robot_movement_interface::Command makeGetStatus()
+{
+  robot_movement_interface::Command cmd;
+  cmd.command_type = "GET";
+  cmd.pose_type = "STATUS";
+  return cmd;
+}
+
+}  // namespace
+
+RMI_BENCHMARK(commands)
+{
+  const std::size_t iterations = 200000;
+
+  keba_rmi_plugin::KebaCommandRegister cmd_register;
+  cmd_register.initialize(kJoints);
+
+  std::vector<std::pair<std::string, robot_movement_interface::Command>> msgs{ { "ptp joints", makePtpJoints() },
+                                                                                { "ptp quaternion", makePtpQuaternion() },
+                                                                                { "wait", makeWait() },
+                                                                                { "get status", makeGetStatus() } };
+  for (const auto& msg : msgs)
+  {
+    auto handler = cmd_register.findHandler(msg.second);
+    std::printf("%s: %s\n", msg.first.c_str(), handler ? handler->getName().c_str() : "no handler");
+  }
+
+  for (const auto& msg : msgs)
+  {
+    bench::run("findHandler, " + msg.first, iterations, [&]() {
+      auto handler = cmd_register.findHandler(msg.second);
+      bench::doNotOptimize(handler);
+    });
+  }
+
+  for (std::size_t i = 0; i < 2; ++i)
+  {
+    const auto& msg = msgs[i];
+    auto handler = cmd_register.findHandler(msg.second);
+    bench::run("KebaCommandPtp::processMsg, " + msg.first, iterations, [&]() {
+      auto command = handler->processMsg(msg.second);
+      bench::doNotOptimize(command);
+    });
+  }
+
+  auto command = cmd_register.findHandler(msgs[0].second)->processMsg(msgs[0].second);
+  std::printf("%s", command->toString().c_str());
+
+  bench::run("RobotCommand::toString", iterations, [&]() {
+    auto str = command->toString();
+    bench::doNotOptimize(str);
+  });
+
+  bench::run("RobotCommand::getText", iterations, [&]() {
+    bench::doNotOptimize(command->getText());
+  });
+
+  std::vector<float> joints{ 0.1234f, -1.2345f, 1.3456f, -0.4567f, 1.5678f, 0.6789f, 1234.5f };
+  bench::run("paramsToString, 7 joints", iterations, [&]() {
+    auto str = RobotCommand::paramsToString(joints, 4);
+    bench::doNotOptimize(str);
+  });
+
+  const std::string joint_str = "0.123456 -1.234567 1.345678 -0.456789 1.567891 0.678912 1234.567";
+  bench::run("stringToDoubleVec, 7 joints", iterations, [&]() {
+    auto vals = util::stringToDoubleVec(joint_str);
+    bench::doNotOptimize(vals);
+  });
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+/**
+ * Runs 1..32 Connectors against simulated robots with one thread per connection (an io_service thread plus a Cmd thread
+ * each) and with every connection on a shared io_service thread pool sized to the core count.  Each connection sends a
+ * burst of ptp commands while its Get loop polls at 50 Hz.
+ *
+ * The Connectors advertise their topics, so this one needs a ROS master.  It's skipped without one.
+ */
+
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include "bench_util.h"
+#include "sim_robot.h"
+
+using namespace rmi_driver;
+using namespace rmi_driver::bench;
+
+namespace
+{
+/**
+ * \brief Send commands_per_connection ptps on each of connections Connectors and print the throughput
+ * @param shared_pool True to run every Connector on 1 io_service with a thread per core.  False gives every Connector
+ * its own io_service thread and Cmd thread, like the Driver used to.
+ */
+void runScaling(bool shared_pool, int connections, int commands_per_connection)
+{
+  const int pool_size = std::max(1u, std::thread::hardware_concurrency());
+
+  boost::asio::io_service sim_io_service;
+  std::vector<std::unique_ptr<SimRobot>> robots;
+  for (int i = 0; i < connections; ++i)
+    robots.emplace_back(new SimRobot(sim_io_service));
+  std::thread sim_thread([&sim_io_service]() { sim_io_service.run(); });
+
+  // A single io_service for the shared pool, 1 per connection otherwise
+  std::vector<std::unique_ptr<boost::asio::io_service>> io_services;
+  std::vector<std::unique_ptr<boost::asio::io_service::work>> work;
+  std::vector<std::thread> io_threads;
+  for (int i = 0; i < (shared_pool ? 1 : connections); ++i)
+  {
+    io_services.emplace_back(new boost::asio::io_service);
+    work.emplace_back(new boost::asio::io_service::work(*io_services.back()));
+  }
+  for (int i = 0; i < (shared_pool ? pool_size : connections); ++i)
+  {
+    auto& io_service = *io_services[shared_pool ? 0 : i];
+    io_threads.emplace_back([&io_service]() { io_service.run(); });
+  }
+
+  auto cmd_register = std::make_shared<SimCommandRegister>();
+  cmd_register->initialize(kSimJoints);
+
+  ConnectionConfig con_cfg;
+  con_cfg.async_cmd_ = shared_pool;
+  con_cfg.cmd_pipeline_depth_ = 4;
+
+  std::vector<std::unique_ptr<Connector>> connectors;
+  for (int i = 0; i < connections; ++i)
+  {
+    auto& io_service = *io_services[shared_pool ? 0 : i];
+    connectors.emplace_back(new Connector("/bench_" + std::to_string(i), io_service, "127.0.0.1", robots[i]->port(),
+                                          kSimJoints, nullptr, cmd_register, true, con_cfg));
+    connectors.back()->connect();
+  }
+
+  // Wait for the Get loops to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  int threads = threadCount();
+
+  robot_movement_interface::CommandList list;
+  for (int i = 0; i < commands_per_connection; ++i)
+  {
+    robot_movement_interface::Command cmd;
+    cmd.command_id = i;
+    cmd.command_type = "PTP";
+    cmd.pose = { 0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f, static_cast<float>(i) };
+    list.commands.push_back(cmd);
+  }
+
+  auto done = [&connectors, commands_per_connection]() {
+    for (auto& connector : connectors)
+    {
+      std::size_t responses = 0;
+      connector->getLatencyStats().forEach([&responses](const std::string& name, const CommandLatency& latency) {
+        if (name == "ptp joints")
+          responses = latency.response.count();
+      });
+      if (responses < std::size_t(commands_per_connection))
+        return false;
+    }
+    return true;
+  };
+
+  double cpu_start = cpuSeconds();
+  auto start = std::chrono::steady_clock::now();
+
+  for (auto& connector : connectors)
+    connector->commandListCb(list);
+
+  while (!done() && std::chrono::steady_clock::now() - start < std::chrono::seconds(30))
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double cpu = cpuSeconds() - cpu_start;
+
+  std::size_t polls = 0;
+  for (auto& connector : connectors)
+    for (auto& item : connector->getGetItemStats())
+      polls += item.polls;
+
+  std::printf("%-12s %3d connections %5d threads %12.0f cmds/s %9.1f ms %9.1f ms cpu %8zu get polls %s\n",
+              shared_pool ? "shared pool" : "per conn", connections, threads,
+              connections * commands_per_connection / seconds, seconds * 1e3, cpu * 1e3, polls,
+              done() ? "" : "(timed out)");
+  std::fflush(stdout);
+
+  for (auto& connector : connectors)
+    connector->stop();
+
+  work.clear();
+  for (auto& io_service : io_services)
+    io_service->stop();
+  for (auto& thread : io_threads)
+    thread.join();
+  connectors.clear();
+
+  sim_io_service.stop();
+  sim_thread.join();
+}
+
+}  // namespace
+
+RMI_BENCHMARK(connection_scaling)
+{
+  if (!initRos())
+    return;
+
+  const int commands_per_connection = 2000;
+
+  for (bool shared_pool : { false, true })
+    for (int connections = 1; connections <= 32; connections *= 2)
+      runScaling(shared_pool, connections, commands_per_connection);
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+/**
+ * Formats the params of a 7 joint ptp with velros and accros with the iostream version floatToStringNoTrailing() used
+ * to have, and with the fixed precision writer that replaced it.
+ */
+
+#include <boost/algorithm/string.hpp>
+#include <iomanip>
+#include <sstream>
+#include "bench_util.h"
+#include "rmi_driver/commands.h"
+#include "rmi_driver/util.h"
+
+using namespace rmi_driver;
+
+namespace
+{
+std::string floatToStringStream(float fval, int precision)
+{
+  std::ostringstream oss;
+  oss << std::setprecision(precision) << std::fixed;
+  oss << fval;
+  auto str = oss.str();
+  boost::trim_right_if(str, boost::is_any_of("0"));
+  boost::trim_right_if(str, boost::is_any_of("."));
+  return str;
+}
+
+std::string vecToStringStream(const std::vector<float>& vec, int precision)
+{
+  std::ostringstream oss;
+  for (std::size_t i = 0; i < vec.size(); ++i)
+  {
+    if (i > 0)
+      oss << " ";
+    oss << floatToStringStream(vec[i], precision);
+  }
+  return oss.str();
+}
+
+}  // namespace
+
+RMI_BENCHMARK(float_format)
+{
+  const std::size_t iterations = 200000;
+
+  std::vector<float> joints{ 0.1234f, -1.2345f, 1.3456f, -0.4567f, 1.5678f, 0.6789f, 1234.5f };
+  std::vector<float> velros{ 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f };
+  std::vector<float> accros{ 1.5f, 1.5f, 1.5f, 1.5f, 1.5f, 1.5f, 1.5f };
+
+  bench::run("1 float, iostream", iterations, [&]() {
+    std::string str = floatToStringStream(joints[1], 4);
+    bench::doNotOptimize(str);
+  });
+
+  std::string out;
+  bench::run("1 float, appendFloatNoTrailing", iterations, [&]() {
+    out.clear();
+    util::appendFloatNoTrailing(out, joints[1], 4);
+    bench::doNotOptimize(out);
+  });
+
+  bench::run("ptp params, iostream", iterations, [&]() {
+    std::string j = vecToStringStream(joints, 4);
+    std::string v = vecToStringStream(velros, 4);
+    std::string a = vecToStringStream(accros, 4);
+    bench::doNotOptimize(j);
+    bench::doNotOptimize(v);
+    bench::doNotOptimize(a);
+  });
+
+  bench::run("ptp params, paramsToString", iterations, [&]() {
+    std::string j = RobotCommand::paramsToString(joints);
+    std::string v = RobotCommand::paramsToString(velros);
+    std::string a = RobotCommand::paramsToString(accros);
+    bench::doNotOptimize(j);
+    bench::doNotOptimize(v);
+    bench::doNotOptimize(a);
+  });
+
+  bench::run("ptp params, appendVecToString", iterations, [&]() {
+    out.clear();
+    util::appendVecToString(out, joints, 4);
+    util::appendVecToString(out, velros, 4);
+    util::appendVecToString(out, accros, 4);
+    bench::doNotOptimize(out);
+  });
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+/**
+ * Turns joint trajectories of 10, 1k and 100k points into a CommandList with the Keba JtaCommandHandler, then turns the
+ * CommandList into RobotCommands like Connector::addCommand does.  7 joints with velocities and accelerations.
+ *
+ * jta_reorder compares the 2 ways JointTrajectoryAction::newGoal can put a 10k point goal in the driver's joint order:
+ * sorting a copy of the trajectory first, and sorting each point as it's processed.
+ *
+ * jta_decimation drops the points of a densely sampled 10k point goal that are within 1 mrad of the line, then turns
+ * what's left into RobotCommands.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include "bench_util.h"
+#include "keba_rmi_plugin/commands_keba.h"
+#include "rmi_driver/commands.h"
+#include "rmi_driver/trajectory_decimation.h"
+#include "rmi_driver/util.h"
+
+using namespace rmi_driver;
+
+namespace
+{
+trajectory_msgs::JointTrajectory makeTrajectory(std::size_t num_points, std::size_t num_joints)
+{
+  trajectory_msgs::JointTrajectory traj;
+  traj.points.resize(num_points);
+  for (std::size_t i = 0; i < num_points; ++i)
+  {
+    auto& point = traj.points[i];
+    double t = static_cast<double>(i) / num_points;
+    for (std::size_t j = 0; j < num_joints; ++j)
+    {
+      point.positions.push_back(std::sin(t * 6.28 + j));
+      point.velocities.push_back(std::cos(t * 6.28 + j));
+      point.accelerations.push_back(-std::sin(t * 6.28 + j));
+    }
+  }
+  return traj;
+}
+
+}  // namespace
+
+RMI_BENCHMARK(jta)
+{
+  const std::vector<std::string> joints{ "joint_1", "joint_2", "joint_3", "joint_4", "joint_5", "joint_6", "rail" };
+
+  keba_rmi_plugin::KebaCommandRegister cmd_register;
+  cmd_register.initialize(joints);
+  auto jta_handler = cmd_register.getJtaCommandHandler();
+
+  // About 200k points per size
+  for (std::size_t num_points : { 10, 1000, 100000 })
+  {
+    auto traj = makeTrajectory(num_points, joints.size());
+    std::size_t iterations = std::max<std::size_t>(200000 / num_points, 2);
+    std::string points = std::to_string(num_points) + " points";
+
+    bench::run("processJta, " + points, iterations, [&]() {
+      auto cmd_list = jta_handler->processJta(traj);
+      bench::doNotOptimize(cmd_list);
+    });
+
+    auto cmd_list = jta_handler->processJta(traj);
+    std::vector<RobotCommandPtr> commands;
+    bench::run("CommandList to RobotCommands, " + points, iterations, [&]() {
+      commands.clear();
+      for (const auto& msg : cmd_list.commands)
+      {
+        auto handler = cmd_register.findHandler(msg);
+        if (handler)
+          commands.push_back(handler->processMsg(msg));
+      }
+      bench::doNotOptimize(commands);
+    });
+
+    if (commands.size() != cmd_list.commands.size())
+      std::printf("only %zu of %zu commands had a handler\n", commands.size(), cmd_list.commands.size());
+  }
+}
+
+RMI_BENCHMARK(jta_reorder)
+{
+  const std::vector<std::string> joints{ "joint_1", "joint_2", "joint_3", "joint_4", "joint_5", "joint_6", "rail" };
+
+  keba_rmi_plugin::KebaCommandRegister cmd_register;
+  cmd_register.initialize(joints);
+  auto jta_handler = cmd_register.getJtaCommandHandler();
+
+  // The goal has the joints backwards
+  auto traj = makeTrajectory(10000, joints.size());
+  traj.joint_names.assign(joints.rbegin(), joints.rend());
+  std::vector<size_t> mapping;
+  for (std::size_t i = 0; i < joints.size(); ++i)
+    mapping.push_back(joints.size() - 1 - i);
+
+  bench::run("sorted copy, then processJta, 10k points", 10, [&]() {
+    trajectory_msgs::JointTrajectory traj_sorted;
+    traj_sorted.header = traj.header;
+    traj_sorted.joint_names = util::sortVectorByIndices<std::string>(mapping, traj.joint_names);
+    for (auto&& point : traj.points)
+    {
+      trajectory_msgs::JointTrajectoryPoint jtp;
+      jtp.positions = util::sortVectorByIndices<double>(mapping, point.positions);
+      jtp.velocities = util::sortVectorByIndices<double>(mapping, point.velocities);
+      jtp.accelerations = util::sortVectorByIndices<double>(mapping, point.accelerations);
+      jtp.effort = util::sortVectorByIndices<double>(mapping, point.effort);
+      jtp.time_from_start = point.time_from_start;
+      traj_sorted.points.push_back(jtp);
+    }
+    auto cmd_list = jta_handler->processJta(traj_sorted);
+    bench::doNotOptimize(cmd_list);
+  });
+
+  bench::run("processJta with a mapping, 10k points", 10, [&]() {
+    auto cmd_list = jta_handler->processJta(traj, mapping);
+    bench::doNotOptimize(cmd_list);
+  });
+}
+
+RMI_BENCHMARK(jta_decimation)
+{
+  const std::vector<std::string> joints{ "joint_1", "joint_2", "joint_3", "joint_4", "joint_5", "joint_6", "rail" };
+
+  keba_rmi_plugin::KebaCommandRegister cmd_register;
+  cmd_register.initialize(joints);
+  auto jta_handler = cmd_register.getJtaCommandHandler();
+
+  // 1 period of a sine on every joint, sampled every 1ms like a Cartesian planner would
+  auto traj = makeTrajectory(10000, joints.size());
+  for (std::size_t i = 0; i < traj.points.size(); ++i)
+    traj.points[i].time_from_start = ros::Duration(i * 0.001);
+
+  const std::vector<double> tolerances(joints.size(), 0.001);
+  std::vector<std::size_t> keep;
+  bench::run("decimateTrajectory, 10k points", 20, [&]() {
+    decimateTrajectory(traj.points, tolerances, keep);
+    bench::doNotOptimize(keep);
+  });
+  std::printf("  kept %zu of %zu points\n", keep.size(), traj.points.size());
+
+  trajectory_msgs::JointTrajectory decimated;
+  for (std::size_t idx : keep)
+    decimated.points.push_back(traj.points[idx]);
+
+  std::vector<RobotCommandPtr> commands;
+  auto to_commands = [&](const trajectory_msgs::JointTrajectory& goal) {
+    auto cmd_list = jta_handler->processJta(goal);
+    commands.clear();
+    for (const auto& msg : cmd_list.commands)
+      commands.push_back(cmd_register.findHandler(msg)->processMsg(msg));
+    bench::doNotOptimize(commands);
+  };
+
+  bench::run("goal to RobotCommands, 10k points", 10, [&]() { to_commands(traj); });
+  bench::run("goal to RobotCommands, decimated", 10, [&]() { to_commands(decimated); });
+}
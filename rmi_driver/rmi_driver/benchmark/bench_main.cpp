@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include "bench_util.h"
+
+namespace
+{
+std::atomic<std::size_t> alloc_count(0);
+}
+
+void* operator new(std::size_t size)
+{
+  alloc_count.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+namespace rmi_driver
+{
+namespace bench
+{
+std::size_t allocCount()
+{
+  return alloc_count.load(std::memory_order_relaxed);
+}
+
+std::vector<std::pair<std::string, BenchFunc>>& registry()
+{
+  static std::vector<std::pair<std::string, BenchFunc>> benchmarks;
+  return benchmarks;
+}
+
+void run(const std::string& name, std::size_t iterations, const std::function<void()>& fn)
+{
+  for (std::size_t i = 0; i < iterations / 10 + 1; ++i)
+    fn();
+
+  std::size_t allocs_start = allocCount();
+  auto start = std::chrono::steady_clock::now();
+
+  for (std::size_t i = 0; i < iterations; ++i)
+    fn();
+
+  auto end = std::chrono::steady_clock::now();
+  std::size_t allocs = allocCount() - allocs_start;
+
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+  std::printf("%-48s %10zu iters %14.1f ns/op %10.2f allocs/op\n", name.c_str(), iterations, ns / iterations,
+              static_cast<double>(allocs) / iterations);
+  std::fflush(stdout);
+}
+
+}  // namespace bench
+}  // namespace rmi_driver
+
+/**
+ * Usage: rmi_driver_bench [filter]
+ *
+ * Runs every benchmark whose name contains filter.  Only cmd_cpu and connection_scaling need a ROS master.
+ */
+int main(int argc, char** argv)
+{
+  std::string filter = argc > 1 ? argv[1] : "";
+
+  for (auto& benchmark : rmi_driver::bench::registry())
+  {
+    if (benchmark.first.find(filter) == std::string::npos)
+      continue;
+
+    std::printf("== %s\n", benchmark.first.c_str());
+    benchmark.second();
+  }
+
+  return 0;
+}
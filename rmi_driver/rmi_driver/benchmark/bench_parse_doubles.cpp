@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+/**
+ * Parses the 3 groups of recorded status responses (joint positions, joint velocities, tool frame) with the
+ * boost::spirit::qi parser stringToDoubleVec() used to have, with stringToDoubleVec() now, and with parseDoubles() into
+ * the fixed size vectors the Get loop uses.
+ */
+
+#include <boost/algorithm/string.hpp>
+#include <boost/spirit/include/qi.hpp>
+#include <cstdio>
+#include "bench_util.h"
+#include "rmi_driver/fixed_vector.h"
+#include "rmi_driver/util.h"
+
+using namespace rmi_driver;
+
+namespace
+{
+// Recorded from a 6 axis arm on a rail, standing still and moving.  Split at ';' like KebaCommandStatus does.
+const char* kStatusResponses[] = {
+  "0 -1.570796 1.570796 0 1.570796 0 1250;0 0 0 0 0 0 0;765.012 -0.0021 1215.5 180 0 180",
+  "0.123456 -1.234567 1.345678 -0.456789 1.567891 0.678912 1234.567;0.012345 -0.023456 0.034567 -0.045678 0.056789 "
+  "-0.067891 12.5;512.2531 -612.5002 365.1254 91.2345 -12.5678 178.9012",
+  " -2.967060 -0.785398 2.356194 -3.141593 0.000001 6.283185 0.000000;0.500000 0.500000 0.500000 0.500000 0.500000 "
+  "0.500000 0.000000;-1024.500000 0.000100 -0.000100 -179.999999 89.999999 -0.000001 ",
+};
+
+std::vector<double> stringToDoubleVecQi(const std::string& s)
+{
+  std::vector<double> doubleVec;
+
+  std::string::const_iterator start = s.begin();
+  std::string::const_iterator end = s.end();
+
+  std::string s_trim;
+  if (!s.empty() && (s.front() == ' ' || s.back() == ' '))
+  {
+    s_trim = boost::trim_copy(s);
+    start = s_trim.begin();
+    end = s_trim.end();
+  }
+
+  boost::spirit::qi::parse(start, end, (boost::spirit::qi::double_ % ' '), doubleVec);
+  return doubleVec;
+}
+
+}  // namespace
+
+RMI_BENCHMARK(parse_doubles)
+{
+  const std::size_t iterations = 200000;
+
+  std::vector<std::string> groups;
+  for (const char* response : kStatusResponses)
+  {
+    std::vector<std::string> parts;
+    boost::split(parts, response, boost::is_any_of(";"));
+    groups.insert(groups.end(), parts.begin(), parts.end());
+  }
+
+  for (const auto& group : groups)
+  {
+    if (stringToDoubleVecQi(group) != util::stringToDoubleVec(group))
+      std::printf("parsers differ on \"%s\"\n", group.c_str());
+  }
+
+  std::printf("%zu recorded status responses, %zu groups per op\n", sizeof(kStatusResponses) / sizeof(const char*),
+              groups.size());
+
+  bench::run("status groups, qi", iterations, [&]() {
+    for (const auto& group : groups)
+    {
+      auto vals = stringToDoubleVecQi(group);
+      bench::doNotOptimize(vals);
+    }
+  });
+
+  bench::run("status groups, stringToDoubleVec", iterations, [&]() {
+    for (const auto& group : groups)
+    {
+      auto vals = util::stringToDoubleVec(group);
+      bench::doNotOptimize(vals);
+    }
+  });
+
+  util::FixedVector<double, 16> vals;
+  bench::run("status groups, parseDoubles", iterations, [&]() {
+    for (const auto& group : groups)
+    {
+      util::parseDoubles(group, vals);
+      bench::doNotOptimize(vals);
+    }
+  });
+}
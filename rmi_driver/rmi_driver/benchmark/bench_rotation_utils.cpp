@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+/**
+ * The RotationUtils conversions used for Keba tool frames and Cartesian poses.
+ */
+
+#include "bench_util.h"
+#include "rmi_driver/rotation_utils.h"
+
+using namespace rmi_driver;
+
+RMI_BENCHMARK(rotation_utils)
+{
+  const std::size_t iterations = 1000000;
+
+  // Nudged every call so nothing is computed once and reused
+  double Z = 1.5923, Y = 0.2193, ZZ = -2.0125;
+
+  bench::run("RotationUtils::rotZYZ", iterations, [&]() {
+    auto rot = util::RotationUtils::rotZYZ(Z, Y, ZZ);
+    bench::doNotOptimize(rot);
+    ZZ += 1e-9;
+  });
+
+  bench::run("RotationUtils::rotZYZ + getEulerYPR", iterations, [&]() {
+    double yaw, pitch, roll;
+    util::RotationUtils::rotZYZ(Z, Y, ZZ).getEulerYPR(yaw, pitch, roll);
+    bench::doNotOptimize(yaw);
+    bench::doNotOptimize(pitch);
+    bench::doNotOptimize(roll);
+    ZZ += 1e-9;
+  });
+
+  bench::run("RotationUtils::zyzToZyx", iterations, [&]() {
+    double yaw, pitch, roll;
+    util::RotationUtils::zyzToZyx(Z, Y, ZZ, yaw, pitch, roll);
+    bench::doNotOptimize(yaw);
+    bench::doNotOptimize(pitch);
+    bench::doNotOptimize(roll);
+    ZZ += 1e-9;
+  });
+
+  bench::run("RotationUtils::quatFromZYZ", iterations, [&]() {
+    auto quat = util::RotationUtils::quatFromZYZ(Z, Y, ZZ);
+    bench::doNotOptimize(quat);
+    ZZ += 1e-9;
+  });
+
+  auto quat1 = util::RotationUtils::quatFromZYZ(Z, Y, ZZ);
+  auto quat2 = util::RotationUtils::quatFromZYZ(Z, Y, ZZ + 0.001);
+  bench::run("RotationUtils::approxEqual", iterations, [&]() {
+    bool equal = util::RotationUtils::approxEqual(quat1, quat2);
+    bench::doNotOptimize(equal);
+  });
+}
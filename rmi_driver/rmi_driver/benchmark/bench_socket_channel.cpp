@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+/**
+ * Compares the original Connector::sendCommand implementation (a new streambuf, 2 promise/future pairs, toString() and
+ * std::getline per call) with the SocketChannel fast path it uses now.  Both talk to a loopback server that answers
+ * every line.
+ */
+
+#include <boost/asio.hpp>
+#include <future>
+#include <istream>
+#include <thread>
+#include "bench_util.h"
+#include "rmi_driver/commands.h"
+#include "rmi_driver/socket_channel.h"
+
+using namespace rmi_driver;
+using boost::asio::ip::tcp;
+
+namespace
+{
+/// Answers every line it receives with a fixed reply.  Doesn't allocate once its buffer has grown.
+class LoopbackServer
+{
+public:
+  explicit LoopbackServer(const std::string& reply)
+    : acceptor_(io_service_, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)), reply_(reply)
+  {
+  }
+
+  ~LoopbackServer()
+  {
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+  unsigned short port() const
+  {
+    return acceptor_.local_endpoint().port();
+  }
+
+  void start()
+  {
+    thread_ = std::thread([this]() {
+      tcp::socket socket(io_service_);
+      acceptor_.accept(socket);
+      socket.set_option(tcp::no_delay(true));
+
+      boost::asio::streambuf buff;
+      boost::system::error_code ec;
+      while (!ec)
+      {
+        std::size_t size = boost::asio::read_until(socket, buff, '\n', ec);
+        buff.consume(size);
+        if (!ec)
+          boost::asio::write(socket, boost::asio::buffer(reply_), ec);
+      }
+    });
+  }
+
+private:
+  boost::asio::io_service io_service_;
+  tcp::acceptor acceptor_;
+  std::string reply_;
+  std::thread thread_;
+};
+
+/// The way Connector::sendCommand used to send a Cmd
+std::string legacySendCommand(tcp::socket& socket, const RobotCommand& command)
+{
+  std::string sendStr = command.toString();
+
+  std::promise<size_t> promise_sendCommand;
+  auto future_sendCommand = promise_sendCommand.get_future();
+
+  boost::asio::streambuf buff;
+
+  boost::asio::async_write(socket, boost::asio::buffer(sendStr),
+                           [&](const boost::system::error_code& e, std::size_t size) {
+                             if (e)
+                               promise_sendCommand.set_exception(
+                                   std::make_exception_ptr(boost::system::system_error(e)));
+                             else
+                               promise_sendCommand.set_value(size);
+                           });
+  future_sendCommand.wait();
+
+  promise_sendCommand = std::promise<size_t>();
+  future_sendCommand = promise_sendCommand.get_future();
+
+  boost::asio::async_read_until(socket, buff, '\n', [&](const boost::system::error_code& e, std::size_t size) {
+    if (e)
+      promise_sendCommand.set_exception(std::make_exception_ptr(boost::system::system_error(e)));
+    else
+      promise_sendCommand.set_value(size);
+  });
+  future_sendCommand.wait();
+
+  future_sendCommand.get();
+  std::string line;
+  std::istream is(&buff);
+  std::getline(is, line);
+
+  return line;
+}
+
+}  // namespace
+
+RMI_BENCHMARK(send_command)
+{
+  const std::size_t iterations = 20000;
+
+  RobotCommand command(RobotCommand::CommandType::Cmd, "ptp joints", "0.1 -1.2 1.3 -0.4 1.5 0.6 100");
+  command.addParam("dyn", "100 100 100 100 250 1000 1000 10000 1000 10000");
+
+  boost::asio::io_service io_service;
+  boost::asio::io_service::work work(io_service);
+  std::thread io_thread([&]() { io_service.run(); });
+
+  {
+    LoopbackServer server("done\n");
+    server.start();
+
+    tcp::socket socket(io_service);
+    socket.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), server.port()));
+    socket.set_option(tcp::no_delay(true));
+
+    bench::run("sendCommand legacy (streambuf + promises)", iterations, [&]() {
+      std::string response = legacySendCommand(socket, command);
+      bench::doNotOptimize(response);
+    });
+
+    SocketChannel channel(socket);
+    std::string response;
+    bench::run("sendCommand SocketChannel::request", iterations, [&]() {
+      channel.request(command.getText(), response);
+      bench::doNotOptimize(response);
+    });
+
+    socket.close();
+  }
+
+  io_service.stop();
+  io_thread.join();
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+/**
+ * Shows the effect of the socket_options on the round trip time to a local mock controller.  The mock leaves Nagle on,
+ * like a controller that wasn't tuned for it, so the slow cases wait for a delayed ack (about 40ms on Linux).
+ *
+ * - pipelined: 2 commands are written back to back and the controller answers both once it has both.  Without
+ *   tcp_nodelay the 2nd write waits for the ack of the 1st.
+ * - split_response: the controller writes each response in 2 pieces.  Without quick_ack the 2nd piece waits for the
+ *   ack of the 1st.
+ */
+
+#include <boost/asio.hpp>
+#include <thread>
+#include "bench_util.h"
+#include "rmi_driver/socket_channel.h"
+#include "rmi_driver/socket_options.h"
+
+using namespace rmi_driver;
+using boost::asio::ip::tcp;
+
+namespace
+{
+enum class MockMode
+{
+  Pipelined,
+  SplitResponse
+};
+
+/// A controller on loopback with the OS default socket options
+class MockController
+{
+public:
+  explicit MockController(MockMode mode)
+    : acceptor_(io_service_, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)), mode_(mode)
+  {
+  }
+
+  ~MockController()
+  {
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+  tcp::endpoint endpoint() const
+  {
+    return acceptor_.local_endpoint();
+  }
+
+  void start()
+  {
+    thread_ = std::thread([this]() {
+      tcp::socket socket(io_service_);
+      acceptor_.accept(socket);
+
+      boost::asio::streambuf buff;
+      boost::system::error_code ec;
+      while (!ec)
+      {
+        std::size_t size = boost::asio::read_until(socket, buff, '\n', ec);
+        buff.consume(size);
+        if (ec)
+          break;
+
+        if (mode_ == MockMode::Pipelined)
+        {
+          size = boost::asio::read_until(socket, buff, '\n', ec);
+          buff.consume(size);
+          if (!ec)
+            boost::asio::write(socket, boost::asio::buffer("done\ndone\n", 10), ec);
+        }
+        else
+        {
+          boost::asio::write(socket, boost::asio::buffer("done", 4), ec);
+          if (!ec)
+            boost::asio::write(socket, boost::asio::buffer("\n", 1), ec);
+        }
+      }
+    });
+  }
+
+private:
+  boost::asio::io_service io_service_;
+  tcp::acceptor acceptor_;
+  MockMode mode_;
+  std::thread thread_;
+};
+
+void runRoundTrips(const std::string& name, MockMode mode, const SocketOptions& options)
+{
+  // The slow cases take a delayed ack per round trip
+  const std::size_t iterations = 50;
+
+  MockController controller(mode);
+  controller.start();
+
+  boost::asio::io_service io_service;
+  boost::asio::io_service::work work(io_service);
+  std::thread io_thread([&io_service]() { io_service.run(); });
+
+  tcp::socket socket(io_service);
+  socket.connect(controller.endpoint());
+  applySocketOptions(socket, options);
+
+  SocketChannel channel(socket);
+  std::string command = "ptp joints : 0.1 -1.2 1.3 -0.4 1.5 0.6 100;\n";
+  std::string response;
+
+  bench::run(name, iterations, [&]() {
+    channel.write(command);
+    if (mode == MockMode::Pipelined)
+      channel.write(command);
+    rearmQuickAck(socket, options);
+
+    channel.asyncReadLine();
+    channel.waitReadLine(response);
+    if (mode == MockMode::Pipelined)
+    {
+      channel.asyncReadLine();
+      channel.waitReadLine(response);
+    }
+  });
+
+  socket.close();
+  io_service.stop();
+  io_thread.join();
+}
+
+}  // namespace
+
+RMI_BENCHMARK(socket_options)
+{
+  SocketOptions options;
+
+  options.tcp_nodelay = false;
+  runRoundTrips("pipelined, os defaults", MockMode::Pipelined, options);
+  options.tcp_nodelay = true;
+  runRoundTrips("pipelined, tcp_nodelay", MockMode::Pipelined, options);
+
+  options.quick_ack = false;
+  runRoundTrips("split_response, tcp_nodelay", MockMode::SplitResponse, options);
+  options.quick_ack = true;
+  runRoundTrips("split_response, tcp_nodelay + quick_ack", MockMode::SplitResponse, options);
+}
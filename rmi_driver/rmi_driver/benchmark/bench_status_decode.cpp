@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+/**
+ * Decodes a Keba status response the way the Get loop used to: split it into strings, convert the tool frame as text
+ * and parse every group again.  Compares that with KebaCommandStatus::updateData, which parses the groups in place and
+ * converts the tool frame as numbers.  Also times the tool frame conversion on its own.
+ */
+
+#include <boost/algorithm/string.hpp>
+#include <cstdio>
+#include "bench_util.h"
+#include "keba_rmi_plugin/commands_keba.h"
+#include "keba_rmi_plugin/keba_util.h"
+#include "rmi_driver/rotation_utils.h"
+#include "rmi_driver/util.h"
+
+using namespace rmi_driver;
+
+namespace
+{
+/// The tool frame conversion before zyzToZyx: build the ZYZ' matrix with tf2 and get the YPR from it
+std::string convertToolFrameStrTf2(const std::string& response)
+{
+  auto vals = util::stringToDoubleVec(response);
+  if (vals.size() != 6)
+    return "error";
+
+  auto rot_zyz = util::RotationUtils::rotZYZ(vals[3], vals[4], vals[5]);
+  rot_zyz.getEulerYPR(vals[3], vals[4], vals[5]);
+  return util::vecToString(vals, 4);
+}
+
+}  // namespace
+
+RMI_BENCHMARK(status_decode)
+{
+  const std::size_t iterations = 200000;
+
+  const std::string response = "0.123456 -1.234567 1.345678 -0.456789 1.567891 0.678912 1234.567;0.012345 -0.023456 "
+                               "0.034567 -0.045678 0.056789 -0.067891 12.5;512.2531 -612.5002 365.1254 1.5923 "
+                               "0.2193 -2.0125;";
+  const std::string tcp = "512.2531 -612.5002 365.1254 1.5923 0.2193 -2.0125";
+
+  bench::run("status, split + text tool frame", iterations, [&]() {
+    std::string str = response;
+    str.erase(str.end() - 1, str.end());
+
+    std::vector<std::string> groups;
+    boost::split(groups, str, boost::is_any_of(";"), boost::token_compress_on);
+    std::string joint_state = groups[0];
+    std::string joint_vel = groups[1];
+    std::string tcp_frame = convertToolFrameStrTf2(groups[2]);
+
+    auto pos = util::stringToDoubleVec(joint_state);
+    auto vel = util::stringToDoubleVec(joint_vel);
+    auto frame = util::stringToDoubleVec(tcp_frame);
+    bench::doNotOptimize(pos);
+    bench::doNotOptimize(vel);
+    bench::doNotOptimize(frame);
+  });
+
+  robot_movement_interface::Command cmd_msg;
+  auto status_cmd = keba_rmi_plugin::KebaCommandGetStatus().processMsg(cmd_msg);
+  auto status = static_cast<RobotCommandStatus*>(status_cmd.get());
+  bench::run("status, KebaCommandStatus::updateData", iterations, [&]() {
+    status->updateData(response);
+    bench::doNotOptimize(status->getTcpFrame());
+  });
+
+  bench::run("tool frame text, tf2 matrix", iterations, [&]() {
+    auto str = convertToolFrameStrTf2(tcp);
+    bench::doNotOptimize(str);
+  });
+
+  bench::run("tool frame text, convertToolFrameStr", iterations, [&]() {
+    auto str = keba_rmi_plugin::convertToolFrameStr(tcp);
+    bench::doNotOptimize(str);
+  });
+
+  double frame[6] = { 512.2531, -612.5002, 365.1254, 1.5923, 0.2193, -2.0125 };
+  bench::run("tool frame numbers, tf2 matrix", iterations, [&]() {
+    double yaw, pitch, roll;
+    util::RotationUtils::rotZYZ(frame[3], frame[4], frame[5]).getEulerYPR(yaw, pitch, roll);
+    bench::doNotOptimize(yaw);
+    bench::doNotOptimize(pitch);
+    bench::doNotOptimize(roll);
+    frame[5] += 1e-9;
+  });
+
+  bench::run("tool frame numbers, zyzToZyx", iterations, [&]() {
+    double yaw, pitch, roll;
+    util::RotationUtils::zyzToZyx(frame[3], frame[4], frame[5], yaw, pitch, roll);
+    bench::doNotOptimize(yaw);
+    bench::doNotOptimize(pitch);
+    bench::doNotOptimize(roll);
+    frame[5] += 1e-9;
+  });
+}
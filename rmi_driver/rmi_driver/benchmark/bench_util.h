@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+/**
+ * \brief Small helpers for the rmi_driver_bench microbenchmarks.
+ *
+ * Each benchmark reports the average time and the average number of heap allocations per operation.  Allocations are
+ * counted by replacing the global operator new in bench_main.cpp, so they include every thread in the process.
+ */
+
+#ifndef RMI_DRIVER_BENCHMARK_BENCH_UTIL_H_
+#define RMI_DRIVER_BENCHMARK_BENCH_UTIL_H_
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rmi_driver
+{
+namespace bench
+{
+/// Total number of calls to operator new since the program started
+std::size_t allocCount();
+
+/// Keep the compiler from optimizing away a result
+template <typename T>
+inline void doNotOptimize(T const& value)
+{
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+/**
+ * \brief Time fn and print ns/op and allocs/op.
+ *
+ * fn is called iterations / 10 times first to warm up caches and let reused buffers grow.
+ * @param name Printed with the results
+ * @param iterations Number of timed calls
+ * @param fn The operation
+ */
+void run(const std::string& name, std::size_t iterations, const std::function<void()>& fn);
+
+using BenchFunc = std::function<void()>;
+
+/// All benchmarks registered with RMI_BENCHMARK, in registration order
+std::vector<std::pair<std::string, BenchFunc>>& registry();
+
+struct Registrar
+{
+  Registrar(const std::string& name, BenchFunc fn)
+  {
+    registry().emplace_back(name, std::move(fn));
+  }
+};
+
+}  // namespace bench
+}  // namespace rmi_driver
+
+/// Define and register a benchmark.  It can call bench::run() as many times as needed.
+#define RMI_BENCHMARK(name)                                                                                            \
+  static void name();                                                                                                  \
+  static ::rmi_driver::bench::Registrar name##_registrar(#name, name);                                                 \
+  static void name()
+
+#endif /* RMI_DRIVER_BENCHMARK_BENCH_UTIL_H_ */
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+/**
+ * Compares the text and binary wire formats for a motion command and a status response: the cost to encode/decode each
+ * one and the bytes that go on the wire.  The text params of a command are formatted when it's created, so encoding
+ * it as text only joins strings.
+ */
+
+#include <boost/algorithm/string.hpp>
+#include <cstdio>
+#include "bench_util.h"
+#include "rmi_driver/commands.h"
+#include "rmi_driver/util.h"
+#include "rmi_driver/wire_format.h"
+
+using namespace rmi_driver;
+
+RMI_BENCHMARK(wire_format)
+{
+  const std::size_t iterations = 200000;
+
+  RobotCommand command(RobotCommand::CommandType::Cmd, "ptp joints",
+                       std::vector<float>{ 0.1f, -1.2f, 1.3f, -0.4f, 1.5f, 0.6f, 100.0f });
+  command.addParam("velros", std::vector<float>{ 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f });
+  command.addParam("accros", std::vector<float>{ 1.5f, 1.5f, 1.5f, 1.5f, 1.5f, 1.5f, 1.5f });
+
+  std::string out;
+  command.toWire(out, wire::Format::Text);
+  std::printf("ptp command: %zu bytes as text, ", out.size());
+  command.toWire(out, wire::Format::Binary);
+  std::printf("%zu bytes as binary\n", out.size());
+
+  bench::run("encode ptp text", iterations, [&]() {
+    command.toWire(out, wire::Format::Text);
+    bench::doNotOptimize(out);
+  });
+
+  bench::run("encode ptp binary", iterations, [&]() {
+    command.toWire(out, wire::Format::Binary);
+    bench::doNotOptimize(out);
+  });
+
+  std::vector<double> joints{ 0.1234, -1.2345, 1.3456, -0.4567, 1.5678, 0.6789, 1234.5 };
+  std::vector<double> vels{ 0.01, -0.02, 0.03, -0.04, 0.05, -0.06, 12.5 };
+  std::vector<double> frame{ 512.25, -612.5, 365.125, 1.5708, 0.7854, -3.1416 };
+
+  std::string status_text = util::vecToString(joints, 4) + ";" + util::vecToString(vels, 4) + ";" +
+                            util::vecToString(frame, 4) + ";";
+
+  std::string status_frame;
+  std::size_t offset = wire::beginFrame(status_frame, wire::PayloadKind::Floats);
+  wire::putU8(status_frame, 3);
+  wire::putFloatGroup(status_frame, joints);
+  wire::putFloatGroup(status_frame, vels);
+  wire::putFloatGroup(status_frame, frame);
+  wire::endFrame(status_frame, offset);
+  std::string status_payload = status_frame.substr(wire::kHeaderSize);
+
+  std::printf("status response: %zu bytes as text, %zu bytes as binary\n", status_text.size() + 1,
+              status_frame.size());
+
+  bench::run("decode status text", iterations, [&]() {
+    std::vector<std::string> parts;
+    boost::split(parts, status_text, boost::is_any_of(";"), boost::token_compress_on);
+    auto pos = util::stringToDoubleVec(parts[0]);
+    auto vel = util::stringToDoubleVec(parts[1]);
+    auto tcp = util::stringToDoubleVec(parts[2]);
+    bench::doNotOptimize(pos);
+    bench::doNotOptimize(vel);
+    bench::doNotOptimize(tcp);
+  });
+
+  wire::FloatGroups groups;
+  bench::run("decode status binary", iterations, [&]() {
+    wire::decodeFloats(status_payload, groups);
+    bench::doNotOptimize(groups);
+  });
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+/**
+ * \brief A simulated robot for the benchmarks that run whole Connectors.
+ *
+ * SimRobot answers the Cmd and Get sockets from an io_service, so many of them can share 1 thread.  Cmd commands are
+ * answered right away.
+ */
+
+#ifndef RMI_DRIVER_BENCHMARK_SIM_ROBOT_H_
+#define RMI_DRIVER_BENCHMARK_SIM_ROBOT_H_
+
+#include <dirent.h>
+#include <ros/ros.h>
+#include <sys/resource.h>
+#include <boost/asio.hpp>
+#include <cstdio>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "rmi_driver/connector.h"
+
+namespace rmi_driver
+{
+namespace bench
+{
+using boost::asio::ip::tcp;
+
+static const std::vector<std::string> kSimJoints = { "joint_1", "joint_2", "joint_3", "joint_4",
+                                                     "joint_5", "joint_6", "joint_7" };
+
+/// The commands the Connectors need: the Get loop's JOINT_POSITION, TOOL_FRAME and VERSION and a PTP to send
+class SimCommandRegister : public CommandRegister
+{
+public:
+  void initialize(const std::vector<std::string>& joints) override
+  {
+    registerCommandHandlers();
+  }
+
+  const std::string& getVersion() override
+  {
+    static const std::string version = "0.0.9";
+    return version;
+  }
+
+protected:
+  void registerCommandHandlers() override
+  {
+    robot_movement_interface::Command get;
+    get.command_type = "GET";
+    get.pose_type = "JOINT_POSITION|TOOL_FRAME|VERSION";
+    addHandler(CommandHandler::createHandler(get, [](const robot_movement_interface::Command& msg) {
+      std::string command = "get version";
+      if (msg.pose_type == "JOINT_POSITION")
+        command = "get joint position";
+      else if (msg.pose_type == "TOOL_FRAME")
+        command = "get tool frame";
+      return std::make_shared<RobotCommand>(RobotCommand::CommandType::Get, command, "");
+    }));
+
+    robot_movement_interface::Command ptp;
+    ptp.command_type = "PTP";
+    addHandler(CommandHandler::createHandler(ptp, [](const robot_movement_interface::Command& msg) {
+      return std::make_shared<RobotCommand>(RobotCommand::CommandType::Cmd, "ptp joints",
+                                            RobotCommand::paramsToString(msg.pose));
+    }));
+  }
+};
+
+/// Answers lines on 1 socket until the client closes it
+class SimSession : public std::enable_shared_from_this<SimSession>
+{
+public:
+  explicit SimSession(tcp::socket socket) : socket_(std::move(socket))
+  {
+  }
+
+  void start()
+  {
+    boost::system::error_code ignored;
+    socket_.set_option(tcp::no_delay(true), ignored);
+    read();
+  }
+
+private:
+  void read()
+  {
+    auto self = shared_from_this();
+    boost::asio::async_read_until(socket_, buff_, '\n', [this, self](const boost::system::error_code& ec, std::size_t) {
+      if (ec)
+        return;
+
+      std::istream is(&buff_);
+      std::getline(is, line_);
+
+      if (line_.compare(0, 11, "get version") == 0)
+        reply_ = "0.0.9\n";
+      else if (line_.compare(0, 18, "get joint position") == 0)
+        reply_ = "0.1 0.2 0.3 0.4 0.5 0.6 0.7\n";
+      else if (line_.compare(0, 14, "get tool frame") == 0)
+        reply_ = "100 200 300 10 20 30\n";
+      else
+        reply_ = "done\n";
+
+      boost::asio::async_write(socket_, boost::asio::buffer(reply_),
+                               [this, self](const boost::system::error_code& ec, std::size_t) {
+                                 if (!ec)
+                                   read();
+                               });
+    });
+  }
+
+  tcp::socket socket_;
+  boost::asio::streambuf buff_;
+  std::string line_;
+  std::string reply_;
+};
+
+/// A robot listening on port() (Cmd) and port() + 1 (Get)
+class SimRobot
+{
+public:
+  explicit SimRobot(boost::asio::io_service& io_service)
+    : io_service_(io_service), cmd_acceptor_(io_service), get_acceptor_(io_service)
+  {
+    // Find a free pair of ports
+    while (true)
+    {
+      tcp::endpoint any(boost::asio::ip::address_v4::loopback(), 0);
+      cmd_acceptor_.open(any.protocol());
+      cmd_acceptor_.bind(any);
+
+      boost::system::error_code ec;
+      tcp::endpoint next(any.address(), port() + 1);
+      get_acceptor_.open(next.protocol());
+      get_acceptor_.bind(next, ec);
+      if (!ec)
+        break;
+
+      cmd_acceptor_.close();
+      get_acceptor_.close();
+    }
+
+    cmd_acceptor_.listen();
+    get_acceptor_.listen();
+    accept(cmd_acceptor_);
+    accept(get_acceptor_);
+  }
+
+  unsigned short port() const
+  {
+    return cmd_acceptor_.local_endpoint().port();
+  }
+
+private:
+  void accept(tcp::acceptor& acceptor)
+  {
+    auto socket = std::make_shared<tcp::socket>(io_service_);
+    acceptor.async_accept(*socket, [this, &acceptor, socket](const boost::system::error_code& ec) {
+      if (ec)
+        return;
+
+      std::make_shared<SimSession>(std::move(*socket))->start();
+      accept(acceptor);
+    });
+  }
+
+  boost::asio::io_service& io_service_;
+  tcp::acceptor cmd_acceptor_;
+  tcp::acceptor get_acceptor_;
+};
+
+/// Number of threads in this process
+inline int threadCount()
+{
+  int count = 0;
+  if (DIR* dir = opendir("/proc/self/task"))
+  {
+    while (dirent* entry = readdir(dir))
+      if (entry->d_name[0] != '.')
+        ++count;
+    closedir(dir);
+  }
+  return count;
+}
+
+/// User + system CPU time used by this process
+inline double cpuSeconds()
+{
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+
+/**
+ * \brief Init ROS for the benchmarks that need a Connector and turn off the INFO logging of every command.
+ * @return False if there's no ROS master
+ */
+inline bool initRos()
+{
+  if (!ros::isInitialized())
+  {
+    int argc = 0;
+    ros::init(argc, nullptr, "rmi_driver_bench", ros::init_options::AnonymousName | ros::init_options::NoSigintHandler);
+  }
+
+  if (!ros::master::check())
+  {
+    std::printf("skipped: the Connectors need a ROS master\n");
+    return false;
+  }
+
+  if (ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Warn))
+    ros::console::notifyLoggerLevelsChanged();
+
+  return true;
+}
+
+}  // namespace bench
+}  // namespace rmi_driver
+
+#endif /* RMI_DRIVER_BENCHMARK_SIM_ROBOT_H_ */
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+#ifndef INCLUDE_RMI_DRIVER_COMMAND_LIST_CONVERTER_H_
+#define INCLUDE_RMI_DRIVER_COMMAND_LIST_CONVERTER_H_
+
+#include <robot_movement_interface/CommandList.h>
+#include <boost/asio.hpp>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "rmi_driver/commands.h"
+
+namespace rmi_driver
+{
+/**
+ * \brief Turns a CommandList into RobotCommands in chunks on a pool of worker threads.
+ *
+ * The caller converts the first chunk itself while the workers convert the rest, and gets the chunks back in order as
+ * soon as each one is ready.  So the first commands can be queued long before a 10k point list is done.
+ *
+ * CommandHandler::processMsg is called from several threads at once, so the handlers must not change any shared state.
+ */
+class CommandListConverter
+{
+public:
+  /// Called on the thread that called convert(), once per chunk, in order.  Return false to stop.
+  using ChunkCallback = std::function<bool(std::vector<RobotCommandPtr>& commands)>;
+
+  /**
+   * @param threads Number of worker threads.  At least 1.
+   * @param chunk_size Number of messages per chunk.  At least 1.
+   */
+  CommandListConverter(int threads, std::size_t chunk_size);
+
+  /// Joins the workers.  Must not be called while convert() is running.
+  ~CommandListConverter();
+
+  CommandListConverter(const CommandListConverter&) = delete;
+  CommandListConverter& operator=(const CommandListConverter&) = delete;
+
+  int getThreads() const
+  {
+    return static_cast<int>(threads_.size());
+  }
+
+  std::size_t getChunkSize() const
+  {
+    return chunk_size_;
+  }
+
+  /**
+   * \brief Convert every message of msg with its handler.
+   *
+   * Each RobotCommand gets the command_id of its message, and the text of Cmd commands is formatted on the worker, so
+   * Connector::addCommand doesn't have to.  Messages without a handler are skipped.  Only 1 convert() may run at a
+   * time.
+   *
+   * @param msg The list
+   * @param handlers The handler of each message in msg, or nullptr to skip it.  Same size as msg.commands.
+   * @param on_chunk Gets the commands of each chunk in order.  Chunks after one that failed are thrown away.
+   * @param failed_index [out] Optional.  Index in msg.commands of the message whose handler failed, or
+   * msg.commands.size() if none did.
+   * @return False if a handler returned nullptr or threw, or on_chunk returned false.  Every worker is done with msg
+   * and handlers when it returns.
+   */
+  bool convert(const robot_movement_interface::CommandList& msg, const std::vector<const CommandHandler*>& handlers,
+               const ChunkCallback& on_chunk, std::size_t* failed_index = nullptr);
+
+protected:
+  /// Called by convert() for every chunk.  Stops early if another chunk failed.  Sets failed_index if a handler fails.
+  static bool convertChunk(const robot_movement_interface::CommandList& msg,
+                           const std::vector<const CommandHandler*>& handlers, std::size_t begin, std::size_t end,
+                           const std::atomic<bool>& failed, std::vector<RobotCommandPtr>& out,
+                           std::size_t& failed_index);
+
+  boost::asio::io_service io_service_;
+  std::unique_ptr<boost::asio::io_service::work> work_;
+  std::vector<std::thread> threads_;
+  std::size_t chunk_size_;
+};
+
+}  // namespace rmi_driver
+
+#endif /* INCLUDE_RMI_DRIVER_COMMAND_LIST_CONVERTER_H_ */
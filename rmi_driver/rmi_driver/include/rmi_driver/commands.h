@@ -37,7 +37,16 @@
 #include <control_msgs/FollowJointTrajectoryAction.h>
 //#include <rmi_driver/joint_trajectory_action.h>
 
+#include <rmi_driver/fixed_vector.h>
+#include <rmi_driver/pool_allocator.h>
+#include <rmi_driver/wire_format.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 
 namespace rmi_driver
 {
@@ -48,6 +57,9 @@ struct CommandResultCodes
     OK = 0,
     FAILED_TO_FIND_HANDLER = 1,
     SOCKET_FAILED_TO_CONNECT = 2,
+    QUEUE_FULL = 3,
+    CONNECTION_LOST = 4,
+    FAILED_TO_PROCESS = 5,
     ABORT_FAIL = 9998,
     ABORT_OK = 9999,
 
@@ -61,6 +73,9 @@ struct CommandResultCodes
  * command string (with optional values) is required.  Additional parameter pairs can be added.  toString is used to
  * create the actual string to the robot.  << is overridden for easier stream console output.
  *
+ * The names are interned and the values of every entry share 1 buffer, so a command only makes a few allocations.  Use
+ * makeRobotCommand() instead of std::make_shared to take the command itself from a pool.
+ *
  * Default string format:
  * \code
  * <command>[ : <values>]; [<param>[ : <values>];]
@@ -74,10 +89,10 @@ struct CommandResultCodes
 class RobotCommand
 {
 public:
-  //! Each entry is stored as a pair<string, string>
+  //! An entry as a pair<name, values>.  See getFullCommand()
   using CommandEntry = std::pair<std::string, std::string>;
 
-  //! The full command with all optional params is stored in a vector.  Entry [0] is the actual command.
+  //! The full command with all optional params.  Entry [0] is the actual command.
   using FullCommand = std::vector<CommandEntry>;
 
   /// Choose which socket to send over.  Cmd will be added to the command queue.  Get will be sent immediately.
@@ -99,29 +114,41 @@ public:
 
   RobotCommand(CommandType type, const std::string& command, const std::vector<float>& floatVec) : type_(type)
   {
-    makeCommand(type, command, RobotCommand::paramsToString(floatVec));
+    setCommand(command, floatVec);
   }
 
   RobotCommand(const RobotCommand& other)
   {
     this->command_id_ = other.command_id_;
-    this->full_command_ = other.full_command_;
+    this->entries_ = other.entries_;
+    this->text_values_ = other.text_values_;
+    this->values_ = other.values_;
+    this->owned_names_ = other.owned_names_;
     this->type_ = other.type_;
+    this->text_ = other.text_;
+    this->text_valid_ = other.text_valid_;
   }
 
   RobotCommand(RobotCommand&& other)
-    : full_command_(std::move(other.full_command_)), type_(other.type_), command_id_(other.command_id_)
+    : entries_(std::move(other.entries_))
+    , text_values_(std::move(other.text_values_))
+    , values_(std::move(other.values_))
+    , owned_names_(std::move(other.owned_names_))
+    , type_(other.type_)
+    , command_id_(other.command_id_)
+    , text_(std::move(other.text_))
+    , text_valid_(other.text_valid_)
   {
   }
 
   /**
    * \brief Sets up the command.
    *
-   * Sets the first element of full_command_ to (command, params).  It can optionally remove all existing parameters.
+   * Sets the first entry to (command, params).  It can optionally remove all existing parameters.
    * @param type Cmd or Get
    * @param command command string
    * @param command_vals parameters for the command
-   * @param erase_params erase the full_command_ before setting
+   * @param erase_params erase all the entries before setting
    */
   void makeCommand(CommandType type, std::string command, std::string command_vals, bool erase_params = false);
 
@@ -141,6 +168,15 @@ public:
     makeCommand(type_, command, command_vals);
   }
 
+  /**
+   * Sets the command and numeric values.  The values are kept so the command can be sent in the binary wire format.
+   *
+   * @param command command string
+   * @param values parameters for the command
+   * @param precision Digits used in the text format.  See paramsToString()
+   */
+  void setCommand(std::string command, const std::vector<float>& values, int precision = 4);
+
   /**
    * Add a parameter and values
    *
@@ -149,6 +185,15 @@ public:
    */
   void addParam(std::string param, std::string param_vals);
 
+  /**
+   * Add a parameter and numeric values.  See setCommand(std::string, const std::vector<float>&, int)
+   *
+   * @param param
+   * @param values
+   * @param precision Digits used in the text format
+   */
+  void addParam(std::string param, const std::vector<float>& values, int precision = 4);
+
   /**
    * \brief Prepare the string to send to the robot.
    *
@@ -156,10 +201,54 @@ public:
    *
    * @todo rethink this now that option params can be entered.  Or just make it virtual and leave it for someone else to
    * think about!
+   * Override this to change the format.  getText() and Connector::sendGetCommand() call it.
+   *
    * @return The full, formatted string that will be send to the robot
    */
   virtual std::string toString(bool append_newline = true) const;
 
+  /**
+   * \brief The string to send to the robot, with the '\n'.  Made by toString() the first time and kept.
+   *
+   * makeCommand() and addParam() throw it away.  A subclass that changes what toString() produces some other way has
+   * to call invalidateText().  The first call isn't thread safe, so Connector::addCommand() makes it before the command
+   * is queued.
+   */
+  const std::string& getText() const;
+
+  /**
+   * \brief The data to write in the socket's format.  The text format is getText() itself, so it isn't copied.
+   * @param scratch [out] Filled by toWire() if the format isn't text
+   * @param format The socket's format
+   * @return getText() or scratch
+   */
+  const std::string& wireData(std::string& scratch, wire::Format format) const
+  {
+    if (format == wire::Format::Text)
+      return getText();
+
+    toWire(scratch, format);
+    return scratch;
+  }
+
+  /**
+   * \brief Encode a command as a binary Command payload.  See wire::PayloadKind
+   *
+   * Only possible if every param was given as numbers.  Override it to use a different layout.
+   * @param out [out] A whole frame is appended
+   * @return false if it can't be encoded.  out is unchanged.
+   */
+  virtual bool toBinary(std::string& out) const;
+
+  /**
+   * \brief Prepare the data to send to the robot in the format the socket is using.
+   *
+   * Binary commands that can't be encoded by toBinary() are sent in a Text frame.
+   * @param out [out] Replaced with the data to write
+   * @param format The socket's format
+   */
+  void toWire(std::string& out, wire::Format format) const;
+
   /**
    * \brief Check the response of a command.  It will call processResponse()
    *
@@ -180,6 +269,34 @@ public:
   {
   }
 
+  /**
+   * \brief Check a binary Floats response.  It will call processResponse(wire::FloatGroups&)
+   *
+   * @param groups The decoded response
+   * @return True if the response is OK.  By default it only has to have some values.
+   */
+  virtual bool checkResponse(wire::FloatGroups& groups) const;
+
+  /**
+   * \brief Modify a binary response as needed.  The binary version of processResponse(std::string&)
+   *
+   * @param groups [in,out]
+   */
+  virtual void processResponse(wire::FloatGroups& groups) const
+  {
+  }
+
+  /**
+   * \brief True if processResponse(wire::FloatGroups&) does the same conversion as processResponse(std::string&).
+   *
+   * Then the Connector can parse a text response into numbers first and convert those, instead of converting the text
+   * and parsing it afterwards.  False by default, so a plugin that only overrides the text version keeps working.
+   */
+  virtual bool hasNumericConversion() const
+  {
+    return false;
+  }
+
   /**
    * Converts a float vector into a string of values separated by spaces.  Removes trailing zeroes
    *
@@ -197,8 +314,11 @@ public:
    */
   virtual std::ostream& dump(std::ostream& o) const
   {
-    std::string str = toString(false);
-    o << str;
+    const std::string& text = getText();
+    std::size_t length = text.length();
+    if (length > 0 && text[length - 1] == '\n')
+      --length;
+    o.write(text.data(), length);
     return o;
   }
 
@@ -206,27 +326,139 @@ public:
 
   CommandType getType() const;
   void setType(CommandType type);
-  std::string getCommand() const;
+  /// The first command name, like "ptp".  Empty if there isn't one.
+  const std::string& getCommand() const;
+
+  /// Copy of every entry as strings, for plugins that need to look at the params
+  FullCommand getFullCommand() const;
 
   int getCommandId() const;
   void setCommandId(int commandId);
 
+  /// When it was added to a Connector's queue.  Used for the queue wait in LatencyStats.  Not copied.
+  std::chrono::steady_clock::time_point getQueuedTime() const
+  {
+    return queued_time_;
+  }
+  void setQueuedTime(std::chrono::steady_clock::time_point time)
+  {
+    queued_time_ = time;
+  }
+
 protected:
-  FullCommand full_command_;
+  /// Call if what toString() produces changed without makeCommand() or addParam()
+  void invalidateText()
+  {
+    text_valid_ = false;
+  }
+
+  /**
+   * \brief Replace every entry.  For subclasses that used to edit the old full_command_ member.
+   *
+   * Use with getFullCommand() to change entries in place.  The values are kept as text, so toBinary() won't make a
+   * binary frame of it.
+   * @param full_command Entry [0] is the command, the rest are params
+   */
+  void setFullCommand(const FullCommand& full_command);
+
+  /**
+   * \brief The default format, in a caller owned buffer.  Used by the default toString(bool).
+   *
+   * @param out [out] Replaced with the formatted string
+   * @param append_newline Add a '\n'
+   */
+  void formatText(std::string& out, bool append_newline) const;
+
+  /// 1 command or param.  The values are ranges of text_values_ and values_.
+  struct Entry
+  {
+    const std::string* name;  ///< From makeName()
+    std::uint32_t text_begin;
+    std::uint32_t text_end;
+    std::uint32_t values_begin;  ///< The numbers, if they were given as numbers.  Used by toBinary()
+    std::uint32_t values_end;
+  };
+
+  /// internName() keeps at most this many names
+  static constexpr std::size_t kMaxInternedNames = 1024;
+
+  /**
+   * \brief The copy of name that lives until the end of the program.  Thread safe.
+   *
+   * Every name is kept once.  Names can come from a message, so there are at most kMaxInternedNames.
+   * @return nullptr if name is new and the table is full
+   */
+  static const std::string* internName(const std::string& name);
+
+  /// internName(), or a copy in owned_names_ if the table is full
+  const std::string* makeName(const std::string& name);
+
+  /// Append an entry's values to the buffers
+  Entry makeEntry(const std::string& name, const std::string& text);
+  Entry makeEntry(const std::string& name, const std::vector<float>& values, int precision);
+
+  /// Set entry [0], or add it if there isn't one
+  void setFirstEntry(const Entry& entry);
+
+  /// Entry [0] is the command, the rest are params
+  std::vector<Entry> entries_;
+
+  /// The values of every entry as text, back to back
+  std::string text_values_;
+
+  /// The numeric values of every entry, back to back
+  std::vector<float> values_;
+
+  /// Names that didn't fit in internName().  Shared, so a copy of the command can keep using them.
+  std::vector<std::shared_ptr<const std::string>> owned_names_;
 
   /// Used in the /command_result response
   int command_id_ = 0;
 
   CommandType type_;
+
+  std::chrono::steady_clock::time_point queued_time_;
+
+  /// See getText()
+  mutable std::string text_;
+  mutable bool text_valid_ = false;
 };
 
+/**
+ * \brief The status Get.  Updates the joints, joint velocities and tcp frame with 1 request.
+ *
+ * A binary response has 3 groups in the same order as the text response: joint positions, joint velocities, tcp frame.
+ */
 class RobotCommandStatus : public RobotCommand
 {
+public:
+  /// Max number of values in 1 group of the response
+  static constexpr std::size_t kMaxValues = 16;
+
+  /// 1 group of the response.  Fixed size so a status update never allocates.
+  using Values = util::FixedVector<double, kMaxValues>;
+
 protected:
+  Values joint_positions_;
+  Values joint_velocities_;
+  Values tcp_frame_;
+
+  /**
+   * \brief Parse a text response "positions;velocities;tcp frame" straight into the 3 groups.
+   *
+   * A trailing ';' is optional.  Nothing is copied out of the response.
+   * @return false if it doesn't have exactly 3 groups of numbers
+   */
+  bool parseGroups(const std::string& response);
+
+  /// Filled by the deprecated getLast*() getters
   std::string last_joint_state;
   std::string last_joint_vel;
   std::string last_tcp_frame;
 
+  /// Format a group like the robot sends it, for the deprecated getters.  @return out
+  static const std::string& groupToString(const Values& group, std::string& out);
+
 public:
   RobotCommandStatus(CommandType type = CommandType::Cmd) : RobotCommand(type)
   {
@@ -241,23 +473,60 @@ public:
   {
   }
 
-  virtual void updateData(std::string& response)
+  /**
+   * \brief Update getJointPositions(), getJointVelocities() and getTcpFrame() from a text response.
+   *
+   * The default parses the groups with parseGroups().  Plugins can override it to convert the values too.
+   * @return false if the response couldn't be parsed
+   */
+  virtual bool updateData(const std::string& response)
+  {
+    return parseGroups(response);
+  }
+
+  /**
+   * \brief Deprecated.  Calls updateData(const std::string&).
+   *
+   * It's final so a plugin that still overrides the old signature fails to build instead of never being called.
+   * Override updateData(const std::string&) instead.
+   */
+  virtual bool updateData(std::string& response) final
+  {
+    return updateData(static_cast<const std::string&>(response));
+  }
+
+  const Values& getJointPositions() const
+  {
+    return joint_positions_;
+  }
+
+  const Values& getJointVelocities() const
   {
+    return joint_velocities_;
   }
 
+  /// x y z alpha beta gamma
+  const Values& getTcpFrame() const
+  {
+    return tcp_frame_;
+  }
+
+  /// Deprecated.  getJointPositions() as text.
   const std::string& getLastJointState()
   {
-    return last_joint_state;
+    return groupToString(joint_positions_, last_joint_state);
   }
 
+  /// Deprecated.  getJointVelocities() as text.
   const std::string& getLastJointVel()
   {
-    return last_joint_vel;
+    return groupToString(joint_velocities_, last_joint_vel);
   }
 
+  /// Deprecated.  getTcpFrame() as text.
   const std::string& getLastTcpFrame()
   {
-    return last_tcp_frame;
+    return groupToString(tcp_frame_, last_tcp_frame);
   }
 };
 
@@ -277,6 +546,18 @@ class CommandHandler;
 class CommandRegister;
 using RobotCommandPtr = std::shared_ptr<RobotCommand>;
 
+/**
+ * \brief std::make_shared for RobotCommands, with the memory from a util::BlockPool.
+ *
+ * A command and its shared_ptr control block go back to the pool when the last pointer is gone, so the next one made
+ * doesn't hit the heap.
+ */
+template <typename T, typename... Args>
+std::shared_ptr<T> makeRobotCommand(Args&&... args)
+{
+  return std::allocate_shared<T>(util::PoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
 /**
  * \brief Handle robot_movement_interface::Command and create Commands that are ready to send to the robot.
  *
@@ -362,6 +643,59 @@ public:
    */
   bool operator==(const robot_movement_interface::Command& cmd_msg);
 
+  /**
+   * \brief Split the sample's "A|B|C" strings and round its sizes once, so matching doesn't have to.
+   *
+   * Called by CommandRegister::addHandler after initialize().  operator== calls it the first time if it wasn't.
+   */
+  void compileSample();
+
+  /**
+   * \brief Check every field except command_type and pose_type, which the CommandRegister's dispatch index matched.
+   * @param cmd_msg The message received from the command_list topic
+   * @param pose_type_index Entry of the sample's pose_type that matched.  0 if the sample doesn't use it.
+   * @return True if it's a match
+   */
+  bool matchRemaining(const robot_movement_interface::Command& cmd_msg, int pose_type_index) const;
+
+  /**
+   * \brief 1 string field of a compiled sample and the sizes that go with its entries.
+   *
+   * Same rules as util::usedAndNotEqual and util::usedAndNotEqualIdx.
+   */
+  struct SampleField
+  {
+    std::vector<std::string> entries;  ///< Split at '|', empty entries kept.  Empty if the string isn't used.
+    std::vector<long> sizes;           ///< Empty if the vector isn't used
+
+    void compile(const std::string& sample_str, const std::vector<float>& sample_sizes = std::vector<float>());
+
+    /// @return Index of the first entry equal to msg, 0 if the string isn't used, -1 if nothing matches
+    int find(const std::string& msg) const;
+
+    /// @return True if the sizes aren't used or sizes[entry_index] == size
+    bool sizeMatches(int entry_index, std::size_t size) const;
+
+    /// find() and sizeMatches() together
+    bool matches(const std::string& msg, std::size_t size) const
+    {
+      int idx = find(msg);
+      return idx >= 0 && sizeMatches(idx, size);
+    }
+  };
+
+  /// The compiled command_type.  compileSample() has to have been called.
+  const SampleField& getCommandTypeField() const
+  {
+    return match_command_type_;
+  }
+
+  /// The compiled pose_type and pose sizes.  compileSample() has to have been called.
+  const SampleField& getPoseField() const
+  {
+    return match_pose_;
+  }
+
   /**
    * \brief Processes a robot_movement_interface::Command.  Override this method in extended classes.
    *
@@ -419,6 +753,17 @@ protected:
 
   /// The function to call when constructed by a lambda.
   CommandHandlerFunc process_func_ = nullptr;
+
+  /// sample_command_ compiled by compileSample()
+  bool compiled_ = false;
+  SampleField match_command_type_;
+  SampleField match_pose_reference_;
+  SampleField match_pose_;
+  SampleField match_velocity_;
+  SampleField match_acceleration_;
+  SampleField match_force_threshold_;
+  SampleField match_effort_;
+  SampleField match_blending_;
 };
 
 /**
@@ -458,12 +803,43 @@ public:
    * first/last
    * points, to set any required settings or waits.
    *
+   * JointTrajectoryAction calls this one through processJta(joint_trajectory, mapping), unless usesPointHooks() is
+   * true.
+   *
    * @param joint_trajectory The full JointTrajectory message, with all values sorted in the same order as in this
    * driver.
    * @return The assembled CommandList to send
    */
   virtual robot_movement_interface::CommandList processJta(const trajectory_msgs::JointTrajectory& joint_trajectory);
 
+  /**
+   * \brief processJta() for a trajectory whose joints aren't in this driver's order.
+   *
+   * JointTrajectoryAction uses this one.  By default it sorts a copy of the trajectory and calls
+   * processJta(joint_trajectory).  If usesPointHooks() is true, each point is sorted into the same scratch point right
+   * before it's handed to processFirstJtaPoint(), processJtaPoint() or processLastJtaPoint() instead, so it only
+   * allocates for the CommandList.
+   *
+   * \exception std::runtime_error if a point doesn't have 1 value per joint
+   *
+   * @param joint_trajectory The full JointTrajectory message, in any order
+   * @param mapping mapping[n] is the index of this driver's joint n in joint_trajectory
+   * @return The assembled CommandList to send
+   */
+  robot_movement_interface::CommandList processJta(const trajectory_msgs::JointTrajectory& joint_trajectory,
+                                                   const std::vector<size_t>& mapping);
+
+  /**
+   * \brief True if processJta(joint_trajectory) isn't overridden, so the point hooks make the whole CommandList.
+   *
+   * Lets processJta(joint_trajectory, mapping) skip the sorted copy of the trajectory.  Override it to return true
+   * only if processJta(joint_trajectory) is the default one.
+   */
+  virtual bool usesPointHooks() const
+  {
+    return false;
+  }
+
   /**
    * \brief Process a point and append a Command to cmd_list.
    *
@@ -554,6 +930,58 @@ public:
    */
   virtual const std::string& getVersion() = 0;
 
+  /**
+   * \brief Set the wire format this connection would like to use.  Set by the Driver from the connection config.
+   *
+   * It's only a request.  negotiateWireFormat() decides.
+   */
+  void setRequestedWireFormat(wire::Format format)
+  {
+    requested_wire_format_ = format;
+  }
+
+  wire::Format getRequestedWireFormat() const
+  {
+    return requested_wire_format_;
+  }
+
+  /**
+   * \brief Pick the wire format for this connection after the version check.
+   *
+   * The base register always stays with text.  Plugins that support binary framing should check that it was requested
+   * and that the robot supports it.
+   * @param version_response What the robot returned for the VERSION Get
+   * @return The format to switch to
+   */
+  virtual wire::Format negotiateWireFormat(const std::string& version_response) const
+  {
+    return wire::Format::Text;
+  }
+
+  /**
+   * \brief Make the command that tells the robot to switch a socket to format.
+   *
+   * It's sent in the current format.  When it's answered OK, both sides use the new format on that socket.
+   * @return nullptr if it isn't supported
+   */
+  virtual RobotCommandPtr makeWireFormatCommand(wire::Format format) const
+  {
+    return nullptr;
+  }
+
+  /**
+   * \brief Make the Get command that asks the robot to push the status at rate on the socket it's sent on.
+   *
+   * After it's answered OK, the robot sends "<seq>;<status>" lines with the same layout as the STATUS response.  In the
+   * binary format each push is a Floats payload with the seq as the first group, followed by the status groups.  seq
+   * counts up by 1 for each push and wraps at 2^24.
+   * @return nullptr if it isn't supported
+   */
+  virtual RobotCommandPtr makeStatusStreamCommand(double rate) const
+  {
+    return nullptr;
+  }
+
   /**
    * \brief Add a CommandHandler.  This will std::move a handler into the vector.
    *
@@ -564,6 +992,7 @@ public:
     command_handlers_.push_back(std::move(handler));
     command_handlers_.back()->setCommandRegister(this);
     command_handlers_.back()->initialize();
+    indexHandlers();
   }
 
   /**
@@ -579,6 +1008,7 @@ public:
     command_handlers_.emplace_back(new T);
     command_handlers_.back()->setCommandRegister(this);
     command_handlers_.back()->initialize();
+    indexHandlers();
   }
 
   /**
@@ -590,6 +1020,7 @@ public:
     command_handlers_.emplace_back(new CommandHandler(handler));
     command_handlers_.back()->setCommandRegister(this);
     command_handlers_.back()->initialize();
+    indexHandlers();
   }
 
   /**
@@ -604,10 +1035,12 @@ public:
   /**
    * Search through the registered command handlers to find one that matches this message
    *
+   * \details Looks up the handlers that can match the command_type and pose_type in the dispatch index, then checks the
+   * rest of their criteria in the order they were added.  Same result as checking every handler with operator==.
    * @param msg_cmd robot_movement_interface::Command that was received
    * @return const CommandHandler* that matched the msg_cmd.  nullptr if no match found
    */
-  const CommandHandler* findHandler(const robot_movement_interface::Command& msg_cmd);
+  const CommandHandler* findHandler(const robot_movement_interface::Command& msg_cmd) const;
 
   /**
    * \brief Get the configured command handler.
@@ -639,10 +1072,30 @@ protected:
    */
   virtual void registerCommandHandlers() = 0;
 
-  /// Vector of all registered command handlers
+  /// Vector of all registered command handlers.  Add them with addHandler so findHandler can find them.
   CommandHandlerPtrVec command_handlers_;
 
+  /// Handlers that can match 1 command_type, by pose_type.  Each list is in the order the handlers were added.
+  struct DispatchEntry
+  {
+    /// A handler and the index of the sample pose_type entry the key matched
+    using Candidates = std::vector<std::pair<const CommandHandler*, int>>;
+
+    std::unordered_map<std::string, Candidates> by_pose_type;
+    Candidates other_pose_types;  ///< Handlers that don't check pose_type
+  };
+
+  /// Compile the new handlers and rebuild the dispatch index.  Called by addHandler.
+  void indexHandlers();
+
+  /// findHandler's index by command_type
+  std::unordered_map<std::string, DispatchEntry> dispatch_;
+  DispatchEntry dispatch_other_;  ///< Command types no sample names
+
   std::unique_ptr<JtaCommandHandler> jta_command_handler_ = std::unique_ptr<JtaCommandHandler>(new JtaCommandHandler);
+
+  /// See setRequestedWireFormat()
+  wire::Format requested_wire_format_ = wire::Format::Text;
 };
 
 using CommandRegisterPtr = std::shared_ptr<CommandRegister>;
@@ -31,8 +31,14 @@
 #define INCLUDE_CONNECTOR_H_
 
 #include <ros/ros.h>
+#include "rmi_driver/command_list_converter.h"
 #include "rmi_driver/commands.h"
+#include "rmi_driver/fixed_vector.h"
 #include "rmi_driver/rmi_logger.h"
+#include "rmi_driver/socket_channel.h"
+#include "rmi_driver/spsc_ring.h"
+#include "rmi_driver/state_snapshot.h"
+#include "rmi_driver/wire_format.h"
 
 #include <robot_movement_interface/EulerFrame.h>
 #include <robot_movement_interface/Result.h>
@@ -44,7 +50,11 @@
 
 #include <pluginlib/class_loader.h>
 #include <boost/asio.hpp>
+#include <boost/asio/coroutine.hpp>
+#include <atomic>
 #include <chrono>
+#include <deque>
+#include <functional>
 #include <future>
 #include <memory>
 #include <mutex>
@@ -52,7 +62,9 @@
 #include <string>
 #include <thread>
 
+#include <diagnostic_msgs/DiagnosticStatus.h>
 #include <robot_movement_interface/CommandList.h>
+#include "rmi_driver/latency_stats.h"
 #include "rmi_driver/rmi_config.h"
 
 namespace rmi_driver
@@ -72,8 +84,13 @@ class Connector
   typedef std::vector<std::string> StringVec;
 
 public:
+  /**
+   * @param con_cfg Optional per connection tuning (pipelining, etc).  ns/host/port/joints are taken from the other
+   * params.
+   */
   Connector(std::string ns, boost::asio::io_service& io_service, std::string host, int port, StringVec joint_names,
-            CmdRegLoaderPtr cmd_reg_loader, CommandRegisterPtr cmd_register, bool clear_commands_on_error);
+            CmdRegLoaderPtr cmd_reg_loader, CommandRegisterPtr cmd_register, bool clear_commands_on_error,
+            const ConnectionConfig& con_cfg = ConnectionConfig());
 
   virtual ~Connector()
   {
@@ -103,26 +120,53 @@ public:
   /**
    * \brief Sends a command.
    *
-   * It will choose the socket to used based on the command type.
+   * It will choose the socket to used based on the command type.  Get commands are handed to the Get loop, which
+   * sends them before the next poll.  Get commands must not be sent from the io_service thread.
    * @param command a rmi_driver::RobotCommand to send
    * @return the reply from the socket.
    */
   std::string sendCommand(const RobotCommand& command);
 
+  /**
+   * \brief Sends a command and stores the reply in a caller owned buffer.
+   *
+   * Cmd commands reuse the Cmd socket's buffers, so this doesn't allocate once response has grown to the size of the
+   * replies.
+   * @param command a rmi_driver::RobotCommand to send
+   * @param response [out] the reply from the socket
+   */
+  void sendCommand(const RobotCommand& command, std::string& response);
+
   /**
    * Adds a command to the queue.  Currently only takes Cmd type
    *
+   * The queue has a single producer.  This must only be called from the thread that receives the command_list topic.
+   *
    * @param command a RobotCommand shared pointer
+   * @return False if the queue is full or the type is wrong
    */
-  void addCommand(RobotCommandPtr command);
+  bool addCommand(RobotCommandPtr command);
 
   /**
    * \brief Erase the command queue.
    *
-   * This does NOT abort commands that are already executing on the robot.
+   * This does NOT abort commands that are already executing on the robot.  It doesn't block and can be called from any
+   * thread.  The Cmd thread releases the commands the next time it looks at the queue.
    */
   void clearCommands();
 
+  /// Number of commands waiting to be sent
+  size_t getQueueDepth() const
+  {
+    return command_queue_.size();
+  }
+
+  /// Largest number of commands that have been waiting to be sent at once
+  size_t getQueueHighWater() const
+  {
+    return command_queue_.highWater();
+  }
+
   void subCB_CommandList(const robot_movement_interface::CommandListConstPtr& msg)
   {
     commandListCb(*msg);
@@ -134,23 +178,121 @@ public:
    * if replace_previous_commands is set, it will clear the queue.
    * It will search through the registered command handlers for each message in the CommandList.
    * If a handler is found, the handler will create a rmi_driver::RobotCommand and store it.  If the entire CommandList
-   * is processed successfully, the commands will be added to command_list_ so that cmdThread can send them to the
+   * is processed successfully, the commands will be added to command_queue_ so that cmdThread can send them to the
    * robot.
    *
    * For a normal Cmd type, it will add it to the queue to be sent later.
    * For a high priority Get type, it will clear the queue, then
    * send it immediately.   This is useful for things like ABORT.   *
    *
+   * With ingest_threads set, lists longer than ingest_chunk_size go to commandListCbParallel() instead.
+   *
    * @param msg received from the /command_list topic
    * @return true
    */
   bool commandListCb(const robot_movement_interface::CommandList& msg);
 
-  sensor_msgs::JointState getLastJointState()
+  /**
+   * \brief The latest robot state from the Get loop as 1 coherent sample.
+   *
+   * Never blocks the Get loop.  Can be called from any thread.
+   */
+  RobotStateSample getStateSample() const
+  {
+    return state_snapshot_.load();
+  }
+
+  /// True while the robot state is pushed by the robot instead of polled.  See startStatusStream()
+  bool isStatusStreaming() const
+  {
+    return streaming_;
+  }
+
+  /// Number of pushed statuses the robot skipped, going by the sequence numbers
+  uint64_t getStatusStreamGaps() const
   {
-    return last_joint_state_;
+    return stream_gaps_;
   }
 
+  /// Number of pushed statuses that were dropped because they were repeated or out of order
+  uint64_t getStatusStreamStale() const
+  {
+    return stream_stale_;
+  }
+
+  /// Counters for 1 item of the Get loop's schedule.  See getGetItemStats()
+  struct GetItemStats
+  {
+    std::string name;   ///< The GET pose type
+    double rate;        ///< Hz.  0 == as fast as the robot answers.
+    uint64_t polls;     ///< Number of times it was sent
+    uint64_t overruns;  ///< Number of times it was sent more than 1 period late
+  };
+
+  /// The items the Get loop polls and their counters.  Can be called from any thread.
+  std::vector<GetItemStats> getGetItemStats() const;
+
+  /**
+   * \brief The latest response of an auxiliary Get item, from get_rates in the config.
+   * @param name The GET pose type
+   * @return "" if it isn't polled or hasn't been answered yet
+   */
+  std::string getAuxResponse(const std::string& name) const;
+
+  /// Round trip times of each command sent on the Cmd and Get sockets, by RobotCommand::getCommand()
+  const LatencyStats& getLatencyStats() const
+  {
+    return latency_stats_;
+  }
+
+  /**
+   * \brief Add the latency percentiles, Get loop counters and status stream counters to a diagnostics message.
+   *
+   * The percentiles cover everything since the Connector was created.  Can be called from any thread.
+   * @param status [out] 1 entry is added for the Get loop and 1 for each command name
+   */
+  void getDiagnostics(std::vector<diagnostic_msgs::DiagnosticStatus>& status) const;
+
+  /// Whether the robot is answering on the Get socket.  See addConnectionStateCallback()
+  enum class ConnectionState
+  {
+    Disconnected,  ///< Not connected yet, or the Get socket failed or timed out
+    Connected      ///< The Get socket answered the version check
+  };
+
+  /// Called with the new state and the reason for the change
+  using ConnectionStateCallback = std::function<void(ConnectionState, const std::string&)>;
+
+  /**
+   * \brief Add a callback for connection state changes.
+   *
+   * Must be called before connect().  The callbacks run on the io_service thread, so they must not block.
+   */
+  void addConnectionStateCallback(ConnectionStateCallback callback)
+  {
+    connection_state_callbacks_.push_back(std::move(callback));
+  }
+
+  ConnectionState getConnectionState() const
+  {
+    return connection_state_;
+  }
+
+  /// Number of times the heartbeat found the link dead.  See linkLost()
+  uint64_t getLinkLosses() const
+  {
+    return link_losses_;
+  }
+
+  /// The joint state from the latest sample.  See getStateSample()
+  sensor_msgs::JointState getLastJointState() const
+  {
+    return jointStateFromSample(getStateSample());
+  }
+
+  /// Convert a sample into a JointState with this connection's joint names
+  sensor_msgs::JointState jointStateFromSample(const RobotStateSample& sample) const;
+
   /**
    * \brief Calls socket::cancel() on the cmd socket if unable to acquire socket_cmd_mutex_ before the timeout expires.
    *
@@ -192,30 +334,443 @@ public:
    *
    * I already have a publishing thread in Driver.  No real need to make another.  The Driver will call this directly.
    */
-  void publishState();
+  void publishState()
+  {
+    publishState(getStateSample());
+  }
+
+  /**
+   * \brief Publish any non-aggregated state messages like tool_frame from a sample.
+   *
+   * Lets the Driver publish the joint state and tool frame from the same sample.
+   * @param sample From getStateSample()
+   */
+  void publishState(const RobotStateSample& sample);
 
 protected:
   /**
-   * \brief Monitor command_list_, send command to the robot and publish results.
+   * \brief commandListCb for lists longer than 1 chunk when ingest_threads is set.
+   *
+   * Every handler is found and the free space in the queue is checked first.  Then converter_ turns the chunks into
+   * RobotCommands on its threads.  Nothing is queued until the whole list converted, so a failed handler rejects the
+   * whole list like commandListCb() does.  With ingest_partial_lists_ each chunk is queued in order as soon as it's
+   * ready instead, and the robot may already have started on the chunks before a failed handler.  Either way a failed
+   * handler publishes FAILED_TO_PROCESS for its command_id.
+   *
+   * @param msg received from the /command_list topic
+   * @return true
+   */
+  bool commandListCbParallel(const robot_movement_interface::CommandList& msg);
+
+  /**
+   * \brief Cancel the Cmd socket, send a Get that came in a CommandList (like ABORT) right away and publish the result
+   */
+  void sendHighPriority(const RobotCommand& command);
+
+  /**
+   * \brief Monitor command_queue_, send command to the robot and publish results.
    *
-   * This thread is automatically launched by Connector::connectSocket.
+   * This thread is automatically launched by Connector::connectSocket.  It will run cmdThreadPipelined() instead if
+   * cmd_pipeline_depth_ > 1.
    */
   void cmdThread();
 
   /**
-   * \brief Gets the cyclical status data.
+   * \brief Pipelined version of cmdThread().
+   *
+   * Up to cmd_pipeline_depth_ commands are written before their responses are received.  The robot answers in order,
+   * so each response belongs to the oldest command that is still in flight.  Commands are removed from command_queue_
+   * when they are written.  If the socket has to reconnect, the unanswered commands are kept in cmd_retry_ so they
+   * will be sent again before the rest of the queue.
+   */
+  void cmdThreadPipelined();
+
+  /// A command written by the async Cmd path.  See CmdWriter
+  struct CmdOp
+  {
+    RobotCommandPtr cmd;  ///< Doesn't own the command for sendCommand() calls
+    /// Set for sendCommand() calls.  The response goes here instead of command_result.
+    std::shared_ptr<std::promise<std::string>> promise;
+    bool switch_format = false;  ///< It's the wire format switch
+    std::chrono::steady_clock::time_point sent;
+  };
+
+  /**
+   * \brief Run the Cmd socket from the strand instead of a Cmd thread.  Called when the Cmd socket connects.
+   *
+   * Used when async_cmd_ is set.  Works like cmdThreadPipelined() with a window of cmd_pipeline_depth_ (1 is the
+   * same as cmdThread()), but nothing blocks: a CmdWriter and a CmdReader coroutine run on the strand.  A read is
+   * always pending while connected.  A response that arrives when nothing is in flight is a late answer to a canceled
+   * command and is discarded, like cmdSocketFlusher() does.
+   */
+  void startAsyncCmd();
+
+  /**
+   * \brief Writes commands to the Cmd socket, 1 write at a time.  A stackless coroutine on the strand.
    *
-   * This thread is automatically launched by Connector::connectSocket.
+   * Each write is a batch from nextCmdBatch().
+   * Each async operation gets a copy, which carries the coroutine's state.  When the window is full or there is nothing
+   * to send, it waits on cmd_wake_timer_ until wakeCmdWriter() cancels it.  It ends when cmd_async_epoch_ changes.
    */
-  void getThread();
+  struct CmdWriter : boost::asio::coroutine
+  {
+    CmdWriter(Connector* connector, unsigned int epoch) : connector(connector), epoch(epoch)
+    {
+    }
+
+    void operator()(const boost::system::error_code& ec = boost::system::error_code(), std::size_t size = 0);
+
+    Connector* connector;
+    unsigned int epoch;
+    std::size_t batch = 0;  ///< Number of commands in the current write
+    std::chrono::steady_clock::time_point write_start;
+  };
+
+  /// Reads the Cmd socket and hands each response to asyncCmdResponse().  A stackless coroutine on the strand.
+  struct CmdReader : boost::asio::coroutine
+  {
+    CmdReader(Connector* connector, unsigned int epoch) : connector(connector), epoch(epoch)
+    {
+    }
+
+    void operator()(const boost::system::error_code& ec = boost::system::error_code(), std::size_t size = 0);
+
+    Connector* connector;
+    unsigned int epoch;
+    bool binary = false;  ///< The wire format when the read started
+  };
 
   /**
-     * \brief Asynchronously connect to a robot and launch the proper Cmd/Get thread.
+   * \brief Take the next command to write into cmd_async_in_flight_ and cmd_async_batch_.  Only on the strand.
+   *
+   * @param scratch [out] Used for the binary format.  See RobotCommand::wireData()
+   * @return The data to write.  nullptr if the window is full, a wire format switch is waiting for its answer or
+   * there's nothing to send
+   */
+  const std::string* nextCmdOp(std::string& scratch);
+
+  /**
+   * \brief Take up to cmd_batch_size_ commands with nextCmdOp() and point cmd_async_buffers_ at them.
+   * @return The number of commands in the batch
+   */
+  std::size_t nextCmdBatch();
+
+  /// Wake the CmdWriter if it's waiting for something to send.  Any thread.
+  void wakeCmdWriter()
+  {
+    if (async_cmd_ && !cmd_wake_posted_.exchange(true))
+      strand_.post([this]() {
+        cmd_wake_posted_ = false;
+        cmd_wake_timer_.cancel();
+      });
+  }
+
+  /// Process 1 response from the Cmd socket
+  void asyncCmdResponse(std::string& response);
+
+  /**
+   * \brief Handle an error on the async Cmd socket.
+   *
+   * A cancel from cancelSocketCmd() drops the commands in flight and keeps going.  Any other error keeps or clears the
+   * commands like cmdThreadPipelined() and reconnects.
+   */
+  void handleCmdError(const boost::system::error_code& ec);
+
+  /**
+   * \brief Take the next command to send out of cmd_retry_ or command_queue_.  Cmd thread only.
+   *
+   * @param cmd [out] The command
+   * @return False if there is nothing to send
+   */
+  bool takeNextCommand(RobotCommandPtr& cmd);
+
+  /**
+   * \brief Check the response of a Cmd and publish the Result.
+   *
+   * Will clear the command list if the response was an error and clear_commands_on_error_ is set.
+   *
+   * @param cmd The command that was sent
+   * @param response The response from the robot
+   * @return True if the response was OK
+   */
+  bool processCmdResponse(const RobotCommand& cmd, std::string& response);
+
+  /// A high priority Get waiting to be sent by the Get loop.  See sendGetCommand()
+  struct GetRequest
+  {
+    std::string send_str;  ///< Without the '\n'.  It's framed for the Get socket's format when it's sent.
+    std::promise<std::string> promise;
+    CommandLatency* latency = nullptr;
+    std::chrono::steady_clock::time_point queued_time;
+    /// Set if the caller stopped waiting.  It won't be sent.
+    std::atomic<bool> abandoned{ false };
+  };
+  using GetRequestPtr = std::shared_ptr<GetRequest>;
+
+  /// State of the Get loop.  Only used on the io_service thread.
+  enum class GetLoopState
+  {
+    Stopped,  ///< Not connected
+    Busy,     ///< Waiting for the robot to answer
+    Waiting   ///< Waiting for the next poll
+  };
+
+  /**
+   * \brief Send a high priority Get through the Get loop and wait for the response.
+   *
+   * \exception boost::system::system_error if the socket failed or the robot didn't answer in time
+   * @param command The Get to send
+   * @return the reply from the socket
+   */
+  std::string sendGetCommand(const RobotCommand& command);
+
+  /// What the Get loop does with the response of a GetItem
+  enum class GetItemKind
+  {
+    Status,         ///< Joints, velocities and tool frame
+    JointPosition,  ///< Joints only
+    ToolFrame,
+    Aux,       ///< Anything else.  The latest response is kept for getAuxResponse()
+    Heartbeat  ///< VERSION, only polled if nothing was answered for heartbeat_period_
+  };
+
+  /// A Get command polled at its own period.  The schedule is only used on the io_service thread.
+  struct GetItem
+  {
+    std::string name;  ///< The GET pose type
+    GetItemKind kind;
+    RobotCommandPtr cmd;
+    CommandLatency* latency;
+    double rate;
+    std::chrono::steady_clock::duration period;
+    std::chrono::steady_clock::time_point deadline;  ///< When the next poll is due
+    std::atomic<uint64_t> polls{ 0 };
+    std::atomic<uint64_t> overruns{ 0 };
+    std::string last_response;  ///< Aux only.  Guarded by get_items_mutex_.
+  };
+  using GetItemPtr = std::unique_ptr<GetItem>;
+
+  /**
+   * \brief Start polling the cyclical status data.
+   *
+   * Called on the io_service thread by Connector::connectSocket when the Get socket connects.  The version is checked
+   * first, then getCycle() keeps itself running from the completion handlers until the socket fails or stop() is
+   * called.
+   */
+  void startGetLoop();
+
+  /**
+   * \brief Make get_items_ from get_rates_ the first time the Get loop starts.  All of them are due right away.
+   *
+   * STATUS is polled at get_rate unless JOINT_POSITION or TOOL_FRAME is in get_rates or the plugin has no STATUS.
+   * Then JOINT_POSITION and TOOL_FRAME are polled separately.  Other pose types in get_rates are Aux items.
+   */
+  void scheduleGetItems();
+
+  /**
+   * \brief Run 1 step of the Get loop.
+   *
+   * Waiting high priority Gets are sent first.  Then the item with the earliest deadline is polled if it's due.
+   * Otherwise, it waits for that deadline.  A poll that starts after its next deadline has passed counts as an overrun
+   * and isn't caught up.
+   */
+  void getCycle();
+
+  /// Send 1 item and process the response.  Continues with getCycle().
+  void pollGetItem(GetItem& item);
+
+  /**
+   * \brief Write a string to the Get socket and read the response without blocking.
+   *
+   * on_response is only called if the write and read succeed.  Errors and timeouts go to handleGetError().  In the
+   * Binary format a Floats response is decoded into get_groups_ and get_response_binary_ is set.  Any other response is
+   * passed as text.
+   * @param send_str The data to write, already in the Get socket's format.  See encodeGet()
+   * @param timeout The socket is closed if the response takes longer.  get_timeout_ or poll_timeout_
+   * @param on_response Called with the response line
+   * @param latency If set, the write and response times are recorded in it
+   */
+  void asyncGet(const std::string& send_str, std::chrono::milliseconds timeout,
+                std::function<void(std::string&)> on_response, CommandLatency* latency = nullptr);
+
+  /// Writes get_send_str_ and reads 1 response for asyncGet().  A stackless coroutine on the strand.
+  struct GetExchange : boost::asio::coroutine
+  {
+    GetExchange(Connector* connector, std::function<void(std::string&)> on_response, CommandLatency* latency)
+      : connector(connector), on_response(std::move(on_response)), latency(latency)
+    {
+    }
+
+    void operator()(const boost::system::error_code& ec = boost::system::error_code(), std::size_t size = 0);
+
+    Connector* connector;
+    std::function<void(std::string&)> on_response;
+    CommandLatency* latency;
+  };
+
+  /// Prepare get_send_str_ for a command in the Get socket's format
+  void encodeGet(const RobotCommand& command)
+  {
+    command.toWire(get_send_str_, get_wire_format_);
+  }
+
+  /**
+   * \brief Check the version, then switch the Get socket to the negotiated wire format.  Starts getCycle() when done.
+   * @param response The VERSION response
+   */
+  void negotiateWireFormat(std::string& response);
+
+  /**
+   * \brief Stop the Get loop after a socket error and reconnect unless stop() was called.
+   * @param ec The error
+   */
+  void handleGetError(const boost::system::error_code& ec);
+
+  /**
+   * \brief Change connection_state_ and call the callbacks.  Does nothing if it's already in that state.
+   * @param state The new state
+   * @param reason Logged and passed to the callbacks
+   */
+  void setConnectionState(ConnectionState state, const std::string& reason);
+
+  /**
+   * \brief React to the Get socket failing while the heartbeat is on.
+   *
+   * Both sockets go to the same robot, so the Cmd socket is dead too.  A CONNECTION_LOST Result is published so the
+   * JTA fails its goal, the commands are cleared if clear_commands_on_error_ is set and the Cmd socket is shut down.  A
+   * Cmd waiting for a long motion would otherwise never find out.  The Cmd side reconnects like it does for any other
+   * socket error.
+   * @param reason Sent in the Result
+   */
+  void linkLost(const std::string& reason);
+
+  /**
+   * \brief Whether a Cmd socket error should clear the commands.
+   *
+   * eof usually means the robot restarted its socket, so the commands are kept and sent again.  Not if linkLost() shut
+   * it down.
+   */
+  bool clearCommandsOnCmdError(const boost::system::error_code& ec) const
+  {
+    return clear_commands_on_error_ && (ec != boost::asio::error::eof || cmd_link_lost_);
+  }
+
+  /// Process a STATUS response.  Updates the joint state and tool frame.
+  void processGetStatus(std::string& response)
+  {
+    processStatus(response, get_response_binary_, get_groups_);
+  }
+
+  /**
+   * \brief Check a STATUS response and store it in the state snapshot.  Shared by the Get loop and the status stream.
+   * @param response The text response
+   * @param binary If set, the response was decoded into groups instead
+   * @param groups joints, vel, tcp
+   * @return false if the response was bad
+   */
+  bool processStatus(std::string& response, bool binary, wire::FloatGroups& groups);
+
+  /**
+   * \brief Ask the robot to push the status on a dedicated connection instead of polling it.
+   *
+   * Called on the io_service thread when the Get loop starts.  Does nothing if status_stream_rate is 0, the plugin
+   * can't make the subscription command, or the stream is already running.  The stream is a second connection to the
+   * Get port.  If the robot refuses the subscription, the Get loop keeps polling.
+   */
+  void startStatusStream();
+
+  /// Send the subscription on the connected stream socket.  Switches the stream to the Get socket's format first.
+  void subscribeStatusStream(unsigned int stream_id, RobotCommandPtr subscribe);
+
+  /**
+   * \brief Write a command to the stream socket and read 1 response.  Errors close the stream.
+   * @param stream_id stream_id_ when the request was made.  Late handlers for an old stream are ignored.
+   * @param cmd The command
+   * @param on_response Called with the text response
+   */
+  void asyncStreamRequest(unsigned int stream_id, const RobotCommand& cmd,
+                          std::function<void(std::string&)> on_response);
+
+  /// Read the next pushed status.  Keeps itself running until the stream is closed.
+  void readStatusStream(unsigned int stream_id);
+
+  /**
+   * \brief Check the sequence number of a pushed status.
+   *
+   * Gaps are counted in stream_gaps_.  A repeated or older status is counted in stream_stale_ and dropped.
+   * @param seq The sequence number, modulo kStreamSeqModulo
+   * @return false if it should be dropped
+   */
+  bool checkStreamSeq(uint32_t seq);
+
+  /// Restart the timer that closes the stream if the robot stops pushing
+  void armStreamStaleTimer(unsigned int stream_id);
+
+  /**
+   * \brief Close the stream and go back to polling.
+   * @param reason Logged
+   * @param retry Try to subscribe again later
+   */
+  void stopStatusStream(const std::string& reason, bool retry);
+
+  /// Process a JOINT_POSITION response.  @return false if the response was bad
+  bool processGetJointPosition(std::string& response);
+
+  /// Process a TOOL_FRAME response.  A text frame is parsed into get_groups_ and converted like a binary one.
+  void processGetToolFrame(std::string& response);
+
+  /// Values parsed from a text Get response.  Big enough for any joint count get_sample_ can hold.
+  using ParsedValues = util::FixedVector<double, RobotStateSample::kMaxJoints>;
+
+  /// Store the received joint values in get_sample_.  Vec is a std::vector or ParsedValues.
+  template <typename Vec>
+  void updateJointState(const Vec& pos, const Vec& vel);
+
+  /**
+   * \brief Store the received tool frame in get_sample_
+   * @param frame x y z alpha beta gamma.  A std::vector or ParsedValues.
+   * @param raw The response it came from, for logging
+   */
+  template <typename Vec>
+  void updateToolFrame(const Vec& frame, const std::string& raw);
+
+  /**
+   * \brief Switch the Cmd socket to the format the Get socket negotiated.  Only called by the Cmd thread when nothing is
+   * in flight.
+   *
+   * \exception boost::system::system_error if the socket failed or was canceled
+   */
+  void switchCmdWireFormat();
+
+  /// Called by the Cmd thread when it starts.  A new socket always starts as text.
+  void resetCmdWireFormat()
+  {
+    std::lock_guard<std::timed_mutex> lock(socket_cmd_mutex_);
+    cmd_wire_format_ = wire::Format::Text;
+    cmd_wire_format_failed_ = false;
+    cmd_channel_.setFormat(wire::Format::Text);
+  }
+
+  /**
+   * \brief Write a command to the Cmd socket and read the response.  Caller must not hold socket_cmd_mutex_.
+   *
+   * \exception boost::system::system_error if the socket failed or was canceled
+   */
+  void requestCmdSocket(const RobotCommand& command, std::string& response);
+
+  /// Hand get_sample_ to the readers of state_snapshot_.  Called once per poll.
+  void storeStateSample()
+  {
+    state_snapshot_.store(get_sample_);
+  }
+
+  /**
+     * \brief Asynchronously connect to a robot and launch the proper Cmd thread/Get loop.
      *
      * This method will attempt to async_connect to the robot.  If it fails, it will try again.  When it succeeds, it
-     * will launch the appropriate Get/Cmd thread.  If this is being called from the Get/Set thread, it must be launched
-     * in a separate, detached thread.  It will attempt to join() the get/set thread before relaunching, to give it a
-     * chance to return.
+     * will launch the Cmd thread or start the Get loop.  If this is being called from the Cmd thread, it must be
+     * launched in a separate, detached thread.  It will attempt to join() the Cmd thread before relaunching, to give it
+     * a chance to return.
      * @param host The ip address
      * @param port The port
      * @param cmd_type Get/Set
@@ -242,7 +797,7 @@ protected:
   void publishRmiResult(const robot_movement_interface::Result& result) const;
 
   /**
-   * \brief Used by getThread() to create the required RobotCommands for the cyclic updated.
+   * \brief Used by startGetLoop() to create the required RobotCommands for the cyclic updated.
    *
    * @todo Think about this.  Maybe a special command handler type that returns the appropriate message (JointState,
    * etc) should be required.
@@ -260,13 +815,8 @@ protected:
   /// Socket used for "instant" commands that can't block.  Default port socket_cmd_ + 1
   boost::asio::ip::tcp::socket socket_get_;
 
-  /// Mutex for adding/removing Commands from the queue
-  std::mutex command_list_mutex_;
-
   /// Cmd socket mutex
   std::timed_mutex socket_cmd_mutex_;
-  /// Get socket mutex
-  std::timed_mutex socket_get_mutex_;
 
   /// IP address of the robot
   std::string host_;
@@ -276,8 +826,17 @@ protected:
   /// asio io service.  Owned by Driver.
   boost::asio::io_service& io_service_;
 
-  /// Queue of all rmi_driver::RobotCommands to be sent by Connector::cmdThread().
-  std::deque<RobotCommandPtr> command_list_;
+  /// Every completion handler of this connection runs on it, so the Driver can run the io_service on a thread pool.
+  boost::asio::io_service::strand strand_;
+
+  /// Queue of all rmi_driver::RobotCommands to be sent by Connector::cmdThread().  The command_list subscriber pushes,
+  /// the Cmd thread pops.  When the Cmd thread isn't running, Connector::connectSocket's handler acts as the consumer.
+  SpscRing<RobotCommandPtr> command_queue_;
+
+  /// Pipelined commands that were unanswered when the Cmd socket reconnected.  Only valid while the queue's clear epoch
+  /// is still cmd_retry_epoch_.
+  std::deque<RobotCommandPtr> cmd_retry_;
+  uint64_t cmd_retry_epoch_ = 0;
 
   /// Receives the robot_movement_interface/CommandList for this namespace
   ros::Subscriber command_list_sub_;
@@ -295,17 +854,13 @@ protected:
 
   // std::queue<std::shared_ptr<robot_movement_interface::Result>> command_result_list_;
 
-  std::thread get_thread_;
   std::thread cmd_thread_;
 
-  /// The last known joint state.  Set by getThead() and aggregated by the Driver.
-  sensor_msgs::JointState last_joint_state_;
-
-  /// The last known tool frame.  Published by publishState(), called from Driver.
-  robot_movement_interface::EulerFrame last_tool_frame_;
+  /// The last known joint state and tool frame.  Stored by the Get loop, aggregated and published by the Driver.
+  SeqLock<RobotStateSample> state_snapshot_;
 
-  /// The last known tool frame from the robot.
-  geometry_msgs::PoseStamped last_tool_frame_pose_;
+  /// The sample the Get loop is filling in.  Only used on the io_service thread.
+  RobotStateSample get_sample_;
 
   /// List of joint names for this robot.
   std::vector<std::string> joint_names_;
@@ -322,12 +877,159 @@ protected:
 
   boost::asio::streambuf socket_cmd_flush_buff_;
 
+  /// Converts big command_lists on ingest_threads.  nullptr converts them on the callback thread.
+  std::unique_ptr<CommandListConverter> converter_;
+
+  /// Queue each chunk from converter_ as soon as it's ready.  See commandListCbParallel()
+  bool ingest_partial_lists_ = false;
+
   /// Will cause commandListCb to exit if it encounters a message it can't match.
   bool abort_on_fail_to_find_ = true;  /// @todo Will all robot types have an ABORT command?
 
   /// Connector::cmdThread() will clearCommands if it receives an error response or disconnects
   bool clear_commands_on_error_ = true;
 
+  /// Max number of commands in flight on the Cmd socket.  See cmdThreadPipelined()
+  size_t cmd_pipeline_depth_ = 1;
+
+  /// Max number of commands and bytes coalesced into 1 Cmd socket write
+  size_t cmd_batch_size_ = 1;
+  size_t cmd_batch_bytes_ = 8192;
+
+  /// Number of writes on the Cmd socket and the commands they carried.  Batching makes the 2nd one bigger.
+  std::atomic<uint64_t> cmd_writes_{ 0 };
+  std::atomic<uint64_t> cmd_commands_written_{ 0 };
+
+  /// Reusable buffers for sending/receiving on socket_cmd_.  Several responses can arrive in 1 read when pipelining.
+  SocketChannel cmd_channel_;
+
+  /// Reused by sendCommand() while holding socket_cmd_mutex_
+  std::string cmd_send_str_;
+
+  /// Run the Cmd socket from the strand instead of a Cmd thread.  See startAsyncCmd()
+  bool async_cmd_ = false;
+
+  /// Set on every socket when it connects
+  SocketOptions socket_options_;
+
+  /// socket_options_ plus TCP keepalive when the heartbeat is on
+  SocketOptions cmd_socket_options_;
+
+  /// The following are only used on the strand by the async Cmd path
+  unsigned int cmd_async_epoch_ = 0;          ///< Incremented on errors to end the coroutines
+  std::deque<CmdOp> cmd_async_in_flight_;     ///< Written but not answered, oldest first
+  std::deque<CmdOp> cmd_async_requests_;      ///< sendCommand() calls waiting to be written
+  std::vector<std::string> cmd_async_send_strs_;             ///< Binary format scratch, 1 per command in the batch
+  std::vector<boost::asio::const_buffer> cmd_async_buffers_;  ///< The current batch
+  std::vector<RobotCommandPtr> cmd_async_batch_;              ///< The commands cmd_async_buffers_ points into
+  std::string cmd_async_response_;
+  boost::asio::streambuf cmd_async_buff_;
+  boost::asio::steady_timer cmd_cancel_timer_;  ///< See cancelSocketCmd()
+  boost::asio::steady_timer cmd_wake_timer_;    ///< The CmdWriter waits on it when it's idle
+  std::atomic<bool> cmd_wake_posted_{ false };
+
+  /// The wire format the robot agreed to on the Get socket.  The Cmd thread switches the Cmd socket to match.
+  std::atomic<wire::Format> wire_format_{ wire::Format::Text };
+
+  /// Format of the Cmd socket.  Set by the Cmd thread while holding socket_cmd_mutex_.
+  std::atomic<wire::Format> cmd_wire_format_{ wire::Format::Text };
+
+  /// The robot refused to switch the Cmd socket.  Don't ask again until it reconnects.
+  bool cmd_wire_format_failed_ = false;
+
+  /// Rate (Hz) of the Get items that aren't in get_rates_.  0 polls as fast as the robot answers.
+  double get_rate_;
+
+  /// Rate for each GET pose type.  See ConnectionConfig::get_rates_
+  std::map<std::string, double> get_rates_;
+
+  /// Max time to wait for the robot to answer a Get from sendGetCommand(), the version check or the status stream
+  std::chrono::milliseconds get_timeout_ = std::chrono::milliseconds(500);
+
+  /// Max time to wait for the robot to answer a polled Get item.  ConnectionConfig::heartbeat_timeout_ if the heartbeat
+  /// is on.
+  std::chrono::milliseconds poll_timeout_ = std::chrono::milliseconds(500);
+
+  /// Seconds without a Get response before a heartbeat is polled.  0 == off.
+  double heartbeat_period_ = 0;
+
+  /// Set from the strand, read anywhere.  See setConnectionState()
+  std::atomic<ConnectionState> connection_state_{ ConnectionState::Disconnected };
+  std::vector<ConnectionStateCallback> connection_state_callbacks_;
+
+  /// Set by linkLost() until the Cmd socket reconnects
+  std::atomic<bool> cmd_link_lost_{ false };
+  std::atomic<uint64_t> link_losses_{ 0 };
+
+  /// Set by stop() so the Get loop won't reconnect
+  std::atomic<bool> stopping_{ false };
+
+  /// The following are only used on the io_service thread by the Get loop
+  GetLoopState get_loop_state_ = GetLoopState::Stopped;
+  boost::asio::steady_timer get_timer_;     ///< Waits for the next poll
+  boost::asio::steady_timer get_deadline_;  ///< Closes the Get socket if the robot doesn't answer
+  unsigned int get_op_id_ = 0;              ///< Incremented when a Get finishes so a late deadline is ignored
+  bool get_timed_out_ = false;              ///< The deadline closed the socket
+  std::string get_send_str_;  ///< Must stay alive until the write finishes
+  std::string get_response_;  ///< Reused for every response
+  std::chrono::steady_clock::time_point get_write_start_;
+  std::chrono::steady_clock::time_point get_write_done_;
+  wire::Format get_wire_format_ = wire::Format::Text;
+  wire::FloatGroups get_groups_;      ///< The last binary Floats response
+  bool get_response_binary_ = false;  ///< The last response was decoded into get_groups_
+  boost::asio::streambuf socket_get_buff_;
+  std::deque<GetRequestPtr> get_requests_;  ///< High priority Gets waiting to be sent
+  GetRequestPtr get_current_request_;       ///< High priority Get waiting for its response
+  GetItem* heartbeat_item_ = nullptr;       ///< In get_items_ if the heartbeat is on
+
+  /// State of the status stream.  Only used on the io_service thread.
+  enum class StreamState
+  {
+    Off,         ///< Polling.  Will subscribe when the Get loop starts or the retry timer expires.
+    Connecting,  ///< Connecting or waiting for the subscription response
+    Active,      ///< The robot is pushing the status
+    Unsupported  ///< The robot or plugin doesn't do it.  Checked again when the Get socket reconnects.
+  };
+
+  /// Sequence numbers of pushed statuses wrap at this.  Small enough to be exact in a float.
+  static constexpr uint32_t kStreamSeqModulo = 1u << 24;
+
+  /// Rate to ask the robot to push the status at.  0 polls instead.
+  double status_stream_rate_ = 0.0;
+
+  /// Set while stream_state_ is Active.  The Get loop stops polling.
+  std::atomic<bool> streaming_{ false };
+  std::atomic<uint64_t> stream_gaps_{ 0 };
+  std::atomic<uint64_t> stream_stale_{ 0 };
+
+  /// The following are only used on the io_service thread by the status stream
+  boost::asio::ip::tcp::socket socket_stream_;
+  boost::asio::steady_timer stream_timer_;  ///< Request deadline, then closes the stream if the pushes stop
+  StreamState stream_state_ = StreamState::Off;
+  unsigned int stream_id_ = 0;  ///< Incremented when the stream closes so late handlers are ignored
+  std::chrono::steady_clock::duration stream_stale_timeout_;
+  wire::Format stream_wire_format_ = wire::Format::Text;
+  bool stream_have_seq_ = false;
+  uint32_t stream_last_seq_ = 0;
+  std::string stream_send_str_;
+  std::string stream_response_;
+  wire::FloatGroups stream_groups_;
+  boost::asio::streambuf stream_buff_;
+
+  /// The Get loop's schedule.  Made once by scheduleGetItems().  The mutex guards the vector for
+  /// getGetItemStats() and the Aux responses.
+  std::vector<GetItemPtr> get_items_;
+  mutable std::mutex get_items_mutex_;
+
+  /// The RobotCommands polled by the Get loop.  Found with findGetCommand() when the loop starts.
+  RobotCommandPtr get_joint_position_;
+  RobotCommandPtr get_version_;
+  RobotCommandPtr get_tool_frame_;
+  RobotCommandPtr get_status_;
+
+  /// Written by the Cmd thread and the io_service thread, read by the Driver
+  LatencyStats latency_stats_;
+
   rmi_log::RmiLogger logger_;
 };
 
@@ -39,6 +39,7 @@
 #include "rmi_driver/rmi_config.h"
 #include "rmi_driver/rmi_logger.h"
 
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <robot_movement_interface/CommandList.h>
 #include <robot_movement_interface/Result.h>
 #include <sensor_msgs/JointState.h>
@@ -79,9 +80,11 @@ public:
    * @param joint_names Vector of joint names
    * @param cmd_reg_loader The plugin loader that needs to be stored
    * @param cmd_register CommandRegister loaded from plugin
+   * @param con_cfg The rest of the per connection settings
    */
   void addConnection(std::string ns, std::string host, int port, std::vector<std::string> joint_names,
-                     CmdRegLoaderPtr cmd_reg_loader, CommandRegisterPtr cmd_register);
+                     CmdRegLoaderPtr cmd_reg_loader, CommandRegisterPtr cmd_register,
+                     const ConnectionConfig &con_cfg = ConnectionConfig());
 
   /**
    * \brief Load a plugin using pluginlib::ClassLoader for 1 connection
@@ -116,12 +119,14 @@ protected:
 
   // boost::asio::io_service::work work_;  /// Keep the io_service from dying
   std::unique_ptr<boost::asio::io_service::work> work_;
-  std::thread io_service_thread_;  /// calls io_service_.run()
+  std::vector<std::thread> io_service_threads_;  /// call io_service_.run().  More than 1 in shared_thread_pool mode.
 
   // std::shared_ptr<std::thread> io_service_thread_;
 
   ros::Publisher joint_state_publisher_;  /// Publishes aggregated joint states
 
+  ros::Publisher diagnostics_publisher_;  /// Publishes each Connector's latency and Get loop stats
+
   std::thread pub_thread_;  /// Aggregates and publishes
 
   rmi_log::RmiLogger logger_;  /// Easier logging
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+#ifndef INCLUDE_RMI_DRIVER_FIXED_VECTOR_H_
+#define INCLUDE_RMI_DRIVER_FIXED_VECTOR_H_
+
+#include <cstddef>
+
+namespace rmi_driver
+{
+namespace util
+{
+/**
+ * \brief Vector with a fixed capacity that lives on the stack or inside another object.  Never allocates.
+ *
+ * Only meant for trivial types like double.  push_back() returns false instead of growing, so max_size() is the
+ * capacity like std::array.
+ */
+template <typename T, std::size_t N>
+class FixedVector
+{
+public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  /// Add a value to the back.  @return false if it's full
+  bool push_back(const T& value)
+  {
+    if (size_ == N)
+      return false;
+    data_[size_++] = value;
+    return true;
+  }
+
+  void clear()
+  {
+    size_ = 0;
+  }
+
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+  bool empty() const
+  {
+    return size_ == 0;
+  }
+
+  static constexpr std::size_t max_size()
+  {
+    return N;
+  }
+
+  T& operator[](std::size_t i)
+  {
+    return data_[i];
+  }
+
+  const T& operator[](std::size_t i) const
+  {
+    return data_[i];
+  }
+
+  T* data()
+  {
+    return data_;
+  }
+
+  const T* data() const
+  {
+    return data_;
+  }
+
+  iterator begin()
+  {
+    return data_;
+  }
+
+  iterator end()
+  {
+    return data_ + size_;
+  }
+
+  const_iterator begin() const
+  {
+    return data_;
+  }
+
+  const_iterator end() const
+  {
+    return data_ + size_;
+  }
+
+private:
+  T data_[N];
+  std::size_t size_ = 0;
+};
+
+}  // namespace util
+}  // namespace rmi_driver
+
+#endif /* INCLUDE_RMI_DRIVER_FIXED_VECTOR_H_ */
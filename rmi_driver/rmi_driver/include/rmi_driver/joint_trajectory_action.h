@@ -44,10 +44,14 @@
 
 #include <control_msgs/FollowJointTrajectoryAction.h>
 #include <control_msgs/FollowJointTrajectoryFeedback.h>
+#include <diagnostic_msgs/DiagnosticStatus.h>
 #include <robot_movement_interface/CommandList.h>
 #include <robot_movement_interface/Result.h>
 #include <trajectory_msgs/JointTrajectory.h>
 
+#include <atomic>
+#include <cstdint>
+
 namespace rmi_driver
 {
 typedef actionlib::ActionServer<control_msgs::FollowJointTrajectoryAction> JointTractoryActionServer;
@@ -55,10 +59,26 @@ typedef actionlib::ActionServer<control_msgs::FollowJointTrajectoryAction> Joint
 class JointTrajectoryAction
 {
 public:
-  JointTrajectoryAction(std::string ns, const std::vector<std::string> &joint_names, JtaCommandHandler *jta_handler);
+  /**
+   * @param decimation_tolerance Max deviation of each joint, in the order of joint_names, when points are dropped from a
+   * goal.  Empty keeps every point.  See decimateTrajectory()
+   */
+  JointTrajectoryAction(std::string ns, const std::vector<std::string> &joint_names, JtaCommandHandler *jta_handler,
+                        const std::vector<double> &decimation_tolerance = std::vector<double>());
 
+  /**
+   * \brief Sort, decimate and send a goal as a CommandList
+   *
+   * With a decimation tolerance, the points that are within it of the line between their neighbors are dropped before
+   * processJta.  The number that were dropped is logged and counted in getDiagnostics().
+   */
   void newGoal(JointTractoryActionServer::GoalHandle &gh);
 
+  /**
+   * \brief Add the decimation counters to a DiagnosticArray.  Nothing is added if decimation is off.  Any thread.
+   */
+  void getDiagnostics(std::vector<diagnostic_msgs::DiagnosticStatus> &status) const;
+
   /**
     * \brief Action server goal callback method
     *
@@ -119,6 +139,15 @@ protected:
 
   JtaCommandHandler *jta_handler_;
 
+  /// In the order of conf_joint_names_.  Empty == off
+  std::vector<double> decimation_tolerance_;
+
+  /// Written by the goal callback, read by getDiagnostics()
+  std::atomic<uint64_t> decimated_goals_{ 0 };
+  std::atomic<uint64_t> decimation_points_in_{ 0 };
+  std::atomic<uint64_t> decimation_points_removed_{ 0 };
+  std::atomic<uint64_t> last_goal_points_removed_{ 0 };
+
   rmi_log::RmiLogger logger_;
 };
 }  // namespace rmi_driver
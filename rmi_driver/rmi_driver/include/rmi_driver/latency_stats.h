@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+#ifndef INCLUDE_RMI_DRIVER_LATENCY_STATS_H_
+#define INCLUDE_RMI_DRIVER_LATENCY_STATS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace rmi_driver
+{
+/**
+ * \brief Lock-free log-linear histogram of durations in nanoseconds.
+ *
+ * Values are grouped by their highest set bit and each power of 2 is split into kSubBuckets linear buckets, so a
+ * percentile is never off by more than 1/kSubBuckets.  record() is wait-free and can be called from any thread.
+ * Readers may see a count that is a few values ahead of the buckets.
+ */
+class LatencyHistogram
+{
+public:
+  static constexpr unsigned kSubBits = 3;
+  static constexpr unsigned kSubBuckets = 1u << kSubBits;
+  /// Values of 2^kMaxBits ns (about 18 minutes) and up go in the last bucket
+  static constexpr unsigned kMaxBits = 40;
+  static constexpr unsigned kNumBuckets = (kMaxBits - kSubBits + 1) * kSubBuckets;
+
+  LatencyHistogram()
+  {
+    for (auto& count : counts_)
+      count.store(0, std::memory_order_relaxed);
+  }
+
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  void record(std::uint64_t ns)
+  {
+    counts_[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+
+    std::uint64_t max = max_.load(std::memory_order_relaxed);
+    while (ns > max && !max_.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  void record(std::chrono::steady_clock::duration duration)
+  {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    record(static_cast<std::uint64_t>(ns > 0 ? ns : 0));
+  }
+
+  std::uint64_t count() const
+  {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  std::uint64_t max() const
+  {
+    return max_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * \brief The value at quantile p.
+   * @param p 0 to 1.  0.99 is p99.
+   * @return The upper bound of the bucket it falls in, but never more than max().  0 if nothing was recorded.
+   */
+  std::uint64_t percentile(double p) const
+  {
+    std::uint64_t total = 0;
+    for (const auto& count : counts_)
+      total += count.load(std::memory_order_relaxed);
+    if (total == 0)
+      return 0;
+
+    std::uint64_t rank = static_cast<std::uint64_t>(p * total + 0.5);
+    if (rank < 1)
+      rank = 1;
+
+    std::uint64_t seen = 0;
+    for (unsigned i = 0; i < kNumBuckets; ++i)
+    {
+      seen += counts_[i].load(std::memory_order_relaxed);
+      if (seen >= rank)
+        return std::min(bucketUpperBound(i), max());
+    }
+    return max();
+  }
+
+  /// Bucket of a value.  Values under kSubBuckets get a bucket each.
+  static unsigned bucketIndex(std::uint64_t ns)
+  {
+    if (ns < kSubBuckets)
+      return static_cast<unsigned>(ns);
+
+    unsigned msb = 63 - __builtin_clzll(ns);
+    unsigned shift = msb - kSubBits;
+    unsigned index = (shift + 1) * kSubBuckets + static_cast<unsigned>((ns >> shift) & (kSubBuckets - 1));
+    return index < kNumBuckets ? index : kNumBuckets - 1;
+  }
+
+  /// Largest value that goes in a bucket
+  static std::uint64_t bucketUpperBound(unsigned index)
+  {
+    unsigned block = index / kSubBuckets;
+    std::uint64_t sub = index % kSubBuckets;
+    if (block == 0)
+      return sub;
+    return ((kSubBuckets + sub + 1) << (block - 1)) - 1;
+  }
+
+private:
+  std::atomic<std::uint64_t> counts_[kNumBuckets];
+  std::atomic<std::uint64_t> count_{ 0 };
+  std::atomic<std::uint64_t> max_{ 0 };
+};
+
+/// The parts of a command's round trip
+struct CommandLatency
+{
+  LatencyHistogram queue_wait;  ///< From being queued (or due, for polls) until it was written
+  LatencyHistogram write;       ///< Writing it to the socket
+  LatencyHistogram response;    ///< From the end of the write until the response arrived
+};
+
+/**
+ * \brief CommandLatency for each command name, like "ptp" or "get status".
+ *
+ * The table is a fixed size, open addressed hash.  get() is lock-free and only allocates the first time it sees a
+ * name.  Names that don't fit share other().
+ */
+class LatencyStats
+{
+public:
+  static constexpr std::size_t kMaxCommands = 32;
+
+  LatencyStats()
+  {
+    for (auto& slot : slots_)
+      slot.name.store(nullptr, std::memory_order_relaxed);
+  }
+
+  ~LatencyStats()
+  {
+    for (auto& slot : slots_)
+      delete slot.name.load(std::memory_order_relaxed);
+  }
+
+  LatencyStats(const LatencyStats&) = delete;
+  LatencyStats& operator=(const LatencyStats&) = delete;
+
+  /// Find or add the entry for a command name.  Any thread.
+  CommandLatency& get(const std::string& name)
+  {
+    std::size_t start = std::hash<std::string>()(name) % kMaxCommands;
+    for (std::size_t i = 0; i < kMaxCommands; ++i)
+    {
+      Slot& slot = slots_[(start + i) % kMaxCommands];
+      const std::string* slot_name = slot.name.load(std::memory_order_acquire);
+      if (!slot_name)
+      {
+        // Claim it.  Another thread may have claimed it with a different name first.
+        std::string* new_name = new std::string(name);
+        if (slot.name.compare_exchange_strong(slot_name, new_name, std::memory_order_acq_rel))
+          return slot.latency;
+        delete new_name;
+      }
+
+      if (*slot_name == name)
+        return slot.latency;
+    }
+    return other_;
+  }
+
+  /// Shared by the names that didn't fit in the table
+  const CommandLatency& other() const
+  {
+    return other_;
+  }
+
+  /// Call fn(name, latency) for each name that has been seen.  Any thread.
+  void forEach(std::function<void(const std::string&, const CommandLatency&)> fn) const
+  {
+    for (const auto& slot : slots_)
+    {
+      const std::string* name = slot.name.load(std::memory_order_acquire);
+      if (name)
+        fn(*name, slot.latency);
+    }
+    if (other_.write.count() || other_.response.count())
+      fn("other", other_);
+  }
+
+private:
+  struct Slot
+  {
+    std::atomic<const std::string*> name;
+    CommandLatency latency;
+  };
+
+  Slot slots_[kMaxCommands];
+  CommandLatency other_;
+};
+
+}  // namespace rmi_driver
+
+#endif /* INCLUDE_RMI_DRIVER_LATENCY_STATS_H_ */
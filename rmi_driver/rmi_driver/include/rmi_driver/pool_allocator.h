@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+#ifndef INCLUDE_RMI_DRIVER_POOL_ALLOCATOR_H_
+#define INCLUDE_RMI_DRIVER_POOL_ALLOCATOR_H_
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace rmi_driver
+{
+namespace util
+{
+/**
+ * \brief Thread safe free list of blocks of 1 size.
+ *
+ * Freed blocks are kept for the next allocate() instead of going back to the heap, up to kMaxFree of them.
+ */
+class BlockPool
+{
+public:
+  /// Blocks beyond this many free ones are deleted
+  static constexpr std::size_t kMaxFree = 65536;
+
+  explicit BlockPool(std::size_t block_size) : block_size_(block_size)
+  {
+  }
+
+  ~BlockPool()
+  {
+    for (void* block : free_)
+      ::operator delete(block);
+  }
+
+  BlockPool(const BlockPool&) = delete;
+  BlockPool& operator=(const BlockPool&) = delete;
+
+  void* allocate()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!free_.empty())
+      {
+        void* block = free_.back();
+        free_.pop_back();
+        return block;
+      }
+    }
+    return ::operator new(block_size_);
+  }
+
+  void deallocate(void* block)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (free_.size() < kMaxFree)
+      {
+        free_.push_back(block);
+        return;
+      }
+    }
+    ::operator delete(block);
+  }
+
+  /// Number of blocks waiting to be reused
+  std::size_t freeBlocks() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return free_.size();
+  }
+
+private:
+  std::size_t block_size_;
+  mutable std::mutex mutex_;
+  std::vector<void*> free_;
+};
+
+/// The pool for blocks of Size bytes.  It's never destroyed, so objects in static storage can still free into it.
+template <std::size_t Size>
+BlockPool& blockPool()
+{
+  static BlockPool* pool = new BlockPool(Size);
+  return *pool;
+}
+
+/**
+ * \brief Allocator that takes single objects from the blockPool() of their size.  Arrays come from the heap.
+ *
+ * Meant for std::allocate_shared, so objects that are made and freed all the time, like RobotCommands, reuse the same
+ * memory.  See makeRobotCommand()
+ */
+template <typename T>
+class PoolAllocator
+{
+public:
+  using value_type = T;
+
+  template <typename U>
+  struct rebind
+  {
+    using other = PoolAllocator<U>;
+  };
+
+  PoolAllocator() = default;
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>&)
+  {
+  }
+
+  T* allocate(std::size_t n)
+  {
+    static_assert(alignof(T) <= alignof(std::max_align_t), "PoolAllocator doesn't support over aligned types");
+    if (n != 1)
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    return static_cast<T*>(blockPool<sizeof(T)>().allocate());
+  }
+
+  void deallocate(T* p, std::size_t n)
+  {
+    if (n != 1)
+      ::operator delete(p);
+    else
+      blockPool<sizeof(T)>().deallocate(p);
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+  return false;
+}
+
+}  // namespace util
+}  // namespace rmi_driver
+
+#endif /* INCLUDE_RMI_DRIVER_POOL_ALLOCATOR_H_ */
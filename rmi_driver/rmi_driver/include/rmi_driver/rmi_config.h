@@ -75,6 +75,8 @@
 #include <xmlrpcpp/XmlRpcValue.h>
 
 #include <ros/ros.h>
+#include <rmi_driver/socket_options.h>
+#include <rmi_driver/wire_format.h>
 #include <map>
 #include <string>
 #include <vector>
@@ -96,6 +98,60 @@ public:
   std::string rmi_plugin_lookup_name_;  /// The actual class name that is exported
   std::vector<std::string> joints_;     /// List of joints
 
+  /// Max number of Cmd commands written to the robot before their responses arrive.  1 disables pipelining.
+  int cmd_pipeline_depth_ = 1;
+
+  /// Max number of ready Cmd commands coalesced into 1 socket write.  Also limited by the room in the pipeline window.
+  /// 1 writes each command on its own.
+  int cmd_batch_size_ = 1;
+
+  /// A batch stops growing once it has this many bytes
+  int cmd_batch_bytes_ = 8192;
+
+  /// Max number of Cmd commands waiting to be sent.  Rounded up to a power of 2.
+  int cmd_queue_size_ = 65536;
+
+  /// Number of threads that convert a command_list into RobotCommands.  0 converts it on the callback thread.
+  int ingest_threads_ = 0;
+
+  /// Number of commands per chunk with ingest_threads
+  int ingest_chunk_size_ = 256;
+
+  /// Queue each chunk as soon as it's ready instead of after the whole list converted.  A handler that fails later
+  /// leaves the robot working on the chunks before it.
+  bool ingest_partial_lists_ = false;
+
+  /// Rate (Hz) the Get socket is polled for the robot state.  0 polls as fast as the robot answers.
+  double get_rate_ = 50;
+
+  /// Rate (Hz) for individual Get pose types, like JOINT_POSITION or TOOL_FRAME.  Types that aren't listed use
+  /// get_rate_.  Any other GET pose type the plugin handles is polled as auxiliary data.
+  std::map<std::string, double> get_rates_;
+
+  /// Run the Cmd socket as coroutines on the io_service instead of a Cmd thread.  Always on with shared_thread_pool.
+  bool async_cmd_ = false;
+
+  /// TCP options for the Cmd, Get and status stream sockets
+  SocketOptions socket_options_;
+
+  /// Wire format to ask the robot for.  See CommandRegister::negotiateWireFormat
+  wire::Format wire_format_ = wire::Format::Text;
+
+  /// Rate (Hz) to ask the robot to push the status at instead of polling it.  0 == poll.  See
+  /// CommandRegister::makeStatusStreamCommand
+  double status_stream_rate_ = 0;
+
+  /// Seconds without a Get response before the Get socket polls a heartbeat.  0 == off.  See heartbeat_timeout_
+  double heartbeat_period_ = 0;
+
+  /// With a heartbeat, seconds a polled Get or heartbeat can go unanswered before the link counts as lost.  Without one,
+  /// it times out after 0.5s.  Gets from Connector::sendGetCommand() always have 0.5s.
+  double heartbeat_timeout_ = 0.05;
+
+  /// Max deviation (rad or m) of each joint when the JointTrajectoryAction drops points from a goal.  Empty == keep
+  /// every point.  See decimateTrajectory()
+  std::vector<double> jta_decimation_tolerance_;
+
   /**
    * \brief Load the settings for this connection
    *
@@ -150,6 +206,15 @@ public:
 
   /// Use the rmi_driver joint_trajectory_action handler.  If false, you'll have to run your own handler.
   bool use_rmi_driver_jta_ = true;
+
+  /// Run every Connector on a pool of io_service threads instead of giving each one a Cmd thread
+  bool shared_thread_pool_ = false;
+
+  /// Size of the pool in shared_thread_pool mode.  0 == number of cores.
+  int io_threads_ = 0;
+
+  /// Seconds between publishing the latency and Get loop stats on /diagnostics.  0 disables it.
+  double diagnostics_period_ = 1.0;
 };
 
 /**
@@ -85,6 +85,20 @@ public:
    */
   static tf2::Quaternion quatFromZYZ(const tf2Scalar& Z, const tf2Scalar& Y, const tf2Scalar& ZZ);
 
+  /**
+   * \brief Convert Euler ZYZ' angles into ZYX (yaw pitch roll) without building a tf2::Matrix3x3.
+   *
+   * Same result as rotZYZ(Z, Y, ZZ).getEulerYPR(), but only computes the 5 matrix entries it needs.  Gimbal lock still
+   * goes through tf2.
+   * @param Z Z rotation in radians
+   * @param Y Y rotation in radians
+   * @param ZZ Z' rotation in radians
+   * @param yaw [out] Z rotation in radians
+   * @param pitch [out] Y rotation in radians
+   * @param roll [out] X rotation in radians
+   */
+  static void zyzToZyx(double Z, double Y, double ZZ, double& yaw, double& pitch, double& roll);
+
   /**
    * \brief Check if 2 quaternions are approximately equal.
    *
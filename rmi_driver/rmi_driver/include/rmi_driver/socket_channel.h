@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+#ifndef INCLUDE_RMI_DRIVER_SOCKET_CHANNEL_H_
+#define INCLUDE_RMI_DRIVER_SOCKET_CHANNEL_H_
+
+#include <boost/asio.hpp>
+#include <rmi_driver/wire_format.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace rmi_driver
+{
+/**
+ * \brief Blocking line based request/response on an asio socket without allocating per call.
+ *
+ * The socket operations are still asynchronous so they can be canceled from another thread, but the calling thread
+ * waits for them to finish.  The streambuf, the completion state and the memory asio needs for each handler are owned by
+ * the channel and reused, so once the buffers have grown to the size of the messages a request doesn't touch the heap.
+ *
+ * Only 1 thread may use a channel at a time.  The socket must be run by an io_service on another thread.
+ *
+ * In the Binary wire format a "line" is 1 frame.  Responses are always returned as text, see wire::payloadToText().
+ */
+class SocketChannel
+{
+public:
+  explicit SocketChannel(boost::asio::ip::tcp::socket& socket) : socket_(socket)
+  {
+  }
+
+  SocketChannel(const SocketChannel&) = delete;
+  SocketChannel& operator=(const SocketChannel&) = delete;
+
+  /**
+   * \brief Write data and wait for the write to finish.
+   *
+   * \exception boost::system::system_error if the write failed or was canceled
+   * @param data The string to write.  Must not be changed until this returns.
+   */
+  void write(const std::string& data);
+
+  /**
+   * \brief Gather write several buffers with 1 write and wait for it to finish.
+   *
+   * \exception boost::system::system_error if the write failed or was canceled
+   * @param buffers The data to write, in order.  Must not be changed until this returns.
+   */
+  void write(const std::vector<boost::asio::const_buffer>& buffers);
+
+  /**
+   * \brief Start reading the next line.  Use waitReadLine() to get it.
+   *
+   * Does nothing if a read is already pending.
+   */
+  void asyncReadLine();
+
+  /**
+   * \brief Wait for the read started by asyncReadLine().
+   *
+   * \exception boost::system::system_error if the read failed or was canceled
+   * @param line [out] The line without the '\n'.  Its capacity is reused.
+   * @param timeout Max time to wait
+   * @return False if the timeout expired.  The read is still pending.
+   */
+  bool waitReadLine(std::string& line, std::chrono::milliseconds timeout);
+
+  /// Wait for the read started by asyncReadLine() with no timeout.  See waitReadLine()
+  void waitReadLine(std::string& line);
+
+  /// Wait for a pending read to finish and discard the result and any errors.
+  void waitReadDone();
+
+  /**
+   * \brief Take a line that is already buffered without reading the socket.
+   *
+   * Several lines can arrive in 1 read.  Does nothing if a read is pending.
+   * \exception boost::system::system_error if a frame is broken
+   * @param line [out] The line without the '\n'.  Its capacity is reused.
+   * @return False if there isn't a whole line in the buffer
+   */
+  bool takeBufferedLine(std::string& line);
+
+  /// True if a read was started and hasn't been picked up with waitReadLine()
+  bool readPending() const
+  {
+    return read_pending_;
+  }
+
+  /**
+   * \brief Write data and read the response line.
+   *
+   * \exception boost::system::system_error if the socket failed or was canceled
+   * @param data The string to write
+   * @param response [out] The response without the '\n'.  Its capacity is reused.
+   */
+  void request(const std::string& data, std::string& response);
+
+  /// Discard any buffered data.  Call after reconnecting.
+  void clear()
+  {
+    buff_.consume(buff_.size());
+  }
+
+  /// Switch between lines and frames.  Nothing can be in flight.
+  void setFormat(wire::Format format)
+  {
+    format_ = format;
+  }
+
+  wire::Format getFormat() const
+  {
+    return format_;
+  }
+
+  /**
+   * \brief Move the first line out of a streambuf filled by async_read_until.
+   *
+   * Unlike std::getline this doesn't need an istream.
+   * @param buff The streambuf
+   * @param size The size returned by async_read_until, including the '\n'
+   * @param line [out] The line without the '\n'.  Its capacity is reused.
+   */
+  static void takeLine(boost::asio::streambuf& buff, std::size_t size, std::string& line);
+
+  /**
+   * \brief Size of the first whole line or frame in a streambuf.
+   * @param buff The streambuf
+   * @param format Lines or frames
+   * @return The size including the '\n', like async_read_until returns.  0 if there isn't a whole one.
+   */
+  static std::size_t bufferedSize(const boost::asio::streambuf& buff, wire::Format format);
+
+  /**
+   * \brief Fixed memory for 1 outstanding asio handler.
+   *
+   * If it's already in use, or the handler is too big, it falls back to the heap.
+   */
+  class HandlerMemory
+  {
+  public:
+    HandlerMemory() = default;
+    HandlerMemory(const HandlerMemory&) = delete;
+    HandlerMemory& operator=(const HandlerMemory&) = delete;
+
+    void* allocate(std::size_t size)
+    {
+      if (!in_use_ && size <= sizeof(storage_))
+      {
+        in_use_ = true;
+        return &storage_;
+      }
+      return ::operator new(size);
+    }
+
+    void deallocate(void* pointer)
+    {
+      if (pointer == &storage_)
+        in_use_ = false;
+      else
+        ::operator delete(pointer);
+    }
+
+  private:
+    typename std::aligned_storage<512>::type storage_;
+    bool in_use_ = false;
+  };
+
+  /// Wraps a handler so asio gets its memory from a HandlerMemory
+  template <typename Handler>
+  class AllocHandler
+  {
+  public:
+    AllocHandler(HandlerMemory& memory, Handler h) : memory_(memory), handler_(h)
+    {
+    }
+
+    template <typename... Args>
+    void operator()(Args&&... args)
+    {
+      handler_(std::forward<Args>(args)...);
+    }
+
+    friend void* asio_handler_allocate(std::size_t size, AllocHandler<Handler>* this_handler)
+    {
+      return this_handler->memory_.allocate(size);
+    }
+
+    friend void asio_handler_deallocate(void* pointer, std::size_t /*size*/, AllocHandler<Handler>* this_handler)
+    {
+      this_handler->memory_.deallocate(pointer);
+    }
+
+  private:
+    HandlerMemory& memory_;
+    Handler handler_;
+  };
+
+  template <typename Handler>
+  static AllocHandler<Handler> makeAllocHandler(HandlerMemory& memory, Handler h)
+  {
+    return AllocHandler<Handler>(memory, h);
+  }
+
+private:
+  /// Write any buffer sequence and wait.  See write()
+  template <typename ConstBufferSequence>
+  void writeBuffers(const ConstBufferSequence& buffers);
+
+  /// Lets a thread wait for a handler to run.  Reused for every operation.
+  struct Completion
+  {
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done = false;
+    boost::system::error_code ec;
+    std::size_t size = 0;
+
+    void reset();
+    void set(const boost::system::error_code& e, std::size_t s);
+    bool waitFor(std::chrono::milliseconds timeout);
+    void wait();
+  };
+
+  /// Throws if the completed operation failed
+  static void throwIfError(const Completion& completion);
+
+  /// Move the first size bytes of the buffer into line.  Throws if a frame is broken.
+  void takeMessage(std::string& line, std::size_t size);
+
+  boost::asio::ip::tcp::socket& socket_;
+  boost::asio::streambuf buff_;
+
+  Completion write_done_;
+  Completion read_done_;
+  bool read_pending_ = false;
+
+  wire::Format format_ = wire::Format::Text;
+
+  HandlerMemory write_memory_;
+  HandlerMemory read_memory_;
+};
+
+}  // namespace rmi_driver
+
+#endif /* INCLUDE_RMI_DRIVER_SOCKET_CHANNEL_H_ */
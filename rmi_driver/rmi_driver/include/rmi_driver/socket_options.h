@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+#ifndef INCLUDE_RMI_DRIVER_SOCKET_OPTIONS_H_
+#define INCLUDE_RMI_DRIVER_SOCKET_OPTIONS_H_
+
+#include <boost/asio.hpp>
+#include <string>
+
+namespace rmi_driver
+{
+/**
+ * \brief TCP options for the sockets of 1 connection.  They're set every time a socket connects.
+ *
+ * The Linux only options are ignored on other platforms.
+ */
+struct SocketOptions
+{
+  /// Disable Nagle's algorithm.  Commands and Gets are small, and a pipelined command would wait for the ack of the
+  /// one before it.
+  bool tcp_nodelay = true;
+
+  /// Ack every segment right away (TCP_QUICKACK).  Helps when the controller writes a response in pieces without
+  /// TCP_NODELAY.  Linux turns it off on its own, so it's set again after every write.  Linux only.
+  bool quick_ack = false;
+
+  int send_buffer = 0;     ///< SO_SNDBUF in bytes.  0 == OS default
+  int receive_buffer = 0;  ///< SO_RCVBUF in bytes.  0 == OS default
+
+  bool keep_alive = false;      ///< SO_KEEPALIVE.  Finds a dead peer on an idle socket.
+  int keep_alive_idle = 0;      ///< Seconds idle before the first probe.  0 == OS default.  Linux only.
+  int keep_alive_interval = 0;  ///< Seconds between probes.  0 == OS default.  Linux only.
+  int keep_alive_count = 0;     ///< Unanswered probes before the socket fails.  0 == OS default.  Linux only.
+};
+
+/**
+ * \brief Set the options on a connected socket.
+ *
+ * Every option is tried, even if one fails.
+ * @param socket The socket
+ * @param options The options
+ * @return Empty if they were all set, otherwise the options that failed and why
+ */
+std::string applySocketOptions(boost::asio::ip::tcp::socket& socket, const SocketOptions& options);
+
+/// Set TCP_QUICKACK again if options.quick_ack is set.  Call after writing.
+void rearmQuickAck(boost::asio::ip::tcp::socket& socket, const SocketOptions& options);
+
+}  // namespace rmi_driver
+
+#endif /* INCLUDE_RMI_DRIVER_SOCKET_OPTIONS_H_ */
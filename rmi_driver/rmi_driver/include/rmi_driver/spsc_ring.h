@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+#ifndef INCLUDE_RMI_DRIVER_SPSC_RING_H_
+#define INCLUDE_RMI_DRIVER_SPSC_RING_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace rmi_driver
+{
+/**
+ * \brief Bounded lock-free ring for 1 producer thread and 1 consumer thread.
+ *
+ * push() may only be called by the producer.  front(), pop() and popIf() may only be called by the consumer.  clear(),
+ * size(), highWater() and clearEpoch() can be called from any thread.
+ *
+ * clear() never blocks.  It marks everything that has been pushed so far as removed and increments the clear epoch.
+ * The removed entries stop counting against freeSpace() right away, even if the consumer is busy.  If push() needs
+ * their slots, the producer takes them back itself.  The consumer only touches a slot while it copies or moves an
+ * entry out, so the producer never waits for longer than that.
+ */
+template <typename T>
+class SpscRing
+{
+public:
+  /**
+   * @param capacity Max number of entries.  Rounded up to a power of 2.
+   */
+  explicit SpscRing(std::size_t capacity)
+  {
+    std::size_t size = 2;
+    while (size < capacity)
+      size <<= 1;
+
+    slots_.resize(size);
+    mask_ = size - 1;
+  }
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  std::size_t capacity() const
+  {
+    return slots_.size();
+  }
+
+  /**
+   * \brief Add an entry to the back.  Producer only.
+   *
+   * @param item The entry
+   * @return False if the ring is full
+   */
+  bool push(T item)
+  {
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) >= slots_.size() &&
+        tail - reclaimCleared() >= slots_.size())
+      return false;
+
+    slots_[tail & mask_] = std::move(item);
+    tail_.store(tail + 1, std::memory_order_release);
+
+    std::size_t depth = size();
+    if (depth > high_water_.load(std::memory_order_relaxed))
+      high_water_.store(depth, std::memory_order_relaxed);
+
+    return true;
+  }
+
+  /**
+   * \brief Number of entries push() is guaranteed to accept.  Producer only.
+   *
+   * Entries removed by clear() count as free space.
+   */
+  std::size_t freeSpace() const
+  {
+    return slots_.size() - size();
+  }
+
+  /**
+   * \brief Copy the oldest entry.  Consumer only.
+   *
+   * @param out Set to the oldest entry
+   * @return False if it's empty
+   */
+  bool front(T& out)
+  {
+    return consume([&out](T& slot) {
+      out = slot;
+      return false;
+    });
+  }
+
+  /**
+   * \brief Remove the oldest entry.  Consumer only.
+   *
+   * @return False if it was empty
+   */
+  bool pop()
+  {
+    return consume([](T&) { return true; });
+  }
+
+  /**
+   * \brief Move the oldest entry out and remove it.  Consumer only.
+   *
+   * @param out Set to the oldest entry
+   * @return False if it was empty
+   */
+  bool pop(T& out)
+  {
+    return consume([&out](T& slot) {
+      out = std::move(slot);
+      return true;
+    });
+  }
+
+  /**
+   * \brief Remove the oldest entry if it's equal to expected.  Consumer only.
+   *
+   * Use it to finish an entry that was looked at with front(), without removing a newer one if the ring was cleared in
+   * the meantime.
+   * @return True if an entry was removed
+   */
+  bool popIf(const T& expected)
+  {
+    bool removed = false;
+    consume([&expected, &removed](T& slot) {
+      removed = slot == expected;
+      return removed;
+    });
+    return removed;
+  }
+
+  /**
+   * \brief Remove everything that has been pushed so far.  Any thread.
+   *
+   * @return The number of entries that were removed
+   */
+  std::size_t clear()
+  {
+    std::size_t removed = size();
+
+    std::size_t tail = tail_.load(std::memory_order_acquire);
+    std::size_t clear_to = clear_to_.load(std::memory_order_relaxed);
+    while (clear_to < tail && !clear_to_.compare_exchange_weak(clear_to, tail, std::memory_order_seq_cst))
+    {
+    }
+
+    clear_epoch_.fetch_add(1, std::memory_order_acq_rel);
+    return removed;
+  }
+
+  /// Incremented by every clear().  Lets the consumer tell if something it took out was cleared afterwards.
+  std::uint64_t clearEpoch() const
+  {
+    return clear_epoch_.load(std::memory_order_acquire);
+  }
+
+  /// Number of entries that haven't been popped or cleared.  Only a snapshot if called from other threads.
+  std::size_t size() const
+  {
+    std::size_t head = head_.load(std::memory_order_acquire);
+    std::size_t clear_to = clear_to_.load(std::memory_order_acquire);
+    std::size_t tail = tail_.load(std::memory_order_acquire);
+
+    if (clear_to > head)
+      head = clear_to;
+    return tail > head ? tail - head : 0;
+  }
+
+  bool empty() const
+  {
+    return size() == 0;
+  }
+
+  /// The largest size() seen by push()
+  std::size_t highWater() const
+  {
+    return high_water_.load(std::memory_order_relaxed);
+  }
+
+private:
+  /**
+   * \brief Run visit on the oldest entry that hasn't been cleared.  Consumer only.
+   *
+   * held_ tells the producer which slot is being read, so reclaimCleared() can't reuse it until visit is done.
+   * @param visit Called with the slot.  Returns true if the entry should be removed.
+   * @return False if it was empty
+   */
+  template <typename F>
+  bool consume(F visit)
+  {
+    std::size_t pos;
+    for (;;)
+    {
+      pos = std::max(head_.load(std::memory_order_acquire), clear_to_.load(std::memory_order_acquire));
+      if (pos == tail_.load(std::memory_order_acquire))
+        return false;
+
+      held_.store(pos + 1, std::memory_order_seq_cst);
+      if (clear_to_.load(std::memory_order_seq_cst) <= pos)
+        break;
+
+      // It was cleared before it was marked as held
+      held_.store(0, std::memory_order_release);
+    }
+
+    if (visit(slots_[pos & mask_]))
+    {
+      slots_[pos & mask_] = T();
+
+      // Cleared slots before pos are skipped.  push() overwrites them.
+      std::size_t head = head_.load(std::memory_order_relaxed);
+      while (head <= pos && !head_.compare_exchange_weak(head, pos + 1, std::memory_order_acq_rel))
+      {
+      }
+    }
+
+    held_.store(0, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * \brief Take back the slots removed by clear() that the consumer hasn't skipped yet.  Producer only.
+   *
+   * @return The new head
+   */
+  std::size_t reclaimCleared()
+  {
+    std::size_t clear_to = clear_to_.load(std::memory_order_seq_cst);
+    std::size_t head = head_.load(std::memory_order_acquire);
+    while (head < clear_to && !head_.compare_exchange_weak(head, clear_to, std::memory_order_acq_rel))
+    {
+    }
+    if (head >= clear_to)
+      return head;
+
+    // The consumer may still be copying an entry it found before the clear
+    std::size_t held;
+    while ((held = held_.load(std::memory_order_seq_cst)) > head && held <= clear_to)
+      std::this_thread::yield();
+
+    for (std::size_t i = head; i != clear_to; ++i)
+      slots_[i & mask_] = T();
+
+    return clear_to;
+  }
+
+  std::vector<T> slots_;
+  std::size_t mask_;
+
+  /// Written by the consumer, and by the producer when it reclaims cleared slots.  The padding keeps the producer and
+  /// consumer indexes on separate cache lines.
+  std::atomic<std::size_t> head_{ 0 };
+  /// 1 + the position the consumer is reading, or 0
+  std::atomic<std::size_t> held_{ 0 };
+  char pad_head_[64];
+
+  /// Written by the producer
+  std::atomic<std::size_t> tail_{ 0 };
+  char pad_tail_[64];
+
+  /// Everything before this index has been cleared
+  std::atomic<std::size_t> clear_to_{ 0 };
+  std::atomic<std::uint64_t> clear_epoch_{ 0 };
+  std::atomic<std::size_t> high_water_{ 0 };
+};
+
+}  // namespace rmi_driver
+
+#endif /* INCLUDE_RMI_DRIVER_SPSC_RING_H_ */
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+#ifndef INCLUDE_RMI_DRIVER_STATE_SNAPSHOT_H_
+#define INCLUDE_RMI_DRIVER_STATE_SNAPSHOT_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace rmi_driver
+{
+/**
+ * \brief Seqlock for handing a small, trivially copyable value from 1 writer thread to any number of readers.
+ *
+ * store() never blocks or waits for readers.  load() retries until it copies a value that wasn't being written at the
+ * same time, so readers always get a complete sample.  The value is kept in relaxed atomic words so concurrent
+ * reads/writes are well defined.
+ */
+template <typename T>
+class SeqLock
+{
+  static_assert(std::is_trivially_copyable<T>::value, "SeqLock values must be trivially copyable");
+
+public:
+  SeqLock()
+  {
+    store(T());
+    seq_.store(0, std::memory_order_relaxed);
+  }
+
+  SeqLock(const SeqLock&) = delete;
+  SeqLock& operator=(const SeqLock&) = delete;
+
+  /// Publish a new value.  Only 1 thread may call this.
+  void store(const T& value)
+  {
+    std::uint64_t words[kWords] = {};
+    std::memcpy(words, &value, sizeof(T));
+
+    std::uint64_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);  // Odd while writing
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (std::size_t i = 0; i < kWords; ++i)
+      words_[i].store(words[i], std::memory_order_relaxed);
+
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  /// Copy the latest complete value.  Any thread.
+  T load() const
+  {
+    std::uint64_t words[kWords];
+    for (;;)
+    {
+      std::uint64_t seq_before = seq_.load(std::memory_order_acquire);
+      if (seq_before & 1)
+      {
+        std::this_thread::yield();
+        continue;
+      }
+
+      for (std::size_t i = 0; i < kWords; ++i)
+        words[i] = words_[i].load(std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) == seq_before)
+        break;
+    }
+
+    T value;
+    std::memcpy(&value, words, sizeof(T));
+    return value;
+  }
+
+  /// Number of values stored so far
+  std::uint64_t count() const
+  {
+    return seq_.load(std::memory_order_acquire) / 2;
+  }
+
+private:
+  static constexpr std::size_t kWords = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+  std::atomic<std::uint64_t> seq_{ 0 };
+  std::atomic<std::uint64_t> words_[kWords];
+};
+
+/**
+ * \brief 1 coherent sample of the robot state from the Get loop.
+ *
+ * Fixed size so it can be handed to the publishing thread through a SeqLock.
+ */
+struct RobotStateSample
+{
+  static constexpr std::size_t kMaxJoints = 16;
+
+  std::uint32_t stamp_sec = 0;  ///< ros::Time of the joint values
+  std::uint32_t stamp_nsec = 0;
+  std::uint32_t num_positions = 0;
+  std::uint32_t num_velocities = 0;
+  double position[kMaxJoints] = {};
+  double velocity[kMaxJoints] = {};
+
+  std::uint32_t tool_frame_stamp_sec = 0;  ///< ros::Time of the tool frame
+  std::uint32_t tool_frame_stamp_nsec = 0;
+  double tool_frame[6] = {};  ///< x y z alpha beta gamma
+
+  /// Copy up to kMaxJoints positions.  @return false if some didn't fit
+  template <typename Vec>
+  bool setPositions(const Vec& values)
+  {
+    std::size_t max_joints = kMaxJoints;
+    num_positions = static_cast<std::uint32_t>(std::min(values.size(), max_joints));
+    std::copy(values.begin(), values.begin() + num_positions, position);
+    return values.size() <= max_joints;
+  }
+
+  /// Copy up to kMaxJoints velocities.  @return false if some didn't fit
+  template <typename Vec>
+  bool setVelocities(const Vec& values)
+  {
+    std::size_t max_joints = kMaxJoints;
+    num_velocities = static_cast<std::uint32_t>(std::min(values.size(), max_joints));
+    std::copy(values.begin(), values.begin() + num_velocities, velocity);
+    return values.size() <= max_joints;
+  }
+};
+
+}  // namespace rmi_driver
+
+#endif /* INCLUDE_RMI_DRIVER_STATE_SNAPSHOT_H_ */
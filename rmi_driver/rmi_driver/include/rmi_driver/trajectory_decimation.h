@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+#ifndef INCLUDE_RMI_DRIVER_TRAJECTORY_DECIMATION_H_
+#define INCLUDE_RMI_DRIVER_TRAJECTORY_DECIMATION_H_
+
+#include <trajectory_msgs/JointTrajectoryPoint.h>
+#include <cstddef>
+#include <vector>
+
+namespace rmi_driver
+{
+/**
+ * \brief Find the points of a trajectory that can be dropped without moving any joint more than its tolerance.
+ *
+ * Douglas-Peucker in joint space.  A point is dropped if every joint is within its tolerance of the straight line
+ * between the points that are kept around it, interpolated by time_from_start (by index if the times are equal).  The
+ * first and last points are always kept.
+ *
+ * @param points The trajectory
+ * @param tolerances Max deviation of each joint, in the same order as the positions.  0 keeps every point that
+ * moves that joint off the line.
+ * @param keep [out] Indices of the points to keep, in order
+ * @return false if a point doesn't have 1 position per tolerance.  keep has every point then.
+ */
+bool decimateTrajectory(const std::vector<trajectory_msgs::JointTrajectoryPoint>& points,
+                        const std::vector<double>& tolerances, std::vector<std::size_t>& keep);
+
+}  // namespace rmi_driver
+
+#endif /* INCLUDE_RMI_DRIVER_TRAJECTORY_DECIMATION_H_ */
@@ -62,15 +62,80 @@ typename std::enable_if<!std::numeric_limits<T>::is_integer, bool>::type almost_
  */
 std::string floatToStringNoTrailing(float fval, int precision = 4);
 
+/**
+ * \brief Append a float with no trailing zeroes to a buffer.  Same text as floatToStringNoTrailing().
+ *
+ * Doesn't allocate unless out has to grow.  Precisions up to 12 are formatted without iostreams.
+ * @param out [out] The text is appended to it
+ * @param fval float to convert
+ * @param precision max number of decimals
+ */
+void appendFloatNoTrailing(std::string& out, float fval, int precision = 4);
+
 /**
  * \brief Convert a string of numbers separated by spaces into a vector of doubles.
  *
- * \exception boost::bad_lexical_cast
+ * Stops at the first thing that isn't a number.  Use parseDoubles() to find out if the whole string was parsed.
  * @param s string of numbers.  "1 2 3.53 56.563"
  * @return Vector of doubles {1, 2, 3.53, 56.563}
  */
 std::vector<double> stringToDoubleVec(const std::string& s);
 
+/// Whitespace that can separate the numbers in a response
+inline bool isNumberSeparator(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/**
+ * \brief Parse 1 decimal number like "-12.5", "3", ".25" or "1e-3".
+ *
+ * Digits are scanned 8 at a time.  Numbers with up to 19 significant digits and a power of 10 up to 22 are converted
+ * exactly with 1 multiply or divide.  Anything else (longer numbers, nan, inf) goes through strtod.
+ * @param begin First char of the number
+ * @param end End of the buffer.  It doesn't have to be null terminated.
+ * @param value [out] The number
+ * @return Pointer past the number, or nullptr if there's no number at begin
+ */
+const char* parseDouble(const char* begin, const char* end, double& value);
+
+/**
+ * \brief Parse numbers separated by any amount of whitespace.  Doesn't copy the input.
+ *
+ * Doesn't allocate if out is a FixedVector or already has the capacity.
+ * @param out [out] Cleared first.  Keeps the numbers parsed before an error.
+ * @return false if something isn't a number or there are more numbers than out.max_size()
+ */
+template <typename Vec>
+bool parseDoubles(const char* begin, const char* end, Vec& out)
+{
+  out.clear();
+  const char* p = begin;
+  for (;;)
+  {
+    while (p != end && isNumberSeparator(*p))
+      ++p;
+    if (p == end)
+      return true;
+
+    if (out.size() == out.max_size())
+      return false;
+
+    double value;
+    p = parseDouble(p, end, value);
+    if (!p || (p != end && !isNumberSeparator(*p)))
+      return false;
+
+    out.push_back(value);
+  }
+}
+
+template <typename Vec>
+bool parseDoubles(const std::string& s, Vec& out)
+{
+  return parseDoubles(s.data(), s.data() + s.size(), out);
+}
+
 /**
  * \brief Outputs a vector as a nice string.
  *
@@ -93,22 +158,29 @@ std::string vecToPrettyString(const std::vector<T>& vec)
   return oss.str();
 }
 
-template <typename T, typename = std::enable_if<std::is_floating_point<T>::value> >
-std::string vecToString(const std::vector<T>& vec, int precision)
+/**
+ * \brief Append the values separated by spaces, each formatted like floatToStringNoTrailing().
+ * @param out [out] The text is appended to it
+ * @param vec Values to append, like a std::vector or FixedVector.  Doubles are formatted as floats.
+ * @param precision max number of decimals
+ */
+template <typename Vec>
+void appendVecToString(std::string& out, const Vec& vec, int precision)
 {
-  if (vec.empty())
-    return "";
-
-  std::ostringstream oss;
-
-  if (vec.size() > 1)
+  for (std::size_t i = 0; i < vec.size(); ++i)
   {
-    std::for_each(vec.begin(), vec.end() - 1,
-                  [&](const T& val) { oss << util::floatToStringNoTrailing(val, precision) << " "; });
+    if (i > 0)
+      out += ' ';
+    appendFloatNoTrailing(out, vec[i], precision);
   }
+}
 
-  oss << util::floatToStringNoTrailing(vec.back(), precision);
-  return oss.str();
+template <typename T, typename = std::enable_if<std::is_floating_point<T>::value> >
+std::string vecToString(const std::vector<T>& vec, int precision)
+{
+  std::string str;
+  appendVecToString(str, vec, precision);
+  return str;
 }
 
 /**
@@ -245,6 +317,40 @@ std::vector<Tdest> sortVectorByIndices(const std::vector<size_t>& indices, const
   return ret;
 }
 
+/**
+ * \brief sortVectorByIndices() into a caller owned vector, so it doesn't allocate once out is big enough.
+ *
+ * out[n] = data[indices[n]].  out is cleared if data is empty.
+ *
+ * \exception std::runtime_error unable to sort data
+ *
+ * @param indices Indicates the order to rearrange the data by.
+ * @param data The data to sort
+ * @param out [out] Sorted data.  Tsource must be able to be placed in Tdest.
+ */
+template <typename Tdest, typename Tsource>
+void sortVectorByIndices(const std::vector<size_t>& indices, const std::vector<Tsource>& data, std::vector<Tdest>& out)
+{
+  out.clear();
+  if (data.size() == 0)  // data isn't used
+    return;
+
+  if (indices.size() != data.size())  // sizes have to be equal to sort
+  {
+    std::stringstream ss;
+    ss << "sortVector failed: indices.size(" << indices.size() << ") != data.size(" << data.size() << ")";
+    throw std::runtime_error(ss.str());
+  }
+
+  out.resize(indices.size());
+  for (size_t n = 0; n < indices.size(); ++n)
+  {
+    if (indices[n] >= data.size())
+      throw std::runtime_error("index >= data.size()");
+    out[n] = data[indices[n]];
+  }
+}
+
 ///@}
 
 }  // namespace util
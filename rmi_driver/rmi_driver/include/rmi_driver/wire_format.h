@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+#ifndef INCLUDE_RMI_DRIVER_WIRE_FORMAT_H_
+#define INCLUDE_RMI_DRIVER_WIRE_FORMAT_H_
+
+#include <boost/asio.hpp>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rmi_driver
+{
+/**
+ * \brief Compact binary framing that can replace the text lines on a socket.
+ *
+ * A socket starts out in Text mode, where every message is 1 line.  After the robot agrees to switch (see
+ * CommandRegister::negotiateWireFormat), every message in both directions is a frame instead:
+ * \code
+ * <uint32 payload length><uint8 payload kind><payload>
+ * \endcode
+ * All numbers are little-endian and all values are 32 bit floats.
+ *
+ * Payload kinds:\n
+ * Text: The same string that would have been sent in Text mode, without the '\\n'.\n
+ * Floats: Groups of values.  <uint8 num groups> then for each group <uint16 count><float * count>.  Used for responses
+ * like the status, so the robot state doesn't have to be printed and parsed.\n
+ * Command: A RobotCommand with numeric params.  <uint8 num entries> then for each entry
+ * <uint8 name length><name><uint16 count><float * count>.  The names are the same as in the text format.
+ */
+namespace wire
+{
+enum class Format
+{
+  Text,   //!< 1 message per line
+  Binary  //!< Length prefixed frames
+};
+
+enum class PayloadKind : std::uint8_t
+{
+  Text = 0,
+  Floats = 1,
+  Command = 2
+};
+
+/// Size of the length prefix
+constexpr std::size_t kHeaderSize = 4;
+
+/// Frames bigger than this are treated as a broken stream
+constexpr std::uint32_t kMaxPayloadSize = 1 << 20;
+
+/// Decoded Floats payload.  Reuse it so the groups keep their capacity.
+using FloatGroups = std::vector<std::vector<double>>;
+
+/// Parse "text" or "binary" from a config file.  @return false if it's neither
+bool parseFormat(const std::string& str, Format& format);
+
+/**
+ * \brief Start a frame at the end of out.
+ *
+ * Reserves the length prefix and writes the kind.  Finish it with endFrame().
+ * @return The offset of the frame, for endFrame()
+ */
+std::size_t beginFrame(std::string& out, PayloadKind kind);
+
+/// Fill in the length prefix of the frame started at offset
+void endFrame(std::string& out, std::size_t offset);
+
+/// Append a whole Text frame
+void appendTextFrame(std::string& out, const std::string& text);
+
+void putU8(std::string& out, std::uint8_t val);
+void putU16(std::string& out, std::uint16_t val);
+
+/// Append <uint16 count><float * count>
+template <typename Vec>
+void putFloatGroup(std::string& out, const Vec& values);
+
+/**
+ * \brief Move the first frame out of a streambuf filled by async_read_until(FrameMatcher).
+ *
+ * @param buff The streambuf
+ * @param size The size returned by async_read_until
+ * @param payload [out] Everything after the length prefix, starting with the kind.  Its capacity is reused.
+ * @return false if the frame is broken
+ */
+bool takeFrame(boost::asio::streambuf& buff, std::size_t size, std::string& payload);
+
+/// Kind of a payload from takeFrame()
+inline PayloadKind payloadKind(const std::string& payload)
+{
+  return payload.empty() ? PayloadKind::Text : static_cast<PayloadKind>(payload[0]);
+}
+
+/**
+ * \brief Decode a Floats payload.
+ *
+ * @param payload From takeFrame()
+ * @param groups [out] The values.  Existing vectors are reused.
+ * @return false if it's not a valid Floats payload
+ */
+bool decodeFloats(const std::string& payload, FloatGroups& groups);
+
+/**
+ * \brief Turn any payload into the string Text mode would have received.
+ *
+ * Text payloads are copied as-is.  Float groups are written like "1 2 3;4 5 6;".  Used when the caller wants a string
+ * response, like the result of a Cmd.
+ * @param payload From takeFrame().  Replaced with the text.
+ */
+void payloadToText(std::string& payload);
+
+/**
+ * \brief async_read_until match condition for 1 frame.
+ *
+ * Matches when the length prefix and the whole payload have arrived.  A length over kMaxPayloadSize matches right after
+ * the prefix, so takeFrame() can report it instead of buffering forever.
+ */
+struct FrameMatcher
+{
+  template <typename Iterator>
+  std::pair<Iterator, bool> operator()(Iterator begin, Iterator end) const
+  {
+    if (end - begin < static_cast<std::ptrdiff_t>(kHeaderSize))
+      return std::make_pair(begin, false);
+
+    std::uint32_t len = 0;
+    Iterator it = begin;
+    for (std::size_t i = 0; i < kHeaderSize; ++i, ++it)
+      len |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(*it)) << (8 * i);
+
+    if (len > kMaxPayloadSize)
+      return std::make_pair(it, true);
+
+    if (end - it < static_cast<std::ptrdiff_t>(len))
+      return std::make_pair(begin, false);
+
+    return std::make_pair(it + len, true);
+  }
+};
+
+template <typename Vec>
+void putFloatGroup(std::string& out, const Vec& values)
+{
+  putU16(out, static_cast<std::uint16_t>(values.size()));
+
+  std::size_t pos = out.size();
+  out.resize(pos + values.size() * 4);
+  for (auto&& val : values)
+  {
+    float f = static_cast<float>(val);
+    std::uint32_t bits;
+    static_assert(sizeof(bits) == sizeof(f), "float must be 32 bits");
+    std::memcpy(&bits, &f, sizeof(f));
+    for (int i = 0; i < 4; ++i)
+      out[pos++] = static_cast<char>((bits >> (8 * i)) & 0xff);
+  }
+}
+
+}  // namespace wire
+}  // namespace rmi_driver
+
+namespace boost
+{
+namespace asio
+{
+template <>
+struct is_match_condition<rmi_driver::wire::FrameMatcher> : public boost::true_type
+{
+};
+}  // namespace asio
+}  // namespace boost
+
+#endif /* INCLUDE_RMI_DRIVER_WIRE_FORMAT_H_ */
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+#include "rmi_driver/command_list_converter.h"
+#include <ros/ros.h>
+#include <algorithm>
+#include <future>
+
+namespace rmi_driver
+{
+CommandListConverter::CommandListConverter(int threads, std::size_t chunk_size)
+  : work_(new boost::asio::io_service::work(io_service_)), chunk_size_(std::max<std::size_t>(chunk_size, 1))
+{
+  for (int i = 0; i < std::max(threads, 1); ++i)
+    threads_.emplace_back([this]() { io_service_.run(); });
+}
+
+CommandListConverter::~CommandListConverter()
+{
+  work_.reset();
+  for (auto& thread : threads_)
+  {
+    if (thread.joinable())
+      thread.join();
+  }
+}
+
+bool CommandListConverter::convert(const robot_movement_interface::CommandList& msg,
+                                   const std::vector<const CommandHandler*>& handlers, const ChunkCallback& on_chunk,
+                                   std::size_t* failed_index)
+{
+  const std::size_t num_msgs = std::min(msg.commands.size(), handlers.size());
+  const std::size_t num_chunks = (num_msgs + chunk_size_ - 1) / chunk_size_;
+  if (failed_index)
+    *failed_index = msg.commands.size();
+  if (num_chunks == 0)
+    return true;
+
+  std::atomic<bool> failed{ false };
+  std::vector<std::vector<RobotCommandPtr>> chunks(num_chunks);
+
+  // Only the first chunk that fails in order counts.  The ones after it may have been stopped by it.
+  std::vector<std::size_t> failed_at(num_chunks, msg.commands.size());
+  std::vector<std::future<bool>> results;
+  results.reserve(num_chunks);
+
+  // The workers take the chunks in order, so the one the caller needs next is usually the first one done
+  for (std::size_t i = 1; i < num_chunks; ++i)
+  {
+    auto task = std::make_shared<std::packaged_task<bool()>>(
+        [this, &msg, &handlers, &failed, &chunks, &failed_at, num_msgs, i]() {
+          return convertChunk(msg, handlers, i * chunk_size_, std::min(num_msgs, (i + 1) * chunk_size_), failed,
+                              chunks[i], failed_at[i]);
+        });
+    results.push_back(task->get_future());
+    io_service_.post([task]() { (*task)(); });
+  }
+
+  std::size_t first_failed = num_chunks;
+  bool ok = convertChunk(msg, handlers, 0, std::min(num_msgs, chunk_size_), failed, chunks[0], failed_at[0]);
+  if (!ok)
+    first_failed = 0;
+  ok = ok && on_chunk(chunks[0]);
+  if (!ok)
+    failed = true;
+
+  for (std::size_t i = 1; i < num_chunks; ++i)
+  {
+    // Wait for every chunk, even after a failure.  The workers are still using msg, handlers and chunks.
+    bool chunk_ok = results[i - 1].get();
+    if (ok && !chunk_ok)
+      first_failed = i;
+    ok = ok && chunk_ok && on_chunk(chunks[i]);
+    if (!ok)
+      failed = true;
+  }
+
+  if (failed_index && first_failed < num_chunks)
+    *failed_index = failed_at[first_failed];
+  return ok;
+}
+
+bool CommandListConverter::convertChunk(const robot_movement_interface::CommandList& msg,
+                                        const std::vector<const CommandHandler*>& handlers, std::size_t begin,
+                                        std::size_t end, const std::atomic<bool>& failed,
+                                        std::vector<RobotCommandPtr>& out, std::size_t& failed_index)
+{
+  out.reserve(end - begin);
+  for (std::size_t i = begin; i < end; ++i)
+  {
+    if (failed.load(std::memory_order_relaxed))
+      return false;
+
+    const CommandHandler* handler = handlers[i];
+    if (!handler)
+      continue;
+
+    const auto& msg_cmd = msg.commands[i];
+    RobotCommandPtr command;
+    try
+    {
+      command = handler->processMsg(msg_cmd);
+    }
+    catch (const std::exception& ex)
+    {
+      ROS_ERROR_STREAM("CommandListConverter " << handler->getName() << " threw on command_id " << msg_cmd.command_id
+                                               << ": " << ex.what());
+      failed_index = i;
+      return false;
+    }
+
+    if (!command)
+    {
+      ROS_ERROR_STREAM("CommandListConverter " << handler->getName() << " returned a null RobotCommand for command_id "
+                                               << msg_cmd.command_id);
+      failed_index = i;
+      return false;
+    }
+
+    command->setCommandId(msg_cmd.command_id);
+
+    // Format it here, in parallel, instead of in Connector::addCommand
+    if (command->getType() == RobotCommand::CommandType::Cmd)
+      command->getText();
+
+    out.push_back(std::move(command));
+  }
+  return true;
+}
+
+}  // namespace rmi_driver
@@ -32,11 +32,39 @@
 #include <ros/ros.h>
 #include <boost/algorithm/string.hpp>
 #include <boost/tokenizer.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <unordered_set>
 #include <vector>
 #include "rmi_driver/util.h"
 
 namespace rmi_driver
 {
+namespace
+{
+/// A range of RobotCommand::values_ for wire::putFloatGroup
+struct FloatRange
+{
+  const float* first;
+  const float* last;
+
+  std::size_t size() const
+  {
+    return last - first;
+  }
+  const float* begin() const
+  {
+    return first;
+  }
+  const float* end() const
+  {
+    return last;
+  }
+};
+}  // namespace
+
 // Begin Command::
 
 const robot_movement_interface::Command& CommandHandler::getSampleCommand() const
@@ -51,20 +79,88 @@ std::string RobotCommand::paramsToString(const std::vector<float>& floatVec, int
 
 std::string RobotCommand::toString(bool append_newline) const
 {
-  std::ostringstream oss;
+  std::string ret;
+  formatText(ret, append_newline);
+  return ret;
+}
+
+void RobotCommand::formatText(std::string& out, bool append_newline) const
+{
+  out.clear();
 
-  for (auto&& cmd : full_command_)
+  for (auto&& entry : entries_)
   {
-    oss << cmd.first;
-    if (cmd.second.length() > 0)
-      oss << " : " << cmd.second;
-    oss << ";";
+    out += *entry.name;
+    if (entry.text_end > entry.text_begin)
+    {
+      out += " : ";
+      out.append(text_values_, entry.text_begin, entry.text_end - entry.text_begin);
+    }
+    out += ';';
   }
   if (append_newline)
-    oss << "\n";
+    out += '\n';
+}
 
-  std::string ret = oss.str();
-  return ret;
+const std::string& RobotCommand::getText() const
+{
+  if (!text_valid_)
+  {
+    // Through the virtual, so a subclass's format is what gets sent
+    text_ = toString(true);
+    text_valid_ = true;
+  }
+  return text_;
+}
+
+bool RobotCommand::toBinary(std::string& out) const
+{
+  if (entries_.size() > std::numeric_limits<uint8_t>::max())
+    return false;
+
+  // Every entry with params needs the numbers
+  for (auto&& entry : entries_)
+  {
+    if (entry.name->length() > std::numeric_limits<uint8_t>::max())
+      return false;
+    if (entry.text_end > entry.text_begin && entry.values_end == entry.values_begin)
+      return false;
+  }
+
+  std::size_t offset = wire::beginFrame(out, wire::PayloadKind::Command);
+  wire::putU8(out, static_cast<uint8_t>(entries_.size()));
+  for (auto&& entry : entries_)
+  {
+    wire::putU8(out, static_cast<uint8_t>(entry.name->length()));
+    out += *entry.name;
+    wire::putFloatGroup(out, FloatRange{ values_.data() + entry.values_begin, values_.data() + entry.values_end });
+  }
+  wire::endFrame(out, offset);
+
+  return true;
+}
+
+void RobotCommand::toWire(std::string& out, wire::Format format) const
+{
+  const std::string& text = getText();
+  if (format == wire::Format::Text)
+  {
+    out = text;
+    return;
+  }
+
+  out.clear();
+  if (toBinary(out))
+    return;
+
+  // The frame replaces the '\n'
+  std::size_t length = text.length();
+  if (length > 0 && text[length - 1] == '\n')
+    --length;
+
+  std::size_t offset = wire::beginFrame(out, wire::PayloadKind::Text);
+  out.append(text, 0, length);
+  wire::endFrame(out, offset);
 }
 
 bool RobotCommand::checkResponse(std::string& response) const
@@ -73,39 +169,159 @@ bool RobotCommand::checkResponse(std::string& response) const
   return !boost::istarts_with(response, "error");
 }
 
-void RobotCommand::makeCommand(CommandType type, std::string command, std::string params, bool erase_params)
+bool RobotCommand::checkResponse(wire::FloatGroups& groups) const
 {
-  type_ = type;
-  if (erase_params)
-    full_command_.clear();
+  processResponse(groups);
+  return !groups.empty();
+}
 
-  if (full_command_.size() > 0)
-    full_command_[0] = std::make_pair(command, params);  //@todo check this
-  else
-    full_command_.emplace_back(command, params);
+const std::string* RobotCommand::internName(const std::string& name)
+{
+  // Never destroyed, so commands in static storage can still use their names.  unordered_set never moves its elements.
+  static std::mutex* mutex = new std::mutex;
+  static std::unordered_set<std::string>* names = new std::unordered_set<std::string>;
+
+  std::lock_guard<std::mutex> lock(*mutex);
+  auto found = names->find(name);
+  if (found != names->end())
+    return &*found;
+
+  if (names->size() >= kMaxInternedNames)
+    return nullptr;
+
+  return &*names->insert(name).first;
 }
 
-void RobotCommand::addParam(std::string param, std::string param_vals)
+const std::string* RobotCommand::makeName(const std::string& name)
+{
+  const std::string* interned = internName(name);
+  if (interned)
+    return interned;
+
+  owned_names_.push_back(std::make_shared<const std::string>(name));
+  return owned_names_.back().get();
+}
+
+RobotCommand::Entry RobotCommand::makeEntry(const std::string& name, const std::string& text)
 {
-  if (full_command_.empty())
-    full_command_[1] = std::make_pair(param, param_vals);
+  Entry entry;
+  entry.name = makeName(name);
+  entry.text_begin = static_cast<std::uint32_t>(text_values_.size());
+  text_values_ += text;
+  entry.text_end = static_cast<std::uint32_t>(text_values_.size());
+  entry.values_begin = entry.values_end = static_cast<std::uint32_t>(values_.size());
+  return entry;
+}
+
+RobotCommand::Entry RobotCommand::makeEntry(const std::string& name, const std::vector<float>& values, int precision)
+{
+  // Room for the command and a few params without growing
+  if (values_.capacity() == 0)
+  {
+    text_values_.reserve(192);
+    values_.reserve(32);
+  }
+
+  Entry entry;
+  entry.name = makeName(name);
+  entry.text_begin = static_cast<std::uint32_t>(text_values_.size());
+  util::appendVecToString(text_values_, values, precision);
+  entry.text_end = static_cast<std::uint32_t>(text_values_.size());
+  entry.values_begin = static_cast<std::uint32_t>(values_.size());
+  values_.insert(values_.end(), values.begin(), values.end());
+  entry.values_end = static_cast<std::uint32_t>(values_.size());
+  return entry;
+}
+
+void RobotCommand::setFirstEntry(const Entry& entry)
+{
+  if (entries_.empty())
+  {
+    // Most commands have a few params
+    entries_.reserve(4);
+    entries_.push_back(entry);
+  }
   else
-    full_command_.emplace_back(param, param_vals);
+  {
+    // The old values stay in the buffers until the command is gone
+    entries_[0] = entry;
+  }
 }
 
-// Eclipse has a fit every time I try to call resize(int) or construct the vector with a size,
-// even though it compiles fine, so I have no way to guarantee that the vector isn't empty.
-// So, I need to check at() and return a string, not a reference to one.
-std::string RobotCommand::getCommand() const
+void RobotCommand::makeCommand(CommandType type, std::string command, std::string params, bool erase_params)
 {
-  try
+  type_ = type;
+  invalidateText();
+
+  // Nothing else uses the buffers
+  if (erase_params || entries_.size() <= 1)
   {
-    return full_command_.at(0).first;
+    entries_.clear();
+    text_values_.clear();
+    values_.clear();
+    owned_names_.clear();
   }
-  catch (const std::out_of_range& oor)
+
+  // The text params replace any numbers
+  setFirstEntry(makeEntry(command, params));
+}
+
+void RobotCommand::setCommand(std::string command, const std::vector<float>& values, int precision)
+{
+  invalidateText();
+  if (entries_.size() <= 1)
   {
-    return "";
+    entries_.clear();
+    text_values_.clear();
+    values_.clear();
+    owned_names_.clear();
   }
+
+  setFirstEntry(makeEntry(command, values, precision));
+}
+
+void RobotCommand::addParam(std::string param, std::string param_vals)
+{
+  invalidateText();
+  if (entries_.empty())
+    setFirstEntry(makeEntry("", ""));
+
+  entries_.push_back(makeEntry(param, param_vals));
+}
+
+void RobotCommand::addParam(std::string param, const std::vector<float>& values, int precision)
+{
+  invalidateText();
+  if (entries_.empty())
+    setFirstEntry(makeEntry("", ""));
+
+  entries_.push_back(makeEntry(param, values, precision));
+}
+
+const std::string& RobotCommand::getCommand() const
+{
+  static const std::string empty;
+  return entries_.empty() ? empty : *entries_.front().name;
+}
+
+RobotCommand::FullCommand RobotCommand::getFullCommand() const
+{
+  FullCommand full_command;
+  for (auto&& entry : entries_)
+    full_command.emplace_back(*entry.name, text_values_.substr(entry.text_begin, entry.text_end - entry.text_begin));
+  return full_command;
+}
+
+void RobotCommand::setFullCommand(const FullCommand& full_command)
+{
+  invalidateText();
+  entries_.clear();
+  text_values_.clear();
+  values_.clear();
+  owned_names_.clear();
+
+  for (auto&& entry : full_command)
+    entries_.push_back(makeEntry(entry.first, entry.second));
 }
 
 RobotCommand::CommandType RobotCommand::getType() const
@@ -128,6 +344,44 @@ void RobotCommand::setCommandId(int commandId)
   command_id_ = commandId;
 }
 
+bool RobotCommandStatus::parseGroups(const std::string& response)
+{
+  Values* groups[] = { &joint_positions_, &joint_velocities_, &tcp_frame_ };
+  for (auto group : groups)
+    group->clear();
+
+  const char* begin = response.data();
+  const char* end = begin + response.size();
+  while (end != begin && util::isNumberSeparator(*(end - 1)))
+    --end;
+  if (end != begin && *(end - 1) == ';')
+    --end;
+
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    const char* group_end = std::find(begin, end, ';');
+
+    // Only the last group may reach the end
+    bool last = i == 2;
+    if ((group_end == end) != last)
+      return false;
+
+    if (!util::parseDoubles(begin, group_end, *groups[i]))
+      return false;
+
+    if (!last)
+      begin = group_end + 1;
+  }
+  return true;
+}
+
+const std::string& RobotCommandStatus::groupToString(const Values& group, std::string& out)
+{
+  out.clear();
+  util::appendVecToString(out, group, 6);
+  return out;
+}
+
 // Begin CommandHandler::
 
 CommandHandler::CommandHandler(const robot_movement_interface::Command& sample_command, CommandHandlerFunc f)
@@ -137,53 +391,94 @@ CommandHandler::CommandHandler(const robot_movement_interface::Command& sample_c
 
 bool CommandHandler::operator==(const robot_movement_interface::Command& cmd_msg)
 {
-  int idx = 0;
+  if (!compiled_)
+    compileSample();
+
   // Check strings for usage and equality
   // Check vectors for usage and length
+  if (match_command_type_.find(cmd_msg.command_type) < 0)
+    return false;
 
-  if (util::usedAndNotEqual(sample_command_.command_type, cmd_msg.command_type))
+  int pose_type_index = match_pose_.find(cmd_msg.pose_type);
+  if (pose_type_index < 0)
     return false;
 
-  if (util::usedAndNotEqual(sample_command_.pose_reference, cmd_msg.pose_reference))
+  return matchRemaining(cmd_msg, pose_type_index);
+}
+
+void CommandHandler::compileSample()
+{
+  match_command_type_.compile(sample_command_.command_type);
+  match_pose_reference_.compile(sample_command_.pose_reference);
+  match_pose_.compile(sample_command_.pose_type, sample_command_.pose);
+  match_velocity_.compile(sample_command_.velocity_type, sample_command_.velocity);
+  match_acceleration_.compile(sample_command_.acceleration_type, sample_command_.acceleration);
+  match_force_threshold_.compile(sample_command_.force_threshold_type, sample_command_.force_threshold);
+  match_effort_.compile(sample_command_.effort_type, sample_command_.effort);
+  match_blending_.compile(sample_command_.blending_type, sample_command_.blending);
+  compiled_ = true;
+}
+
+bool CommandHandler::matchRemaining(const robot_movement_interface::Command& cmd_msg, int pose_type_index) const
+{
+  if (match_pose_reference_.find(cmd_msg.pose_reference) < 0)
     return false;
 
   // pose_type/pose
-  if (util::usedAndNotEqual(sample_command_.pose_type, cmd_msg.pose_type, &idx))
-    return false;
-  if (util::usedAndNotEqualIdx(idx, sample_command_.pose, cmd_msg.pose))
+  if (!match_pose_.sizeMatches(pose_type_index, cmd_msg.pose.size()))
     return false;
 
-  // Velocity
-  if (util::usedAndNotEqual(sample_command_.velocity_type, cmd_msg.velocity_type, &idx))
-    return false;
-  if (util::usedAndNotEqualIdx(idx, sample_command_.velocity, cmd_msg.velocity))
-    return false;
+  return match_velocity_.matches(cmd_msg.velocity_type, cmd_msg.velocity.size()) &&
+         match_acceleration_.matches(cmd_msg.acceleration_type, cmd_msg.acceleration.size()) &&
+         match_force_threshold_.matches(cmd_msg.force_threshold_type, cmd_msg.force_threshold.size()) &&
+         match_effort_.matches(cmd_msg.effort_type, cmd_msg.effort.size()) &&
+         match_blending_.matches(cmd_msg.blending_type, cmd_msg.blending.size());
+}
 
-  // Acceleration
-  if (util::usedAndNotEqual(sample_command_.acceleration_type, cmd_msg.acceleration_type, &idx))
-    return false;
-  if (util::usedAndNotEqualIdx(idx, sample_command_.acceleration, cmd_msg.acceleration))
-    return false;
+void CommandHandler::SampleField::compile(const std::string& sample_str, const std::vector<float>& sample_sizes)
+{
+  entries.clear();
+  if (!sample_str.empty())
+  {
+    // Same as the boost::tokenizer with keep_empty_tokens in util::usedAndNotEqual
+    std::size_t begin = 0;
+    for (;;)
+    {
+      std::size_t end = sample_str.find('|', begin);
+      entries.push_back(sample_str.substr(begin, end - begin));
+      if (end == std::string::npos)
+        break;
+      begin = end + 1;
+    }
+  }
 
-  // Force
-  if (util::usedAndNotEqual(sample_command_.force_threshold_type, cmd_msg.force_threshold_type, &idx))
-    return false;
-  if (util::usedAndNotEqualIdx(idx, sample_command_.force_threshold, cmd_msg.force_threshold))
-    return false;
+  sizes.clear();
+  for (float size : sample_sizes)
+    sizes.push_back(std::lround(size));
+}
 
-  // Effort
-  if (util::usedAndNotEqual(sample_command_.effort_type, cmd_msg.effort_type, &idx))
-    return false;
-  if (util::usedAndNotEqualIdx(idx, sample_command_.effort, cmd_msg.effort))
-    return false;
+int CommandHandler::SampleField::find(const std::string& msg) const
+{
+  if (entries.empty())
+    return 0;
 
-  // Blending
-  if (util::usedAndNotEqual(sample_command_.blending_type, cmd_msg.blending_type, &idx))
-    return false;
-  if (util::usedAndNotEqualIdx(idx, sample_command_.blending, cmd_msg.blending))
+  for (std::size_t i = 0; i < entries.size(); ++i)
+  {
+    if (entries[i] == msg)
+      return static_cast<int>(i);
+  }
+  return -1;
+}
+
+bool CommandHandler::SampleField::sizeMatches(int entry_index, std::size_t size) const
+{
+  if (sizes.empty())
+    return true;
+
+  if (entry_index < 0 || static_cast<std::size_t>(entry_index) >= sizes.size())
     return false;
 
-  return true;  // If it got this far it's a match
+  return sizes[entry_index] == static_cast<long>(size);
 }
 
 std::ostream& operator<<(std::ostream& o, const CommandHandler& cmdh)
@@ -239,19 +534,72 @@ std::ostream& CommandHandler::dump(std::ostream& o) const
   return o;
 }
 
-const CommandHandler* CommandRegister::findHandler(const robot_movement_interface::Command& msg_cmd)
+const CommandHandler* CommandRegister::findHandler(const robot_movement_interface::Command& msg_cmd) const
 {
-  auto foundItem = std::find_if(this->handlers().begin(), this->handlers().end(),
-                                [&](const std::unique_ptr<CommandHandler>& p) { return *p.get() == msg_cmd; });
+  auto by_command_type = dispatch_.find(msg_cmd.command_type);
+  const DispatchEntry& entry = by_command_type != dispatch_.end() ? by_command_type->second : dispatch_other_;
+
+  auto by_pose_type = entry.by_pose_type.find(msg_cmd.pose_type);
+  const auto& candidates = by_pose_type != entry.by_pose_type.end() ? by_pose_type->second : entry.other_pose_types;
 
-  if (foundItem != std::end(this->handlers()))
+  for (const auto& candidate : candidates)
   {
-    return foundItem->get();
+    if (candidate.first->matchRemaining(msg_cmd, candidate.second))
+      return candidate.first;
   }
-  else
+
+  return nullptr;
+}
+
+void CommandRegister::indexHandlers()
+{
+  for (auto& handler : command_handlers_)
+    handler->compileSample();
+
+  // Every command_type and pose_type a sample names gets a key.  A key's list has every handler that names it and
+  // every handler that doesn't check that field, so the order of the handlers decides the match like it always has.
+  auto build_entry = [this](const std::string* command_type) {
+    DispatchEntry entry;
+    for (auto& handler : command_handlers_)
+    {
+      const auto& command_field = handler->getCommandTypeField();
+      bool matches = command_type ? command_field.find(*command_type) >= 0 : command_field.entries.empty();
+      if (!matches)
+        continue;
+
+      const auto& pose_field = handler->getPoseField();
+      if (pose_field.entries.empty())
+      {
+        entry.other_pose_types.emplace_back(handler.get(), 0);
+        for (auto& by_pose_type : entry.by_pose_type)
+          by_pose_type.second.emplace_back(handler.get(), 0);
+        continue;
+      }
+
+      for (std::size_t i = 0; i < pose_field.entries.size(); ++i)
+      {
+        // A new key starts with the handlers that don't check pose_type
+        auto inserted = entry.by_pose_type.emplace(pose_field.entries[i], entry.other_pose_types);
+        auto& candidates = inserted.first->second;
+
+        // Only the first entry that's equal counts, like util::usedAndNotEqual
+        if (candidates.empty() || candidates.back().first != handler.get())
+          candidates.emplace_back(handler.get(), static_cast<int>(i));
+      }
+    }
+    return entry;
+  };
+
+  dispatch_.clear();
+  for (auto& handler : command_handlers_)
   {
-    return nullptr;
+    for (const auto& command_type : handler->getCommandTypeField().entries)
+    {
+      if (dispatch_.count(command_type) == 0)
+        dispatch_[command_type] = build_entry(&command_type);
+    }
   }
+  dispatch_other_ = build_entry(nullptr);
 }
 
 RobotCommandPtr CommandHandler::processMsg(const robot_movement_interface::Command& cmd_msg) const
@@ -283,7 +631,11 @@ JtaCommandHandler::processJta(const trajectory_msgs::JointTrajectory& joint_traj
 
   // Process the first point
   if (joint_trajectory.points.size() >= 1)
+  {
+    // Room for a few extra commands on the first/last point
+    cmd_list.commands.reserve(joint_trajectory.points.size() + 4);
     processFirstJtaPoint(joint_trajectory.points.front(), cmd_list);
+  }
   else
     return cmd_list;
 
@@ -302,37 +654,93 @@ JtaCommandHandler::processJta(const trajectory_msgs::JointTrajectory& joint_traj
   return cmd_list;
 }
 
+robot_movement_interface::CommandList
+JtaCommandHandler::processJta(const trajectory_msgs::JointTrajectory& joint_trajectory,
+                              const std::vector<size_t>& mapping)
+{
+  robot_movement_interface::CommandList cmd_list;
+
+  const auto& points = joint_trajectory.points;
+
+  // A subclass may have its own processJta(joint_trajectory), so it gets the whole trajectory sorted
+  if (!usesPointHooks())
+  {
+    trajectory_msgs::JointTrajectory traj_sorted;
+    traj_sorted.header = joint_trajectory.header;
+    util::sortVectorByIndices(mapping, joint_trajectory.joint_names, traj_sorted.joint_names);
+    traj_sorted.points.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+      util::sortVectorByIndices(mapping, points[i].positions, traj_sorted.points[i].positions);
+      util::sortVectorByIndices(mapping, points[i].velocities, traj_sorted.points[i].velocities);
+      util::sortVectorByIndices(mapping, points[i].accelerations, traj_sorted.points[i].accelerations);
+      util::sortVectorByIndices(mapping, points[i].effort, traj_sorted.points[i].effort);
+      traj_sorted.points[i].time_from_start = points[i].time_from_start;
+    }
+    return processJta(traj_sorted);
+  }
+
+  if (points.empty())
+    return cmd_list;
+
+  // Room for a few extra commands on the first/last point
+  cmd_list.commands.reserve(points.size() + 4);
+
+  // Every point is sorted into this one, so its vectors are only allocated once
+  trajectory_msgs::JointTrajectoryPoint sorted;
+  auto sort = [&mapping, &sorted](const trajectory_msgs::JointTrajectoryPoint& point)
+      -> const trajectory_msgs::JointTrajectoryPoint& {
+    util::sortVectorByIndices(mapping, point.positions, sorted.positions);
+    util::sortVectorByIndices(mapping, point.velocities, sorted.velocities);
+    util::sortVectorByIndices(mapping, point.accelerations, sorted.accelerations);
+    util::sortVectorByIndices(mapping, point.effort, sorted.effort);
+    sorted.time_from_start = point.time_from_start;
+    return sorted;
+  };
+
+  processFirstJtaPoint(sort(points.front()), cmd_list);
+
+  for (size_t i = 1; i + 1 < points.size(); ++i)
+    processJtaPoint(sort(points[i]), cmd_list);
+
+  if (points.size() >= 2)
+    processLastJtaPoint(sort(points.back()), cmd_list);
+
+  return cmd_list;
+}
+
 void JtaCommandHandler::processJtaPoint(const trajectory_msgs::JointTrajectoryPoint& point,
                                         robot_movement_interface::CommandList& cmd_list)
 {
-  robot_movement_interface::Command cmd;
+  // Made in place in the list, so the vectors are only allocated once
+  uint32_t command_id = getNextCommandId(cmd_list);
+  cmd_list.commands.emplace_back();
+  robot_movement_interface::Command& cmd = cmd_list.commands.back();
 
-  cmd.command_id = getNextCommandId(cmd_list);
+  cmd.command_id = command_id;
 
   cmd.command_type = "PTP";
   cmd.pose_type = "JOINTS";
 
-  std::copy(point.positions.begin(), point.positions.end(), std::back_inserter(cmd.pose));
+  cmd.pose.assign(point.positions.begin(), point.positions.end());
 
   if (point.accelerations.size() > 0)
   {
     cmd.acceleration_type = "ROS";
-    std::copy(point.accelerations.begin(), point.accelerations.end(), std::back_inserter(cmd.acceleration));
+    cmd.acceleration.assign(point.accelerations.begin(), point.accelerations.end());
   }
 
   if (point.velocities.size() > 0)
   {
     cmd.velocity_type = "ROS";
-    std::copy(point.velocities.begin(), point.velocities.end(), std::back_inserter(cmd.velocity));
+    cmd.velocity.assign(point.velocities.begin(), point.velocities.end());
   }
 
   if (point.effort.size() > 0)
   {
     cmd.effort_type = "ROS";
-    std::copy(point.effort.begin(), point.effort.end(), std::back_inserter(cmd.effort));
+    cmd.effort.assign(point.effort.begin(), point.effort.end());
   }
-
-  cmd_list.commands.push_back(cmd);
 }
 
 }  // namespace rmi_driver
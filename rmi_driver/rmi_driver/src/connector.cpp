@@ -31,8 +31,12 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/asio/use_future.hpp>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
 #include <future>
+#include <iomanip>
 #include <memory>
+#include <sstream>
 #include "rmi_driver/rotation_utils.h"
 #include "rmi_driver/util.h"
 
@@ -42,9 +46,10 @@ using namespace boost::asio::ip;
 
 Connector::Connector(std::string ns, boost::asio::io_service &io_service, std::string host, int port,
                      StringVec joint_names, CmdRegLoaderPtr cmd_reg_loader, CommandRegisterPtr cmd_register,
-                     bool clear_commands_on_error)
+                     bool clear_commands_on_error, const ConnectionConfig &con_cfg)
   : ns_(ns)
   , io_service_(io_service)
+  , strand_(io_service)
   , socket_cmd_(io_service)
   , socket_get_(io_service)
   , host_(host)
@@ -53,11 +58,41 @@ Connector::Connector(std::string ns, boost::asio::io_service &io_service, std::s
   , nh_(ns)
   , cmd_reg_loader_(cmd_reg_loader)
   , clear_commands_on_error_(clear_commands_on_error)
+  , command_queue_(con_cfg.cmd_queue_size_)
+  , cmd_pipeline_depth_(std::max(con_cfg.cmd_pipeline_depth_, 1))
+  , cmd_batch_size_(std::max(con_cfg.cmd_batch_size_, 1))
+  , cmd_batch_bytes_(std::max(con_cfg.cmd_batch_bytes_, 1))
+  , get_rate_(con_cfg.get_rate_)
+  , get_rates_(con_cfg.get_rates_)
+  , get_timer_(io_service)
+  , get_deadline_(io_service)
+  , status_stream_rate_(con_cfg.status_stream_rate_)
+  , socket_stream_(io_service)
+  , stream_timer_(io_service)
+  , cmd_channel_(socket_cmd_)
+  , async_cmd_(con_cfg.async_cmd_)
+  , socket_options_(con_cfg.socket_options_)
+  , cmd_cancel_timer_(io_service)
+  , cmd_wake_timer_(io_service)
   , logger_("CONNECTOR", ns)
 
 {
   joint_names_ = joint_names;
 
+  if (con_cfg.ingest_threads_ > 0)
+  {
+    converter_.reset(new CommandListConverter(con_cfg.ingest_threads_, con_cfg.ingest_chunk_size_));
+    ingest_partial_lists_ = con_cfg.ingest_partial_lists_;
+    logger_.INFO() << "Parallel command_list ingestion enabled.  Chunks of " << converter_->getChunkSize() << " on "
+                   << converter_->getThreads() << " threads" << (ingest_partial_lists_ ? ", queued as they're ready" : "");
+  }
+
+  // The biggest batch.  Sized once so the buffers of a batch stay valid.
+  cmd_async_send_strs_.resize(std::min(cmd_batch_size_, cmd_pipeline_depth_));
+  if (joint_names_.size() > RobotStateSample::kMaxJoints)
+    logger_.ERROR() << "Too many joints (" << joint_names_.size() << ").  Only the first "
+                    << static_cast<int>(RobotStateSample::kMaxJoints) << " will be published";
+
   command_result_pub_ = nh_.advertise<robot_movement_interface::Result>("command_result", 30);
   command_list_sub_ = nh_.subscribe("command_list", 1, &Connector::subCB_CommandList, this);
 
@@ -65,7 +100,39 @@ Connector::Connector(std::string ns, boost::asio::io_service &io_service, std::s
 
   tool_frame_pose_pub_ = nh_.advertise<geometry_msgs::PoseStamped>("tool_frame_pose", 30);
 
+  // Give up on the stream after a few missed pushes
+  stream_stale_timeout_ = std::chrono::milliseconds(100);
+  if (status_stream_rate_ > 0)
+    stream_stale_timeout_ = std::max(stream_stale_timeout_,
+                                     std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                         std::chrono::duration<double>(5.0 / status_stream_rate_)));
+
+  // A dead link shows up as a Get that isn't answered in time.  The heartbeat makes sure there always is one.
+  heartbeat_period_ = con_cfg.heartbeat_period_;
+  cmd_socket_options_ = socket_options_;
+  if (heartbeat_period_ > 0)
+  {
+    poll_timeout_ = std::chrono::milliseconds(std::max(1L, std::lround(con_cfg.heartbeat_timeout_ * 1000)));
+
+    // In case only the Cmd connection dies.  TCP keepalive can't go below 1s.
+    if (!cmd_socket_options_.keep_alive)
+    {
+      cmd_socket_options_.keep_alive = true;
+      cmd_socket_options_.keep_alive_idle = 1;
+      cmd_socket_options_.keep_alive_interval = 1;
+      cmd_socket_options_.keep_alive_count = 3;
+    }
+  }
+
   logger_.INFO() << "Created a new Connector";
+  if (cmd_pipeline_depth_ > 1)
+    logger_.INFO() << "Cmd pipelining enabled.  Up to " << cmd_pipeline_depth_ << " commands will be in flight";
+  if (cmd_batch_size_ > 1)
+    logger_.INFO() << "Cmd batching enabled.  Up to " << cmd_batch_size_ << " commands or " << cmd_batch_bytes_
+                   << " bytes per write";
+  if (heartbeat_period_ > 0)
+    logger_.INFO() << "Heartbeat enabled.  The link is lost if a polled Get isn't answered within "
+                   << poll_timeout_.count() << "ms";
 }
 
 bool Connector::connect()
@@ -77,15 +144,25 @@ void Connector::stop()
 {
   std::cout << "Connector::stop() begin\n";
 
+  stopping_ = true;
+
+  // The timers belong to the strand
+  strand_.post([this]() {
+    get_timer_.cancel();
+    get_deadline_.cancel();
+    stream_timer_.cancel();
+    cmd_wake_timer_.cancel();
+    ++stream_id_;
+    boost::system::error_code ignored;
+    socket_stream_.close(ignored);
+  });
+
   this->socket_cmd_.shutdown(boost::asio::socket_base::shutdown_type::shutdown_both);
   this->socket_get_.shutdown(boost::asio::socket_base::shutdown_type::shutdown_both);
 
   this->socket_cmd_.close();
   this->socket_get_.close();
 
-  if (get_thread_.joinable())
-    get_thread_.join();
-
   if (cmd_thread_.joinable())
     cmd_thread_.join();
 
@@ -95,6 +172,29 @@ void Connector::stop()
 
 void Connector::cancelSocketCmd(int timeout)
 {
+  if (async_cmd_)
+  {
+    // Nothing holds the socket.  Give the commands in flight the same chance to finish, then cancel them.
+    strand_.post([this, timeout]() {
+      cmd_cancel_timer_.expires_from_now(std::chrono::milliseconds(timeout));
+      cmd_cancel_timer_.async_wait(strand_.wrap([this](const boost::system::error_code &ec) {
+        if (ec)
+          return;
+
+        if (cmd_async_in_flight_.empty())
+        {
+          logger_.INFO() << "cancelSocketCmd() nothing in flight, no need to cancel";
+          return;
+        }
+
+        logger_.INFO() << "cancelSocketCmd() " << cmd_async_in_flight_.size() << " commands in flight, canceling";
+        boost::system::error_code ignored;
+        socket_cmd_.cancel(ignored);
+      }));
+    });
+    return;
+  }
+
   // Give the socket a chance to finish.  If an abort is sent, active motion commands may be able to finish naturally
   // and respond.
   if (socket_cmd_mutex_.try_lock_for(std::chrono::milliseconds(timeout)))
@@ -123,7 +223,7 @@ bool Connector::connectSocket(std::string host, int port, RobotCommand::CommandT
   tcp::resolver::query query(host, boost::lexical_cast<std::string>(local_port));
   tcp::resolver::iterator endpointIterator = resolver.resolve(query);
 
-  std::thread *thread;
+  std::thread *thread = nullptr;
   boost::asio::ip::tcp::socket *sock;
 
   if (cmd_type == RobotCommand::CommandType::Cmd)
@@ -133,17 +233,17 @@ bool Connector::connectSocket(std::string host, int port, RobotCommand::CommandT
   }
   else if (cmd_type == RobotCommand::CommandType::Get)
   {
-    thread = &get_thread_;
     sock = &socket_get_;
   }
 
-  // Wait until the correct thread exits cleanly
-  if (thread->joinable())
+  // Wait until the Cmd thread exits cleanly.  The Get loop has already stopped if it's reconnecting.
+  if (thread && thread->joinable())
     thread->join();
 
   boost::asio::async_connect(
       *sock, endpointIterator,
-      [this, host, local_port, cmd_type](const boost::system::error_code &ec, tcp::resolver::iterator i) {
+      strand_.wrap([this, host, local_port, cmd_type](const boost::system::error_code &ec,
+                                                      tcp::resolver::iterator i) {
         std::string con_type = "NOT SET";
         if (cmd_type == RobotCommand::CommandType::Cmd)
           con_type = "Cmd";
@@ -157,32 +257,48 @@ bool Connector::connectSocket(std::string host, int port, RobotCommand::CommandT
           ss << "Socket(" << con_type << " " << host << ":" << local_port << ") Ec was set " << ec.message();
           logger_.ERROR() << ss.str();
 
-          // Clear the command list if connecting failed
-          if (command_list_.size() > 0 && cmd_type == RobotCommand::CommandType::Cmd)
+          // Clear the command list if connecting failed.  The Cmd thread isn't running, so this is the queue's consumer.
+          RobotCommandPtr front;
+          if (cmd_type == RobotCommand::CommandType::Cmd && command_queue_.front(front))
           {
-            publishRmiResult(command_list_.front()->getCommandId(), CommandResultCodes::SOCKET_FAILED_TO_CONNECT,
+            publishRmiResult(front->getCommandId(), CommandResultCodes::SOCKET_FAILED_TO_CONNECT,
                              "Cmd socket failed to connect, clearing commands");
             clearCommands();
             logger_.ERROR() << "Clearing command list because the socket failed to connect while commands were waiting";
           }
 
-          std::this_thread::sleep_for(std::chrono::seconds(1));
-          connectSocket(host, local_port, cmd_type);
+          // Wait without blocking the io_service.  The Get loops of other connections run on it.
+          auto retry_timer = std::make_shared<boost::asio::steady_timer>(io_service_, std::chrono::seconds(1));
+          retry_timer->async_wait(
+              strand_.wrap([this, retry_timer, host, local_port, cmd_type](const boost::system::error_code &) {
+                if (!stopping_)
+                  connectSocket(host, local_port, cmd_type);
+              }));
         }
         else  // Connected, launch the correct thread
         {
+          std::string option_errors =
+              cmd_type == RobotCommand::CommandType::Cmd ? applySocketOptions(socket_cmd_, cmd_socket_options_) :
+                                                           applySocketOptions(socket_get_, socket_options_);
+          if (!option_errors.empty())
+            logger_.WARN() << "Socket(" << con_type << ") options failed: " << option_errors;
+
           if (cmd_type == RobotCommand::CommandType::Cmd)
           {
-            cmd_thread_ = std::thread(&Connector::cmdThread, this);
+            cmd_link_lost_ = false;
+            if (async_cmd_)
+              startAsyncCmd();
+            else
+              cmd_thread_ = std::thread(&Connector::cmdThread, this);
           }
           else if (cmd_type == RobotCommand::CommandType::Get)
           {
-            get_thread_ = std::thread(&Connector::getThread, this);
+            startGetLoop();
           }
 
           logger_.INFO() << " Async Socket(" << con_type << ") established to " << host << ":" << local_port;
         }
-      });
+      }));
 
   return true;
 }
@@ -207,169 +323,173 @@ void Connector::cmdSocketFlusher()
     // Consume the buffer to reset it.
     socket_cmd_flush_buff_.consume(socket_cmd_flush_buff_.size());
 
-    boost::asio::async_read_until(
-        socket_cmd_, socket_cmd_flush_buff_, '\n', [&](const boost::system::error_code &e, std::size_t size) {
-          if (e)  // If there is an error code, this was either cancelled or disconnected.
-          {
-            logger_.INFO() << "Connector::cmdSocketFlusher() is exiting with ec: " << e.message();
-            flush_socket_cmd_ = false;
-            return;
-          }
-          else  // Some message was consumed.  That should hopefully be the only one, but read again anyway.
-          {
-            std::string line;
-            std::istream is(&socket_cmd_flush_buff_);
-            std::getline(is, line);
+    bool binary = cmd_wire_format_ == wire::Format::Binary;
+    auto on_read = [this, binary](const boost::system::error_code &e, std::size_t size) {
+      if (e)  // If there is an error code, this was either cancelled or disconnected.
+      {
+        logger_.INFO() << "Connector::cmdSocketFlusher() is exiting with ec: " << e.message();
+        flush_socket_cmd_ = false;
+        return;
+      }
+      else  // Some message was consumed.  That should hopefully be the only one, but read again anyway.
+      {
+        std::string line;
+        if (binary && wire::takeFrame(socket_cmd_flush_buff_, size, line))
+        {
+          wire::payloadToText(line);
+        }
+        else if (!binary)
+        {
+          std::istream is(&socket_cmd_flush_buff_);
+          std::getline(is, line);
+        }
 
-            logger_.INFO() << "Connector::cmdSocketFlusher() flushed a message (" << size << "): " << line;
-            if (flush_socket_cmd_)
-              cmdSocketFlusher();
-          }
-        });
+        logger_.INFO() << "Connector::cmdSocketFlusher() flushed a message (" << size << "): " << line;
+        if (flush_socket_cmd_)
+          cmdSocketFlusher();
+      }
+    };
+
+    if (binary)
+      boost::asio::async_read_until(socket_cmd_, socket_cmd_flush_buff_, wire::FrameMatcher(), strand_.wrap(on_read));
+    else
+      boost::asio::async_read_until(socket_cmd_, socket_cmd_flush_buff_, '\n', strand_.wrap(on_read));
   }
 }
 
 std::string Connector::sendCommand(const RobotCommand &command)
 {
-  tcp::socket *socket = NULL;
-  std::timed_mutex *mutex = NULL;
+  std::string response;
+  sendCommand(command, response);
+  return response;
+}
+
+void Connector::sendCommand(const RobotCommand &command, std::string &response)
+{
   if (command.getType() == RobotCommand::CommandType::Get)
   {
-    socket = &socket_get_;
-    mutex = &socket_get_mutex_;
+    response = sendGetCommand(command);
+    return;
   }
-  else if (command.getType() == RobotCommand::CommandType::Cmd)
-  {
-    socket = &socket_cmd_;
-    mutex = &socket_cmd_mutex_;
 
-    if (flush_socket_cmd_)  // Flusher active, stop it
-    {
-      flush_socket_cmd_ = false;
-      socket->cancel();
-    }
+  if (command.getType() != RobotCommand::CommandType::Cmd)
+  {
+    response = "Error: null socket";
+    return;
   }
 
-  if (socket == NULL || mutex == NULL)
+  if (async_cmd_)
   {
-    return "Error: null socket";
+    // Hand it to the strand.  It's written before the next queued command.  This blocks until the response, so the op
+    // can point at the caller's command without owning it.  A copy would lose a subclass's overrides.
+    CmdOp op;
+    op.cmd = RobotCommandPtr(RobotCommandPtr(), const_cast<RobotCommand *>(&command));
+    op.promise = std::make_shared<std::promise<std::string>>();
+    auto future = op.promise->get_future();
+    strand_.post([this, op]() mutable {
+      cmd_async_requests_.push_back(std::move(op));
+      cmd_wake_timer_.cancel();
+    });
+
+    response = future.get();
+    return;
   }
 
-  std::string sendStr = command.toString();
-
-  std::lock_guard<std::timed_mutex> lock(*mutex);
-
-  std::promise<size_t> promise_sendCommand;
-  auto future_sendCommand = promise_sendCommand.get_future();
-
-  boost::asio::streambuf buff;
+  requestCmdSocket(command, response);
+}
 
-  // Perform an asynchronous write.  This enables canceling.
-  // I'm using futures instead of launching things from inside the write handler to maintain a more
-  // synchronous style.
-  boost::asio::async_write(
-      *socket, boost::asio::buffer(sendStr), [&](const boost::system::error_code &e, std::size_t size) {
-        if (e)
-        {
-          // Let the future have the exception
-          promise_sendCommand.set_exception(std::make_exception_ptr(boost::system::system_error(e)));
-        }
-        else
-        {
-          promise_sendCommand.set_value(size);
-        }
-      });
+void Connector::requestCmdSocket(const RobotCommand &command, std::string &response)
+{
+  std::lock_guard<std::timed_mutex> lock(socket_cmd_mutex_);
 
-  try
+  if (flush_socket_cmd_)  // Flusher active, stop it
   {
-    future_sendCommand.wait();
-  }
-  catch (const std::exception &e)
-  {
-    throw;
+    flush_socket_cmd_ = false;
+    socket_cmd_.cancel();
   }
 
-  promise_sendCommand = std::promise<size_t>();
-  future_sendCommand = promise_sendCommand.get_future();
+  const std::string &data = command.wireData(cmd_send_str_, cmd_wire_format_);
+
+  // Anything left over from a previous, canceled request is stale
+  cmd_channel_.clear();
+
+  // The socket operations are asynchronous so they can be canceled by cancelSocketCmd().  Cmd could take a while to get
+  // a response, so there is no timeout.
+  CommandLatency &latency = latency_stats_.get(command.getCommand());
+  auto write_start = std::chrono::steady_clock::now();
+  cmd_channel_.write(data);
+  rearmQuickAck(socket_cmd_, socket_options_);
+  auto write_done = std::chrono::steady_clock::now();
+  latency.write.record(write_done - write_start);
+  ++cmd_writes_;
+  ++cmd_commands_written_;
+
+  cmd_channel_.asyncReadLine();
+  cmd_channel_.waitReadLine(response);
+  latency.response.record(std::chrono::steady_clock::now() - write_done);
+}
 
-  boost::asio::async_read_until(*socket, buff, '\n', [&](const boost::system::error_code &e, std::size_t size) {
-    if (e)
-    {
-      promise_sendCommand.set_exception(std::make_exception_ptr(boost::system::system_error(e)));
-    }
-    else
-    {
-      promise_sendCommand.set_value(size);
-    }
-  });
+void Connector::switchCmdWireFormat()
+{
+  wire::Format format = wire_format_;
+  if (format == cmd_wire_format_ || cmd_wire_format_failed_)
+    return;
 
-  // old synchronous methods
-  // boost::asio::write(*socket, boost::asio::buffer(sendStr));
-  // boost::asio::read_until(*socket, buff, '\n');
-
-  /*
-   * This <works> but I don't understand it.  The usual boost::asio::use_future doesn't work.  Giving it an allocator
-   * makes it happy, but to be honest I don't really understand how use_future_t actually works and gets back to
-   * an async result and exactly what kind of allocator it actually wants.
-   *
-   * See: https://github.com/chriskohlhoff/asio/issues/112
-   *
-   */
-  // static boost::asio::use_future_t<std::allocator<std::size_t>> use_future;
-  // std::future<std::size_t> read_future = boost::asio::async_read_until(*socket, buff, '\n', use_future);
-
-  // Cmd could take a while to get a response, but Get must be quick.  When I pull the network cable, async_read_until
-  // doesn't throw anything, so a timeout on the future is the easiest way to tell something is wrong.
-  if (command.getType() == RobotCommand::CommandType::Get)
-  {
-    auto status = future_sendCommand.wait_for(std::chrono::milliseconds(500));
-    if (status != std::future_status::ready)
-      socket->close();
-  }
-  else
-    future_sendCommand.wait();
+  auto cmd = cmd_register_->makeWireFormatCommand(format);
+  if (!cmd)
+    return;
 
-  try
-  {
-    future_sendCommand.get();
-    std::string line;
-    std::istream is(&buff);
-    std::getline(is, line);
+  std::string response;
+  requestCmdSocket(*cmd, response);
 
-    return line;
+  if (cmd->checkResponse(response))
+  {
+    std::lock_guard<std::timed_mutex> lock(socket_cmd_mutex_);
+    cmd_wire_format_ = format;
+    cmd_channel_.setFormat(format);
+    logger_.INFO() << " Cmd socket switched to the " << (format == wire::Format::Binary ? "binary" : "text")
+                   << " wire format";
   }
-  catch (const std::exception &e)
+  else
   {
-    // Maybe I should throw this up to whatever thread called send?
-    throw;
-    // return "error internal";
+    cmd_wire_format_failed_ = true;
+    logger_.ERROR() << " The robot refused to switch the Cmd socket's wire format: " << response;
   }
 }
 
-void Connector::addCommand(RobotCommandPtr command)
+bool Connector::addCommand(RobotCommandPtr command)
 {
-  if (command->getType() == RobotCommand::CommandType::Cmd)
+  if (command->getType() != RobotCommand::CommandType::Cmd)
   {
-    command_list_mutex_.lock();
-    command_list_.push_back(command);
-    command_list_mutex_.unlock();
+    logger_.ERROR() << "Connector::addCommand invalid command type";
+    return false;
   }
-  else
+
+  // Format it here, not on the Cmd thread.  It's written from this string.
+  command->getText();
+
+  command->setQueuedTime(std::chrono::steady_clock::now());
+  if (!command_queue_.push(std::move(command)))
   {
-    logger_.ERROR() << "Connector::addCommand invalid command type";
+    logger_.ERROR() << "Connector::addCommand the command queue is full (" << command_queue_.capacity() << ")";
+    return false;
   }
+
+  wakeCmdWriter();
+  return true;
 }
 
 void Connector::clearCommands()
 {
-  command_list_mutex_.lock();
-  logger_.INFO() << "Connector::clearCommands clearing " << command_list_.size() << " entries";
-  command_list_ = std::deque<RobotCommandPtr>();
-  command_list_mutex_.unlock();
+  auto cleared = command_queue_.clear();
+  logger_.INFO() << "Connector::clearCommands clearing " << cleared << " entries";
 }
 
 bool Connector::commandListCb(const robot_movement_interface::CommandList &msg)
 {
+  if (converter_ && msg.commands.size() > converter_->getChunkSize())
+    return commandListCbParallel(msg);
+
   auto conn = this;
   auto cmd_register = this->getCommandRegister();
 
@@ -396,6 +516,7 @@ bool Connector::commandListCb(const robot_movement_interface::CommandList &msg)
       if (!robot_command_ptr)
       {
         logger_.ERROR() << "Connector::commandListCb got a null telnet_command_ptr";
+        publishRmiResult(msg_cmd.command_id, CommandResultCodes::FAILED_TO_PROCESS, "Failed to process command");
         goto error_abort;
       }
 
@@ -409,25 +530,7 @@ bool Connector::commandListCb(const robot_movement_interface::CommandList &msg)
       }
       else  // A Get was received as part of a CommandList.
       {
-        logger_.WARN() << "Got a high priority command via a message: " << robot_command_ptr->getCommand();
-
-        // Call cancelSocketCmd with async.  It will block while it tries to acquire the mutex.
-        auto fut = std::async(std::launch::async, &Connector::cancelSocketCmd, conn, 50);
-
-        std::string send_response = conn->sendCommand(*robot_command_ptr);
-        boost::trim_right(send_response);
-
-        // Publish the result  @todo is this really the right thing to do?  It will publish over the same channel.
-        auto abort_res_code = CommandResultCodes::ABORT_OK;
-        if (!boost::istarts_with(send_response, "aborted"))
-        {
-          abort_res_code = CommandResultCodes::ABORT_FAIL;
-        }
-        publishRmiResult(robot_command_ptr->getCommandId(), abort_res_code, send_response);
-
-        logger_.INFO() << "High priority response: " << send_response;
-
-        fut.wait();
+        sendHighPriority(*robot_command_ptr);
       }
       continue;
     }
@@ -445,6 +548,15 @@ bool Connector::commandListCb(const robot_movement_interface::CommandList &msg)
     }
   }
 
+  // Add all or nothing
+  if (command_vect.size() > command_queue_.freeSpace())
+  {
+    logger_.ERROR() << "Connector::commandListCb " << command_vect.size() << " commands don't fit in the queue.  "
+                    << command_queue_.freeSpace() << " of " << command_queue_.capacity() << " entries are free";
+    publishRmiResult(command_vect.front()->getCommandId(), CommandResultCodes::QUEUE_FULL, "Command queue is full");
+    goto error_abort;
+  }
+
   // We made it here without errors so add all the commands to the list.
   for (auto &&cmd : command_vect)
   {
@@ -459,6 +571,124 @@ error_abort:
   return true;
 }
 
+bool Connector::commandListCbParallel(const robot_movement_interface::CommandList &msg)
+{
+  const size_t num_cmds = msg.commands.size();
+  logger_.INFO() << "Received a new command_list of size: " << num_cmds << ".  Converting it in chunks of "
+                 << converter_->getChunkSize() << " on " << converter_->getThreads() + 1 << " threads";
+
+  if (msg.replace_previous_commands)
+    clearCommands();
+
+  // Find every handler before anything is queued, so an unknown command still rejects the whole list.  findHandler is
+  // cheap next to processMsg.
+  std::vector<const CommandHandler *> handlers(num_cmds);
+  size_t num_found = 0;
+  for (size_t i = 0; i < num_cmds; ++i)
+  {
+    handlers[i] = cmd_register_->findHandler(msg.commands[i]);
+    if (handlers[i])
+    {
+      ++num_found;
+      continue;
+    }
+
+    logger_.ERROR() << "Failed to find cmd handler for: " << msg.commands[i];
+    publishRmiResult(msg.commands[i].command_id, CommandResultCodes::FAILED_TO_FIND_HANDLER,
+                     "Failed to find cmd handler");
+    if (abort_on_fail_to_find_)
+    {
+      logger_.ERROR() << " Not adding any commands from this list and clearing any existing commands!";
+      clearCommands();
+      return true;
+    }
+  }
+
+  // The types aren't known until the commands are made, so a Get in the list counts against the free space too
+  if (num_found > command_queue_.freeSpace())
+  {
+    logger_.ERROR() << "Connector::commandListCb " << num_found << " commands don't fit in the queue.  "
+                    << command_queue_.freeSpace() << " of " << command_queue_.capacity() << " entries are free";
+    publishRmiResult(msg.commands.front().command_id, CommandResultCodes::QUEUE_FULL, "Command queue is full");
+    logger_.ERROR() << " Not adding any commands from this list and clearing any existing commands!";
+    clearCommands();
+    return true;
+  }
+
+  // By default the Cmds are held until the whole list converted.  With ingest_partial_lists_ each chunk is queued as
+  // soon as it's ready, so the robot can start on the first one while the rest are converted.
+  std::vector<RobotCommandPtr> command_vect;
+  if (!ingest_partial_lists_)
+    command_vect.reserve(num_found);
+
+  size_t queued = 0;
+  size_t failed_index = num_cmds;
+  bool ok = converter_->convert(msg, handlers,
+                                [this, &queued, &command_vect](std::vector<RobotCommandPtr> &commands) {
+                                  for (auto &&cmd : commands)
+                                  {
+                                    if (cmd->getType() != RobotCommand::CommandType::Cmd)
+                                      sendHighPriority(*cmd);
+                                    else if (!ingest_partial_lists_)
+                                      command_vect.push_back(std::move(cmd));
+                                    else if (!addCommand(cmd))
+                                      return false;
+                                    else
+                                      ++queued;
+                                  }
+                                  return true;
+                                },
+                                &failed_index);
+
+  for (size_t i = 0; ok && i < command_vect.size(); ++i)
+  {
+    ok = addCommand(command_vect[i]);
+    if (ok)
+      ++queued;
+  }
+
+  if (!ok)
+  {
+    if (failed_index < num_cmds)
+      publishRmiResult(msg.commands[failed_index].command_id, CommandResultCodes::FAILED_TO_PROCESS,
+                       "Failed to process command");
+
+    logger_.ERROR() << " Not adding any more commands from this list and clearing any existing commands!  " << queued
+                    << " of them were already queued";
+    clearCommands();
+  }
+  return true;
+}
+
+void Connector::sendHighPriority(const RobotCommand &command)
+{
+  logger_.WARN() << "Got a high priority command via a message: " << command.getCommand();
+
+  // Call cancelSocketCmd with async.  It will block while it tries to acquire the mutex.  The async Cmd path doesn't
+  // block, so it doesn't need a thread.
+  std::future<void> fut;
+  if (async_cmd_)
+    cancelSocketCmd(50);
+  else
+    fut = std::async(std::launch::async, &Connector::cancelSocketCmd, this, 50);
+
+  std::string send_response = sendCommand(command);
+  boost::trim_right(send_response);
+
+  // Publish the result  @todo is this really the right thing to do?  It will publish over the same channel.
+  auto abort_res_code = CommandResultCodes::ABORT_OK;
+  if (!boost::istarts_with(send_response, "aborted"))
+  {
+    abort_res_code = CommandResultCodes::ABORT_FAIL;
+  }
+  publishRmiResult(command.getCommandId(), abort_res_code, send_response);
+
+  logger_.INFO() << "High priority response: " << send_response;
+
+  if (fut.valid())
+    fut.wait();
+}
+
 void Connector::publishRmiResult(int command_id, int result_code, std::string additional_information) const
 {
   robot_movement_interface::Result result;
@@ -498,322 +728,1665 @@ RobotCommandPtr Connector::findGetCommand(const std::string &command_type, const
   return robot_cmd;
 }
 
-void Connector::getThread()
+std::string Connector::sendGetCommand(const RobotCommand &command)
 {
-  util::setThreadName("get_thr");
-  ros::Rate rate(50);
+  auto request = std::make_shared<GetRequest>();
+  request->send_str = command.toString(false);
+  request->latency = &latency_stats_.get(command.getCommand());
+  request->queued_time = std::chrono::steady_clock::now();
+  auto future = request->promise.get_future();
+
+  // Hand it to the Get loop.  If it's waiting for the next poll, wake it up.
+  strand_.post([this, request]() {
+    get_requests_.push_back(request);
+    if (get_loop_state_ == GetLoopState::Waiting)
+      get_timer_.cancel();
+  });
+
+  // When I pull the network cable, async_read_until doesn't throw anything, so a timeout on the future is the easiest
+  // way to tell something is wrong.  It can be queued behind 1 poll that is already in flight.
+  if (future.wait_for(get_timeout_ + poll_timeout_) != std::future_status::ready)
+  {
+    request->abandoned = true;
+    throw boost::system::system_error(boost::asio::error::timed_out);
+  }
+
+  return future.get();
+}
 
+void Connector::startGetLoop()
+{
   // Fetch the required RobotCommands from the plugin.
-  auto get_joint_position = findGetCommand("GET", "JOINT_POSITION");
-  auto get_version = findGetCommand("GET", "VERSION");
-  auto get_tool_frame = findGetCommand("GET", "TOOL_FRAME");
+  get_joint_position_ = findGetCommand("GET", "JOINT_POSITION");
+  get_version_ = findGetCommand("GET", "VERSION");
+  get_tool_frame_ = findGetCommand("GET", "TOOL_FRAME");
 
-  auto get_status = findGetCommand("GET", "STATUS");
+  get_status_ = findGetCommand("GET", "STATUS");
 
-  if (!get_joint_position || !get_version || !get_tool_frame)
+  if (!get_joint_position_ || !get_version_ || !get_tool_frame_)
   {
     /// @todo make a nice link to a section of docs
-    logger_.FATAL() << "One of the getThread handlers failed to be found.  Your plugin MUST implement these!";
+    logger_.FATAL() << "One of the Get loop handlers failed to be found.  Your plugin MUST implement these!";
 
     return;
   }
 
-  RobotCommandStatus *get_status_ptr = 0;
-  if (get_status)
+  scheduleGetItems();
+
+  get_loop_state_ = GetLoopState::Busy;
+  get_timed_out_ = false;
+  socket_get_buff_.consume(socket_get_buff_.size());
+
+  // A new socket always starts as text
+  get_wire_format_ = wire::Format::Text;
+  get_response_binary_ = false;
+
+  // The robot may have been updated while it was disconnected
+  if (stream_state_ == StreamState::Unsupported)
+    stream_state_ = StreamState::Off;
+
+  // Check the version string
+  encodeGet(*get_version_);
+  asyncGet(get_send_str_, get_timeout_, [this](std::string &response) { negotiateWireFormat(response); });
+}
+
+void Connector::negotiateWireFormat(std::string &response)
+{
+  setConnectionState(ConnectionState::Connected, "The robot answered on the Get socket");
+
+  // The robot can list what it supports after the version, like "0.0.9 binary"
+  std::string version = response.substr(0, response.find(' '));
+  if (version.compare(cmd_register_->getVersion()) != 0)
+  {
+    logger_.ERROR() << "WARNING!  The version returned by the robot does NOT match the version of the active "
+                    << "command register!  Things may not work!";
+
+    logger_.ERROR() << "Command register version: " << cmd_register_->getVersion() << ", robot version: " << response;
+  }
+  else
   {
-    get_status_ptr = (RobotCommandStatus *)get_status.get();
+    logger_.INFO() << " Command register version matches the robot: " << response;
   }
 
-  std::string response;
-  std::vector<double> pos_real;
-  std::vector<double> vel_real;
+  wire::Format format = cmd_register_->negotiateWireFormat(response);
+  RobotCommandPtr switch_cmd;
+  if (format != wire::Format::Text)
+    switch_cmd = cmd_register_->makeWireFormatCommand(format);
 
-  // Check the version string
-  try
+  if (!switch_cmd)
   {
-    response = sendCommand(*get_version);
-    if (response.compare(cmd_register_->getVersion()) != 0)
-    {
-      logger_.ERROR() << "WARNING!  The version returned by the robot does NOT match the version of the active "
-                      << "command register!  Things may not work!";
+    wire_format_ = wire::Format::Text;
+    startStatusStream();
+    getCycle();
+    return;
+  }
 
-      logger_.ERROR() << "Command register version: " << cmd_register_->getVersion() << ", robot version: " << response;
+  encodeGet(*switch_cmd);
+  asyncGet(get_send_str_, get_timeout_, [this, switch_cmd, format](std::string &response) {
+    if (switch_cmd->checkResponse(response))
+    {
+      get_wire_format_ = format;
+      logger_.INFO() << " Get socket switched to the binary wire format";
     }
     else
     {
-      logger_.INFO() << " Command register version matches the robot: " << response;
+      logger_.ERROR() << " The robot refused to switch the Get socket's wire format: " << response;
     }
+
+    // The Cmd thread follows the Get socket
+    wire_format_ = get_wire_format_;
+    startStatusStream();
+    getCycle();
+  });
+}
+
+void Connector::getCycle()
+{
+  if (stopping_ || !ros::ok())
+  {
+    get_loop_state_ = GetLoopState::Stopped;
+    return;
   }
-  catch (const boost::system::system_error &ex)
+
+  get_loop_state_ = GetLoopState::Busy;
+
+  // High priority Gets go first
+  while (!get_requests_.empty())
   {
-    logger_.INFO() << "Connector::getThread exception: " << ex.what();
+    GetRequestPtr request = get_requests_.front();
+    get_requests_.pop_front();
+    if (request->abandoned)
+      continue;
 
-    if (ex.code() != boost::asio::error::operation_aborted)
+    get_current_request_ = request;
+    request->latency->queue_wait.record(std::chrono::steady_clock::now() - request->queued_time);
+    if (get_wire_format_ == wire::Format::Text)
     {
-      // Relaunch the get socket/thread
-      std::thread(&Connector::connectSocket, this, host_, port_ + 1, RobotCommand::CommandType::Get).detach();
-      return;
+      get_send_str_ = request->send_str;
+      get_send_str_ += '\n';
     }
+    else
+    {
+      get_send_str_.clear();
+      wire::appendTextFrame(get_send_str_, request->send_str);
+    }
+
+    asyncGet(get_send_str_, get_timeout_, [this, request](std::string &response) {
+      get_current_request_.reset();
+      if (get_response_binary_)
+        wire::payloadToText(response);
+      request->promise.set_value(response);
+      getCycle();
+    }, request->latency);
+    return;
   }
 
-  while (ros::ok())
+  // Earliest deadline first.  The status stream covers everything but the Aux items and the heartbeat.
+  GetItem *next = nullptr;
+  for (auto &item : get_items_)
   {
-    try
-    {
-      // Get the joint positions
-      if (get_status)
-      {
-        response = sendCommand(*get_status);
-        if (!get_status->checkResponse(response))
-        {
-          logger_.ERROR() << "Get status failed to process: " << response;
-          continue;
-        }
-        get_status_ptr->updateData(response);
-        pos_real = util::stringToDoubleVec(get_status_ptr->getLastJointState());
-        vel_real = util::stringToDoubleVec(get_status_ptr->getLastJointVel());
-      }
-      else
-      {
-        response = sendCommand(*get_joint_position);
-        if (!get_joint_position->checkResponse(response))
-        {
-          logger_.ERROR() << "Failed to check joint position.  This is bad: " << response;
-          continue;
-        }
-        pos_real = util::stringToDoubleVec(response);
-        //###TODO Check vel here too
-      }
+    if (streaming_ && item->kind != GetItemKind::Aux && item->kind != GetItemKind::Heartbeat)
+      continue;
+    if (!next || item->deadline < next->deadline)
+      next = item.get();
+  }
 
-      last_joint_state_.header.stamp = ros::Time::now();
-      last_joint_state_.name = joint_names_;
-      last_joint_state_.position = pos_real;
-      last_joint_state_.velocity = vel_real;
+  auto now = std::chrono::steady_clock::now();
+  if (!next || now < next->deadline)
+  {
+    get_loop_state_ = GetLoopState::Waiting;
+    // Nothing to poll while streaming.  stopStatusStream() wakes it up.
+    if (next)
+      get_timer_.expires_at(next->deadline);
+    else
+      get_timer_.expires_from_now(std::chrono::hours(1));
+    // Also canceled by sendGetCommand() to send a high priority Get right away
+    get_timer_.async_wait(strand_.wrap([this](const boost::system::error_code &) { getCycle(); }));
+    return;
+  }
 
-      if (last_joint_state_.name.size() != last_joint_state_.position.size())
-      {
-        ROS_ERROR_STREAM_THROTTLE(
-            1, ns_ << " ERROR: Connector::getThread number of positions received(" << last_joint_state_.position.size()
-                   << ") doesn't match number of configured joints(" << last_joint_state_.name.size() << ")!");
-      }
+  // How late it is
+  next->latency->queue_wait.record(now - next->deadline);
 
-      // Get the tool frame in euler zyx
-      if (get_status)
-      {
-        pos_real = util::stringToDoubleVec(get_status_ptr->getLastTcpFrame());
-      }
-      else
-      {
-        response = sendCommand(*get_tool_frame);
-        if (!get_tool_frame->checkResponse(response))
-        {
-          logger_.ERROR() << "Failed to check tool frame.  This is bad: " << response;
-          continue;
-        }
-        pos_real = util::stringToDoubleVec(response);
-      }
-      if (pos_real.size() != 6)
-      {
-        logger_.ERROR() << " ERROR: Connector::getThread GET TOOL_FRAME size wrong!  Expected 6, got "
-                        << pos_real.size() << ".  Raw msg: " << response;
-        continue;
-      }
+  // Don't try to catch up if a poll was missed
+  next->deadline += next->period;
+  if (next->deadline < now)
+  {
+    if (next->period != std::chrono::steady_clock::duration::zero())
+      ++next->overruns;
+    next->deadline = now + next->period;
+  }
 
-      last_tool_frame_.x = pos_real[0];
-      last_tool_frame_.y = pos_real[1];
-      last_tool_frame_.z = pos_real[2];
-      last_tool_frame_.alpha = pos_real[3];
-      last_tool_frame_.beta = pos_real[4];
-      last_tool_frame_.gamma = pos_real[5];
+  ++next->polls;
+  pollGetItem(*next);
+}
 
-      // No need to calculate the Pose every time, but I should save the time
-      last_tool_frame_pose_.header.stamp = ros::Time::now();
-    }
-    catch (const boost::bad_lexical_cast &)
-    {
-      logger_.ERROR() << " Connector::getThread: Unable to parse Get response: " << response;
+void Connector::pollGetItem(GetItem &item)
+{
+  encodeGet(*item.cmd);
 
-      continue;
-    }
-    catch (const boost::system::system_error &ex)
+  switch (item.kind)
+  {
+    case GetItemKind::Status:
+      asyncGet(get_send_str_, poll_timeout_, [this](std::string &response) {
+        processGetStatus(response);
+        getCycle();
+      }, item.latency);
+      break;
+
+    case GetItemKind::JointPosition:
+      asyncGet(get_send_str_, poll_timeout_, [this](std::string &response) {
+        if (processGetJointPosition(response))
+          storeStateSample();
+        getCycle();
+      }, item.latency);
+      break;
+
+    case GetItemKind::ToolFrame:
+      asyncGet(get_send_str_, poll_timeout_, [this](std::string &response) {
+        processGetToolFrame(response);
+        storeStateSample();
+        getCycle();
+      }, item.latency);
+      break;
+
+    case GetItemKind::Aux:
     {
-      logger_.INFO() << " Connector::getThread exception: " << ex.what();
+      GetItem *aux = &item;
+      asyncGet(get_send_str_, poll_timeout_, [this, aux](std::string &response) {
+        // Still the raw payload if it was decoded into get_groups_
+        if (get_response_binary_)
+          wire::payloadToText(response);
 
-      if (ex.code() != boost::asio::error::operation_aborted)
-      {
-        // Relaunch the get socket/thread
-        logger_.ERROR() << "Get socket error: " << ex.what();
-        std::thread(&Connector::connectSocket, this, host_, port_ + 1, RobotCommand::CommandType::Get).detach();
-        return;
-      }
+        {
+          std::lock_guard<std::mutex> lock(get_items_mutex_);
+          aux->last_response = response;
+        }
+        getCycle();
+      }, item.latency);
+      break;
     }
 
-    rate.sleep();
+    case GetItemKind::Heartbeat:
+      // Being answered is all it has to do
+      asyncGet(get_send_str_, poll_timeout_, [this](std::string &) { getCycle(); }, item.latency);
+      break;
   }
 }
 
-void Connector::cmdThread()
+void Connector::scheduleGetItems()
 {
-  util::setThreadName("cmd_thr");
-  ros::Rate rate(30);
-  logger_.INFO() << " Connector::cmdThread() starting";
-
-  RobotCommandPtr cmd;
+  auto now = std::chrono::steady_clock::now();
 
-  // Start the flusher.  There could be some message in the buffer if this thread was just restarted.
-  flush_socket_cmd_ = true;
-  cmdSocketFlusher();
+  std::lock_guard<std::mutex> lock(get_items_mutex_);
+  if (!get_items_.empty())
+  {
+    for (auto &item : get_items_)
+      item->deadline = now;
+    return;
+  }
 
-  // Check for messages to send, send them 1 at a time and wait for a response for each one.  Send a
-  // robot_movement_interface::Result for each one.
-  while (!ros::isShuttingDown())
+  auto add_item = [this, now](const std::string &name, GetItemKind kind, RobotCommandPtr cmd) {
+    auto found = get_rates_.find(name);
+    double rate = found == get_rates_.end() ? get_rate_ : found->second;
+    if (kind == GetItemKind::Heartbeat)
+      rate = 1.0 / heartbeat_period_;
+
+    GetItemPtr item(new GetItem());
+    item->name = name;
+    item->kind = kind;
+    item->cmd = cmd;
+    item->latency = &latency_stats_.get(cmd->getCommand());
+    item->rate = rate;
+    item->period = std::chrono::steady_clock::duration::zero();
+    if (rate > 0)
+      item->period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(1.0 / rate));
+    item->deadline = now;
+
+    logger_.INFO() << "Get loop polls " << name << " at " << (rate > 0 ? std::to_string(rate) + "hz" : "max rate");
+    get_items_.push_back(std::move(item));
+  };
+
+  bool separate = !get_status_ || get_rates_.count("JOINT_POSITION") || get_rates_.count("TOOL_FRAME");
+  if (separate)
   {
-    // Separate the command list mutex and the socket mutex.  This makes it possible to add/remove commands even if it's
-    // waiting for a response.
+    add_item("JOINT_POSITION", GetItemKind::JointPosition, get_joint_position_);
+    add_item("TOOL_FRAME", GetItemKind::ToolFrame, get_tool_frame_);
+  }
 
-    bool should_send = false;
+  if (get_status_ && (!separate || get_rates_.count("STATUS")))
+    add_item("STATUS", GetItemKind::Status, get_status_);
 
-    // Check for a message
-    command_list_mutex_.lock();
-    if (command_list_.size() > 0)
-    {
-      should_send = true;
+  for (const auto &rate : get_rates_)
+  {
+    const std::string &name = rate.first;
+    if (name == "JOINT_POSITION" || name == "TOOL_FRAME" || name == "STATUS")
+      continue;
 
-      cmd = command_list_.front();
+    RobotCommandPtr cmd = findGetCommand("GET", name);
+    if (cmd)
+      add_item(name, GetItemKind::Aux, cmd);
+    else
+      logger_.ERROR() << "get_rates: the plugin can't make GET " << name << ".  It won't be polled.";
+  }
 
-      std::ostringstream oss;
-      oss << *cmd;
+  if (heartbeat_period_ > 0)
+  {
+    add_item("HEARTBEAT", GetItemKind::Heartbeat, get_version_);
+    heartbeat_item_ = get_items_.back().get();
+  }
+}
 
-      auto cmd_str = oss.str();
-      logger_.INFO() << " Connector::cmdThread Cmd (" << cmd_str.length() << "): " << cmd_str;
-    }
-    command_list_mutex_.unlock();
+std::vector<Connector::GetItemStats> Connector::getGetItemStats() const
+{
+  std::vector<GetItemStats> stats;
+  std::lock_guard<std::mutex> lock(get_items_mutex_);
+  for (const auto &item : get_items_)
+    stats.push_back({ item->name, item->rate, item->polls, item->overruns });
+  return stats;
+}
+
+std::string Connector::getAuxResponse(const std::string &name) const
+{
+  std::lock_guard<std::mutex> lock(get_items_mutex_);
+  for (const auto &item : get_items_)
+  {
+    if (item->name == name)
+      return item->last_response;
+  }
+  return "";
+}
+
+void Connector::getDiagnostics(std::vector<diagnostic_msgs::DiagnosticStatus> &status) const
+{
+  auto add_value = [](diagnostic_msgs::DiagnosticStatus &entry, const std::string &key, const std::string &value) {
+    diagnostic_msgs::KeyValue key_value;
+    key_value.key = key;
+    key_value.value = value;
+    entry.values.push_back(key_value);
+  };
+
+  diagnostic_msgs::DiagnosticStatus get_loop;
+  get_loop.level = diagnostic_msgs::DiagnosticStatus::OK;
+  get_loop.name = "rmi_driver" + ns_ + " get loop";
+  get_loop.hardware_id = host_;
+  get_loop.message = streaming_ ? "Status stream active" : "Polling";
+  if (connection_state_ != ConnectionState::Connected)
+  {
+    get_loop.level = diagnostic_msgs::DiagnosticStatus::ERROR;
+    get_loop.message = "Disconnected";
+  }
+
+  uint64_t overruns = 0;
+  for (const auto &item : getGetItemStats())
+  {
+    add_value(get_loop, item.name + " polls", std::to_string(item.polls));
+    add_value(get_loop, item.name + " overruns", std::to_string(item.overruns));
+    overruns += item.overruns;
+  }
+  if (overruns)
+    get_loop.message += ", " + std::to_string(overruns) + " overruns";
+
+  add_value(get_loop, "status stream gaps", std::to_string(stream_gaps_));
+  add_value(get_loop, "status stream stale", std::to_string(stream_stale_));
+  add_value(get_loop, "link losses", std::to_string(link_losses_));
+  status.push_back(get_loop);
+
+  diagnostic_msgs::DiagnosticStatus cmd_socket;
+  cmd_socket.level = diagnostic_msgs::DiagnosticStatus::OK;
+  cmd_socket.name = "rmi_driver" + ns_ + " cmd socket";
+  cmd_socket.hardware_id = host_;
+  uint64_t writes = cmd_writes_;
+  uint64_t written = cmd_commands_written_;
+  cmd_socket.message = std::to_string(written) + " commands in " + std::to_string(writes) + " writes";
+  add_value(cmd_socket, "writes", std::to_string(writes));
+  add_value(cmd_socket, "commands written", std::to_string(written));
+  status.push_back(cmd_socket);
+
+  // 1 entry per command with the percentiles in microseconds
+  latency_stats_.forEach([&](const std::string &name, const CommandLatency &latency) {
+    diagnostic_msgs::DiagnosticStatus entry;
+    entry.level = diagnostic_msgs::DiagnosticStatus::OK;
+    entry.name = "rmi_driver" + ns_ + " latency " + name;
+    entry.hardware_id = host_;
+    entry.message = std::to_string(latency.response.count()) + " responses";
+
+    auto add_histogram = [&](const std::string &part, const LatencyHistogram &histogram) {
+      std::ostringstream oss;
+      oss << std::fixed << std::setprecision(1) << histogram.percentile(0.5) / 1000.0 << " / "
+          << histogram.percentile(0.9) / 1000.0 << " / " << histogram.percentile(0.99) / 1000.0 << " / "
+          << histogram.max() / 1000.0;
+      add_value(entry, part + " p50/p90/p99/max (us)", oss.str());
+    };
+
+    add_histogram("queue wait", latency.queue_wait);
+    add_histogram("write", latency.write);
+    add_histogram("response", latency.response);
+    status.push_back(entry);
+  });
+}
+
+void Connector::asyncGet(const std::string &send_str, std::chrono::milliseconds timeout,
+                         std::function<void(std::string &)> on_response, CommandLatency *latency)
+{
+  if (&send_str != &get_send_str_)
+    get_send_str_.assign(send_str);
+
+  // Get must be quick.  Closing the socket will make the pending write/read fail.
+  unsigned int op_id = ++get_op_id_;
+  get_deadline_.expires_from_now(timeout);
+  get_deadline_.async_wait(strand_.wrap([this, op_id, timeout](const boost::system::error_code &ec) {
+    if (ec || op_id != get_op_id_)
+      return;
+
+    logger_.ERROR() << "Get socket didn't respond within " << timeout.count() << "ms.  Closing it.";
+    get_timed_out_ = true;
+
+    boost::system::error_code ignored;
+    socket_get_.close(ignored);
+  }));
+
+  GetExchange(this, std::move(on_response), latency)();
+}
+
+void Connector::handleGetError(const boost::system::error_code &ec)
+{
+  ++get_op_id_;
+  get_deadline_.cancel();
+  get_loop_state_ = GetLoopState::Stopped;
+
+  if (get_current_request_)
+  {
+    get_current_request_->promise.set_exception(std::make_exception_ptr(boost::system::system_error(ec)));
+    get_current_request_.reset();
+  }
+
+  if (stopping_ || !ros::ok())
+  {
+    logger_.INFO() << " Connector Get loop stopped: " << ec.message();
+    setConnectionState(ConnectionState::Disconnected, "Stopped");
+    return;
+  }
+
+  std::string reason = "Get socket error: " + ec.message() + (get_timed_out_ ? " (timed out)" : "");
+  logger_.ERROR() << reason;
+
+  bool was_connected = connection_state_ == ConnectionState::Connected;
+  if (heartbeat_period_ > 0 && was_connected)
+    linkLost(reason);
+  setConnectionState(ConnectionState::Disconnected, reason);
+
+  // A robot that accepts the connection but doesn't answer would be reconnected to every heartbeat timeout.  Wait like
+  // a failed connect does.
+  if (heartbeat_period_ > 0 && !was_connected)
+  {
+    auto retry_timer = std::make_shared<boost::asio::steady_timer>(io_service_, std::chrono::seconds(1));
+    retry_timer->async_wait(strand_.wrap([this, retry_timer](const boost::system::error_code &) {
+      if (!stopping_)
+        connectSocket(host_, port_ + 1, RobotCommand::CommandType::Get);
+    }));
+    return;
+  }
+
+  // Relaunch the get socket/loop
+  connectSocket(host_, port_ + 1, RobotCommand::CommandType::Get);
+}
+
+void Connector::setConnectionState(ConnectionState state, const std::string &reason)
+{
+  if (connection_state_.exchange(state) == state)
+    return;
+
+  logger_.INFO() << "Connection " << (state == ConnectionState::Connected ? "up" : "down") << ": " << reason;
+  for (auto &callback : connection_state_callbacks_)
+    callback(state, reason);
+}
+
+void Connector::linkLost(const std::string &reason)
+{
+  ++link_losses_;
+  cmd_link_lost_ = true;
+
+  publishRmiResult(0, CommandResultCodes::CONNECTION_LOST, "Connection lost.  " + reason);
+
+  if (clear_commands_on_error_)
+    clearCommands();
+
+  boost::system::error_code ignored;
+  socket_cmd_.shutdown(boost::asio::socket_base::shutdown_type::shutdown_both, ignored);
+}
+
+bool Connector::processStatus(std::string &response, bool binary, wire::FloatGroups &groups)
+{
+  if (binary)
+  {
+    // Layout is checked by RobotCommandStatus::checkResponse
+    if (!get_status_->checkResponse(groups) || groups.size() != 3)
+    {
+      logger_.ERROR() << "Get status failed to process a binary response";
+      return false;
+    }
+
+    updateJointState(groups[0], groups[1]);
+    updateToolFrame(groups[2], "binary status");
+    storeStateSample();
+    return true;
+  }
+
+  if (!get_status_->checkResponse(response))
+  {
+    logger_.ERROR() << "Get status failed to process: " << response;
+    return false;
+  }
+
+  auto get_status_ptr = static_cast<RobotCommandStatus *>(get_status_.get());
+  if (!get_status_ptr->updateData(response))
+  {
+    logger_.ERROR() << " Connector Get loop: Unable to parse Get response: " << response;
+    return false;
+  }
+
+  updateJointState(get_status_ptr->getJointPositions(), get_status_ptr->getJointVelocities());
+  updateToolFrame(get_status_ptr->getTcpFrame(), response);
+  storeStateSample();
+  return true;
+}
+
+void Connector::startStatusStream()
+{
+  if (status_stream_rate_ <= 0 || !get_status_ || stream_state_ != StreamState::Off || stopping_)
+    return;
+
+  RobotCommandPtr subscribe = cmd_register_->makeStatusStreamCommand(status_stream_rate_);
+  if (!subscribe)
+  {
+    logger_.ERROR() << "The plugin doesn't support status streaming.  Polling the status instead.";
+    stream_state_ = StreamState::Unsupported;
+    return;
+  }
+
+  // Same robot and port as the Get socket
+  boost::system::error_code ec;
+  auto endpoint = socket_get_.remote_endpoint(ec);
+  if (ec)
+    return;
+
+  stream_state_ = StreamState::Connecting;
+  unsigned int stream_id = ++stream_id_;
+  socket_stream_.close(ec);
+  socket_stream_.async_connect(endpoint,
+                               strand_.wrap([this, stream_id, subscribe](const boost::system::error_code &ec) {
+    if (stream_id != stream_id_)
+      return;
+
+    if (ec)
+    {
+      stopStatusStream("Status stream failed to connect: " + ec.message(), true);
+      return;
+    }
+
+    std::string option_errors = applySocketOptions(socket_stream_, socket_options_);
+    if (!option_errors.empty())
+      logger_.WARN() << "Status stream socket options failed: " << option_errors;
+
+    subscribeStatusStream(stream_id, subscribe);
+  }));
+}
+
+void Connector::subscribeStatusStream(unsigned int stream_id, RobotCommandPtr subscribe)
+{
+  stream_buff_.consume(stream_buff_.size());
+  stream_wire_format_ = wire::Format::Text;
+  stream_have_seq_ = false;
+
+  auto send_subscribe = [this, stream_id, subscribe]() {
+    asyncStreamRequest(stream_id, *subscribe, [this, stream_id, subscribe](std::string &response) {
+      if (!subscribe->checkResponse(response))
+      {
+        stopStatusStream("The robot doesn't support status streaming (" + response + ").", false);
+        stream_state_ = StreamState::Unsupported;
+        return;
+      }
+
+      logger_.INFO() << "The robot is pushing the status at " << status_stream_rate_ << "hz.  Polling stopped.";
+      stream_state_ = StreamState::Active;
+      streaming_ = true;
+      armStreamStaleTimer(stream_id);
+      readStatusStream(stream_id);
+    });
+  };
+
+  // The pushes are the largest messages, so they should use the cheaper format if the robot has it
+  RobotCommandPtr switch_cmd;
+  if (get_wire_format_ != wire::Format::Text)
+    switch_cmd = cmd_register_->makeWireFormatCommand(get_wire_format_);
+
+  if (!switch_cmd)
+  {
+    send_subscribe();
+    return;
+  }
+
+  asyncStreamRequest(stream_id, *switch_cmd, [this, switch_cmd, send_subscribe](std::string &response) {
+    if (switch_cmd->checkResponse(response))
+      stream_wire_format_ = get_wire_format_;
+    else
+      logger_.ERROR() << " The robot refused to switch the status stream's wire format: " << response;
+
+    send_subscribe();
+  });
+}
+
+void Connector::asyncStreamRequest(unsigned int stream_id, const RobotCommand &cmd,
+                                   std::function<void(std::string &)> on_response)
+{
+  cmd.toWire(stream_send_str_, stream_wire_format_);
+
+  stream_timer_.expires_from_now(get_timeout_);
+  stream_timer_.async_wait(strand_.wrap([this, stream_id](const boost::system::error_code &ec) {
+    if (!ec && stream_id == stream_id_)
+      stopStatusStream("Status stream didn't respond within " + std::to_string(get_timeout_.count()) + "ms.", true);
+  }));
+
+  boost::asio::async_write(
+      socket_stream_, boost::asio::buffer(stream_send_str_),
+      strand_.wrap([this, stream_id, on_response](const boost::system::error_code &ec, std::size_t) {
+        if (stream_id != stream_id_)
+          return;
+
+        if (ec)
+        {
+          stopStatusStream("Status stream write failed: " + ec.message(), true);
+          return;
+        }
+
+        rearmQuickAck(socket_stream_, socket_options_);
+
+        auto on_read = [this, stream_id, on_response](const boost::system::error_code &ec, std::size_t size) {
+          if (stream_id != stream_id_)
+            return;
+
+          if (ec)
+          {
+            stopStatusStream("Status stream read failed: " + ec.message(), true);
+            return;
+          }
+
+          stream_timer_.cancel();
+          if (stream_wire_format_ == wire::Format::Text)
+          {
+            SocketChannel::takeLine(stream_buff_, size, stream_response_);
+          }
+          else if (!wire::takeFrame(stream_buff_, size, stream_response_))
+          {
+            stopStatusStream("Status stream received a broken frame.", true);
+            return;
+          }
+          else
+          {
+            wire::payloadToText(stream_response_);
+          }
+
+          on_response(stream_response_);
+        };
+
+        if (stream_wire_format_ == wire::Format::Binary)
+          boost::asio::async_read_until(socket_stream_, stream_buff_, wire::FrameMatcher(), strand_.wrap(on_read));
+        else
+          boost::asio::async_read_until(socket_stream_, stream_buff_, '\n', strand_.wrap(on_read));
+      }));
+}
+
+void Connector::readStatusStream(unsigned int stream_id)
+{
+  auto on_read = [this, stream_id](const boost::system::error_code &ec, std::size_t size) {
+    if (stream_id != stream_id_)
+      return;
+
+    if (ec)
+    {
+      stopStatusStream("Status stream read failed: " + ec.message(), true);
+      return;
+    }
+
+    // Nothing is written on this socket after subscribing, so ack each push right away
+    rearmQuickAck(socket_stream_, socket_options_);
+
+    // Text pushes are "<seq>;<status>".  Binary pushes are Floats with the seq as the first group.
+    bool binary = false;
+    uint32_t seq = 0;
+    if (stream_wire_format_ == wire::Format::Text)
+    {
+      SocketChannel::takeLine(stream_buff_, size, stream_response_);
+    }
+    else if (!wire::takeFrame(stream_buff_, size, stream_response_))
+    {
+      stopStatusStream("Status stream received a broken frame.", true);
+      return;
+    }
+    else if (wire::payloadKind(stream_response_) == wire::PayloadKind::Floats &&
+             wire::decodeFloats(stream_response_, stream_groups_))
+    {
+      binary = true;
+    }
+    else
+    {
+      wire::payloadToText(stream_response_);
+    }
+
+    bool valid;
+    if (binary)
+    {
+      valid = !stream_groups_.empty() && stream_groups_[0].size() == 1 && stream_groups_[0][0] >= 0;
+      if (valid)
+      {
+        seq = static_cast<uint32_t>(stream_groups_[0][0]);
+        stream_groups_.erase(stream_groups_.begin());
+      }
+    }
+    else
+    {
+      char *end = nullptr;
+      seq = static_cast<uint32_t>(std::strtoul(stream_response_.c_str(), &end, 10));
+      valid = end != stream_response_.c_str() && *end == ';';
+      if (valid)
+        stream_response_.erase(0, end - stream_response_.c_str() + 1);
+    }
+
+    if (!valid)
+      logger_.ERROR() << "Status stream push has no sequence number: " << stream_response_;
+    else if (checkStreamSeq(seq) && processStatus(stream_response_, binary, stream_groups_))
+      armStreamStaleTimer(stream_id);
+
+    readStatusStream(stream_id);
+  };
+
+  if (stream_wire_format_ == wire::Format::Binary)
+    boost::asio::async_read_until(socket_stream_, stream_buff_, wire::FrameMatcher(), strand_.wrap(on_read));
+  else
+    boost::asio::async_read_until(socket_stream_, stream_buff_, '\n', strand_.wrap(on_read));
+}
+
+bool Connector::checkStreamSeq(uint32_t seq)
+{
+  seq %= kStreamSeqModulo;
+  if (stream_have_seq_)
+  {
+    uint32_t delta = (seq - stream_last_seq_) % kStreamSeqModulo;
+
+    // Anything more than half way around is older than the last one
+    if (delta == 0 || delta >= kStreamSeqModulo / 2)
+    {
+      ++stream_stale_;
+      ROS_ERROR_STREAM_THROTTLE(1, ns_ << " Status stream: dropped a stale push " << seq << " after "
+                                       << stream_last_seq_);
+      return false;
+    }
+
+    if (delta > 1)
+    {
+      stream_gaps_ += delta - 1;
+      ROS_ERROR_STREAM_THROTTLE(1, ns_ << " Status stream: " << delta - 1 << " pushes missing before " << seq);
+    }
+  }
+
+  stream_have_seq_ = true;
+  stream_last_seq_ = seq;
+  return true;
+}
+
+void Connector::armStreamStaleTimer(unsigned int stream_id)
+{
+  stream_timer_.expires_from_now(stream_stale_timeout_);
+  stream_timer_.async_wait(strand_.wrap([this, stream_id](const boost::system::error_code &ec) {
+    if (!ec && stream_id == stream_id_)
+      stopStatusStream("Status stream went stale.", true);
+  }));
+}
+
+void Connector::stopStatusStream(const std::string &reason, bool retry)
+{
+  ++stream_id_;
+  stream_timer_.cancel();
+  boost::system::error_code ignored;
+  socket_stream_.close(ignored);
+
+  stream_state_ = StreamState::Off;
+  streaming_ = false;
+
+  if (stopping_ || !ros::ok())
+    return;
+
+  logger_.ERROR() << reason << "  Polling the status instead.";
+
+  // Resume polling right away.  The time it was streaming doesn't count as overruns.
+  auto now = std::chrono::steady_clock::now();
+  for (auto &item : get_items_)
+  {
+    if (item->kind != GetItemKind::Aux)
+      item->deadline = now;
+  }
+  if (get_loop_state_ == GetLoopState::Waiting)
+    get_timer_.cancel();
+
+  if (!retry)
+    return;
+
+  unsigned int stream_id = stream_id_;
+  auto retry_timer = std::make_shared<boost::asio::steady_timer>(io_service_, std::chrono::seconds(5));
+  retry_timer->async_wait(strand_.wrap([this, retry_timer, stream_id](const boost::system::error_code &ec) {
+    if (!ec && stream_id == stream_id_ && !stopping_)
+      startStatusStream();
+  }));
+}
+
+bool Connector::processGetJointPosition(std::string &response)
+{
+  if (get_response_binary_)
+  {
+    if (!get_joint_position_->checkResponse(get_groups_))
+    {
+      logger_.ERROR() << "Failed to check a binary joint position.  This is bad";
+      return false;
+    }
+
+    updateJointState(get_groups_[0], std::vector<double>());
+    return true;
+  }
+
+  if (!get_joint_position_->checkResponse(response))
+  {
+    logger_.ERROR() << "Failed to check joint position.  This is bad: " << response;
+    return false;
+  }
+
+  //###TODO Check vel here too
+  ParsedValues pos;
+  if (!util::parseDoubles(response, pos))
+  {
+    logger_.ERROR() << " Connector Get loop: Unable to parse Get response: " << response;
+    return false;
+  }
+
+  updateJointState(pos, ParsedValues());
+  return true;
+}
+
+void Connector::processGetToolFrame(std::string &response)
+{
+  if (get_response_binary_)
+  {
+    if (!get_tool_frame_->checkResponse(get_groups_))
+      logger_.ERROR() << "Failed to check a binary tool frame.  This is bad";
+    else
+      updateToolFrame(get_groups_[0], "binary tool frame");
+    return;
+  }
+
+  // Parse the numbers once and let the plugin convert them like a binary response, instead of converting the text and
+  // parsing it again.  get_groups_ keeps its capacity.  Only if the plugin's numeric conversion matches its text one.
+  get_groups_.resize(1);
+  if (!get_tool_frame_->hasNumericConversion())
+  {
+    if (!get_tool_frame_->checkResponse(response))
+      logger_.ERROR() << "Failed to check tool frame.  This is bad: " << response;
+    else if (!util::parseDoubles(response, get_groups_[0]))
+      logger_.ERROR() << " Connector Get loop: Unable to parse Get response: " << response;
+    else
+      updateToolFrame(get_groups_[0], response);
+    return;
+  }
+
+  if (util::parseDoubles(response, get_groups_[0]))
+  {
+    if (!get_tool_frame_->checkResponse(get_groups_))
+      logger_.ERROR() << "Failed to check tool frame.  This is bad: " << response;
+    else
+      updateToolFrame(get_groups_[0], response);
+    return;
+  }
+
+  // Not a frame, probably an error.  The plugin gets to see the text.
+  if (!get_tool_frame_->checkResponse(response))
+    logger_.ERROR() << "Failed to check tool frame.  This is bad: " << response;
+  else
+    logger_.ERROR() << " Connector Get loop: Unable to parse Get response: " << response;
+}
+
+template <typename Vec>
+void Connector::updateJointState(const Vec &pos, const Vec &vel)
+{
+  ros::Time stamp = ros::Time::now();
+  get_sample_.stamp_sec = stamp.sec;
+  get_sample_.stamp_nsec = stamp.nsec;
+  get_sample_.setPositions(pos);
+  get_sample_.setVelocities(vel);
+
+  if (joint_names_.size() != pos.size())
+  {
+    ROS_ERROR_STREAM_THROTTLE(1, ns_ << " ERROR: Connector Get loop number of positions received(" << pos.size()
+                                     << ") doesn't match number of configured joints(" << joint_names_.size() << ")!");
+  }
+}
+
+template <typename Vec>
+void Connector::updateToolFrame(const Vec &frame, const std::string &raw)
+{
+  if (frame.size() != 6)
+  {
+    logger_.ERROR() << " ERROR: Connector Get loop GET TOOL_FRAME size wrong!  Expected 6, got " << frame.size()
+                    << ".  Raw msg: " << raw;
+    return;
+  }
+
+  std::copy(frame.begin(), frame.end(), get_sample_.tool_frame);
+
+  // No need to calculate the Pose every time, but I should save the time
+  ros::Time stamp = ros::Time::now();
+  get_sample_.tool_frame_stamp_sec = stamp.sec;
+  get_sample_.tool_frame_stamp_nsec = stamp.nsec;
+}
+
+void Connector::cmdThread()
+{
+  if (cmd_pipeline_depth_ > 1)
+  {
+    cmdThreadPipelined();
+    return;
+  }
+
+  util::setThreadName("cmd_thr");
+  ros::Rate rate(30);
+  logger_.INFO() << " Connector::cmdThread() starting";
+
+  RobotCommandPtr cmd;
+  std::string response;
+
+  // A new socket always starts as text
+  resetCmdWireFormat();
+
+  // Start the flusher.  There could be some message in the buffer if this thread was just restarted.
+  flush_socket_cmd_ = true;
+  cmdSocketFlusher();
+
+  // Check for messages to send, send them 1 at a time and wait for a response for each one.  Send a
+  // robot_movement_interface::Result for each one.
+  while (!ros::isShuttingDown() && !stopping_)
+  {
+    // The queue doesn't lock.  This makes it possible to add/remove commands even if it's waiting for a response.
+
+    bool should_send = false;
+
+    // Check for a message
+    if (command_queue_.front(cmd))
+    {
+      should_send = true;
+
+      logger_.INFO() << " Connector::cmdThread Cmd (" << cmd->getText().length() << "): " << *cmd;
+    }
 
     if (should_send)
     {
-      try
+      try
+      {
+        switchCmdWireFormat();
+        auto send_time = std::chrono::steady_clock::now();
+        latency_stats_.get(cmd->getCommand()).queue_wait.record(send_time - cmd->getQueuedTime());
+        sendCommand(*cmd, response);
+
+        bool response_ok = processCmdResponse(*cmd, response);
+
+        // Command was sent and responded to in some way.  Pop it.  If the list was cleared while waiting, don't pop a
+        // command that was added after that.
+        command_queue_.popIf(cmd);
+
+        cmd.reset();
+      }
+      catch (const boost::system::system_error &ex)
+      {
+        logger_.INFO() << " Connector::cmdThread exception: " << ex.what();
+
+        // If the error is cause by anything other than a cancel, reconnect
+        if (ex.code() != boost::asio::error::operation_aborted)
+        {
+          // Removing clearCommands() actually allows the robot to continue if the socket is lost due to a plc restart
+          // or whatever.
+          // An abort command will still clear it out.  Maybe a timer would be safer?
+          /// @todo clearing would be safer
+
+          if (clear_commands_on_error_)
+          {
+            // eof probably indicates that the server's socket was restarted.  Preserve the list and restart the cmd
+            // thread to reconnect.  It will pick it up when it comes back around.
+            if (!clearCommandsOnCmdError(ex.code()))
+            {
+              logger_.INFO() << "Socket has to reconnect.  Not clearing command list.";
+            }
+            else
+            {
+              logger_.INFO() << " Connector::cmdThread is clearing any remaining commands due to the socket error";
+              clearCommands();
+            }
+          }
+
+          std::thread(&Connector::connectSocket, this, host_, port_, RobotCommand::CommandType::Cmd).detach();
+
+          return;
+        }
+      }
+    }
+    else
+    {
+      rate.sleep();
+    }
+  }
+}
+
+void Connector::cmdThreadPipelined()
+{
+  util::setThreadName("cmd_thr");
+  ros::Rate rate(30);
+  logger_.INFO() << " Connector::cmdThreadPipelined() starting with a depth of " << cmd_pipeline_depth_;
+
+  // Commands that have been written but not answered, oldest first.  The robot answers in order.
+  std::deque<RobotCommandPtr> in_flight;
+  // When each command in in_flight finished writing
+  std::deque<std::chrono::steady_clock::time_point> in_flight_sent;
+
+  // Held while anything is in flight so cancelSocketCmd() knows there is something to cancel.
+  std::unique_lock<std::timed_mutex> socket_lock(socket_cmd_mutex_, std::defer_lock);
+
+  // 1 string per command in a batch for the binary format.  Reused.  Sized once so the buffers stay valid.
+  std::vector<std::string> send_strs(std::min(cmd_batch_size_, cmd_pipeline_depth_));
+  std::vector<boost::asio::const_buffer> buffers;
+  std::string response;
+
+  cmd_channel_.clear();
+  resetCmdWireFormat();
+
+  // Start the flusher.  There could be some message in the buffer if this thread was just restarted.
+  flush_socket_cmd_ = true;
+  cmdSocketFlusher();
+
+  while (!ros::isShuttingDown() && !stopping_)
+  {
+    try
+    {
+      // The format can only change when nothing is in flight
+      if (in_flight.empty() && wire_format_ != cmd_wire_format_)
       {
-        std::string response = sendCommand(*cmd);
+        if (socket_lock.owns_lock())
+          socket_lock.unlock();
+        switchCmdWireFormat();
+      }
 
-        robot_movement_interface::Result result;
-        result.command_id = cmd->getCommandId();
-        if (cmd->checkResponse(response))
-        {
-          logger_.INFO() << " Connector::cmdThread sendCommand OK. Response: " << response << "\n";
-          result.result_code = 0;
-        }
-        else
+      // Write commands until the window is full.  Up to cmd_batch_size_ of them go out in 1 write.
+      while (in_flight.size() < cmd_pipeline_depth_)
+      {
+        std::size_t batch = 0;
+        std::size_t batch_bytes = 0;
+        RobotCommandPtr cmd;
+        buffers.clear();
+        while (batch < cmd_batch_size_ && batch_bytes < cmd_batch_bytes_ && in_flight.size() < cmd_pipeline_depth_ &&
+               takeNextCommand(cmd))
         {
-          /// OK only indicates that the command was received and processed successfully and execution should continue,
-          /// not that the actual result was good/true/whatever.  A not-OK response is always a problem.
-          // ROS_INFO_STREAM(ns_ << " Connector::cmdThread sendCommand NOT OK. Response: " << response << std::endl);
-          logger_.ERROR() << " Connector::cmdThread sendCommand NOT OK. Response: " << response << "\n";
-
-          result.result_code = 1;
+          logger_.INFO() << " Connector::cmdThreadPipelined Cmd (" << in_flight.size() + 1 << "/"
+                         << cmd_pipeline_depth_ << "): " << *cmd;
 
-          ///@todo think about how this might affect the order of responses.
-          // Clear the list if set.
-          if (clear_commands_on_error_)
+          if (!socket_lock.owns_lock())
           {
-            logger_.ERROR() << " Connector::cmdThread is clearing any remaining commands after receiving an error";
-            clearCommands();
+            socket_lock.lock();
+
+            // Nothing was in flight, so the flusher could be running.  Stop it.
+            if (flush_socket_cmd_)
+            {
+              flush_socket_cmd_ = false;
+              socket_cmd_.cancel();
+            }
           }
+
+          // Add it before writing so it can be put back in the list if the socket fails
+          in_flight.push_back(cmd);
+          // The text is written straight from the command.  in_flight keeps it alive.
+          const std::string &data = cmd->wireData(send_strs[batch], cmd_wire_format_);
+          buffers.push_back(boost::asio::buffer(data));
+          batch_bytes += data.size();
+          ++batch;
         }
 
-        // Command was sent and responded to in some way.  Lock n' pop.
-        command_list_mutex_.lock();
-        if (command_list_.size() > 0)
-          command_list_.pop_front();
-        command_list_mutex_.unlock();
+        if (batch == 0)
+          break;
 
-        result.additional_information = response;
+        auto write_start = std::chrono::steady_clock::now();
+        for (std::size_t i = in_flight.size() - batch; i < in_flight.size(); ++i)
+          latency_stats_.get(in_flight[i]->getCommand()).queue_wait.record(write_start - in_flight[i]->getQueuedTime());
 
-        result.header.stamp = ros::Time::now();
-        command_result_pub_.publish(result);
+        cmd_channel_.write(buffers);
+        rearmQuickAck(socket_cmd_, socket_options_);
 
-        cmd.reset();
+        auto write_done = std::chrono::steady_clock::now();
+        for (std::size_t i = in_flight.size() - batch; i < in_flight.size(); ++i)
+        {
+          in_flight_sent.push_back(write_done);
+          latency_stats_.get(in_flight[i]->getCommand()).write.record(write_done - write_start);
+        }
+
+        ++cmd_writes_;
+        cmd_commands_written_ += batch;
       }
-      catch (const boost::system::system_error &ex)
+
+      if (in_flight.empty())
       {
-        logger_.INFO() << " Connector::cmdThread exception: " << ex.what();
+        if (socket_lock.owns_lock())
+          socket_lock.unlock();
 
-        // If the error is cause by anything other than a cancel, reconnect
-        if (ex.code() != boost::asio::error::operation_aborted)
+        rate.sleep();
+        continue;
+      }
+
+      // Make sure there is a read waiting for the oldest command's response
+      cmd_channel_.asyncReadLine();
+
+      // Don't wait long if there is room in the window.  New commands may have arrived.
+      auto wait_time = in_flight.size() < cmd_pipeline_depth_ ? std::chrono::milliseconds(10) :
+                                                                std::chrono::milliseconds(100);
+      if (!cmd_channel_.waitReadLine(response, wait_time))
+        continue;
+
+      // Responses that arrived together are processed together, so the window can be refilled in 1 batch
+      do
+      {
+        RobotCommandPtr cmd = in_flight.front();
+        in_flight.pop_front();
+
+        // Includes the time it waited for the responses of the commands ahead of it
+        latency_stats_.get(cmd->getCommand()).response.record(std::chrono::steady_clock::now() -
+                                                              in_flight_sent.front());
+        in_flight_sent.pop_front();
+
+        // Commands that are already in flight can't be taken back, so they will still be answered and published if
+        // the list is cleared here.
+        processCmdResponse(*cmd, response);
+      } while (!in_flight.empty() && cmd_channel_.takeBufferedLine(response));
+    }
+    catch (const boost::system::system_error &ex)
+    {
+      logger_.INFO() << " Connector::cmdThreadPipelined exception: " << ex.what() << ".  " << in_flight.size()
+                     << " commands were in flight";
+
+      // A read could still be pending if the write failed.  Let it finish so it can't be mistaken for a response to
+      // the next command.  A cancel or socket error will end it.
+      cmd_channel_.waitReadDone();
+      cmd_channel_.clear();
+
+      // If the error is cause by anything other than a cancel, reconnect
+      if (ex.code() != boost::asio::error::operation_aborted)
+      {
+        if (clearCommandsOnCmdError(ex.code()))
         {
-          // Removing clearCommands() actually allows the robot to continue if the socket is lost due to a plc restart
-          // or whatever.
-          // An abort command will still clear it out.  Maybe a timer would be safer?
-          /// @todo clearing would be safer
+          logger_.INFO() << " Connector::cmdThreadPipelined is clearing any remaining commands due to the socket error";
+          clearCommands();
+        }
+        else
+        {
+          // Preserve the list.  Unanswered commands are sent again first after reconnecting, unless the list gets cleared.
+          logger_.INFO() << "Socket has to reconnect.  Not clearing command list.";
 
-          if (clear_commands_on_error_)
-          {
-            // eof probably indicates that the server's socket was restarted.  Preserve the list and restart the cmd
-            // thread to reconnect.  It will pick it up when it comes back around.
-            if (ex.code() == boost::asio::error::eof)
-            {
-              logger_.INFO() << "Socket has to reconnect.  Not clearing command list.";
-            }
-            else
-            {
-              logger_.INFO() << " Connector::cmdThread is clearing any remaining commands due to the socket error";
-              clearCommands();
-            }
-          }
+          if (cmd_retry_epoch_ != command_queue_.clearEpoch())
+            cmd_retry_.clear();
+          cmd_retry_epoch_ = command_queue_.clearEpoch();
+          cmd_retry_.insert(cmd_retry_.begin(), in_flight.begin(), in_flight.end());
+        }
 
-          std::thread(&Connector::connectSocket, this, host_, port_, RobotCommand::CommandType::Cmd).detach();
+        std::thread(&Connector::connectSocket, this, host_, port_, RobotCommand::CommandType::Cmd).detach();
 
-          return;
+        return;
+      }
+
+      // Canceled.  Anything in flight was aborted and any late responses will be consumed by the flusher.
+      in_flight.clear();
+      in_flight_sent.clear();
+      if (socket_lock.owns_lock())
+        socket_lock.unlock();
+    }
+  }
+}
+
+void Connector::startAsyncCmd()
+{
+  logger_.INFO() << " Connector async Cmd starting with a depth of " << cmd_pipeline_depth_;
+
+  // A new socket always starts as text
+  ++cmd_async_epoch_;
+  cmd_async_buff_.consume(cmd_async_buff_.size());
+  cmd_wire_format_ = wire::Format::Text;
+  cmd_wire_format_failed_ = false;
+
+  CmdReader(this, cmd_async_epoch_)();
+  CmdWriter(this, cmd_async_epoch_)();
+}
+
+const std::string *Connector::nextCmdOp(std::string &scratch)
+{
+  // The format can only change when nothing is in flight, and nothing else can be written until it's answered
+  if (!cmd_async_in_flight_.empty() && cmd_async_in_flight_.back().switch_format)
+    return nullptr;
+
+  CmdOp op;
+  if (cmd_async_in_flight_.empty() && wire_format_ != cmd_wire_format_ && !cmd_wire_format_failed_)
+  {
+    op.cmd = cmd_register_->makeWireFormatCommand(wire_format_);
+    op.switch_format = true;
+    if (!op.cmd)
+      cmd_wire_format_failed_ = true;
+  }
+
+  if (!op.cmd)
+  {
+    if (cmd_async_in_flight_.size() >= cmd_pipeline_depth_)
+      return nullptr;
+
+    if (!cmd_async_requests_.empty())
+    {
+      op = std::move(cmd_async_requests_.front());
+      cmd_async_requests_.pop_front();
+    }
+    else if (!takeNextCommand(op.cmd))
+    {
+      return nullptr;
+    }
+    else
+    {
+      latency_stats_.get(op.cmd->getCommand()).queue_wait.record(std::chrono::steady_clock::now() -
+                                                                 op.cmd->getQueuedTime());
+      logger_.INFO() << " Connector async Cmd (" << cmd_async_in_flight_.size() + 1 << "/" << cmd_pipeline_depth_
+                     << "): " << *op.cmd;
+    }
+  }
+
+  // cmd_async_batch_ keeps the command alive until the write is done.  A sendCommand() caller's command is gone once it
+  // has its response, which can beat the write handler, so its data is copied.
+  const std::string *data = &scratch;
+  if (op.promise)
+  {
+    op.cmd->toWire(scratch, cmd_wire_format_);
+  }
+  else
+  {
+    data = &op.cmd->wireData(scratch, cmd_wire_format_);
+    cmd_async_batch_.push_back(op.cmd);
+  }
+  cmd_async_in_flight_.push_back(std::move(op));
+  return data;
+}
+
+std::size_t Connector::nextCmdBatch()
+{
+  std::size_t batch = 0;
+  std::size_t batch_bytes = 0;
+  cmd_async_buffers_.clear();
+  cmd_async_batch_.clear();
+
+  // cmd_async_send_strs_ has room for the biggest batch
+  while (batch < cmd_async_send_strs_.size() && batch_bytes < cmd_batch_bytes_)
+  {
+    const std::string *data = nextCmdOp(cmd_async_send_strs_[batch]);
+    if (!data)
+      break;
+
+    cmd_async_buffers_.push_back(boost::asio::buffer(*data));
+    batch_bytes += data->size();
+    ++batch;
+  }
+
+  return batch;
+}
+
+#include <boost/asio/yield.hpp>
+
+void Connector::CmdWriter::operator()(const boost::system::error_code &ec, std::size_t size)
+{
+  Connector &c = *connector;
+  if (epoch != c.cmd_async_epoch_ || c.stopping_)
+    return;
+
+  reenter(this)
+  {
+    for (;;)
+    {
+      // Canceled by wakeCmdWriter()
+      while ((batch = c.nextCmdBatch()) == 0)
+      {
+        c.cmd_wake_timer_.expires_at(std::chrono::steady_clock::time_point::max());
+        yield c.cmd_wake_timer_.async_wait(c.strand_.wrap(*this));
+      }
+
+      write_start = std::chrono::steady_clock::now();
+      yield boost::asio::async_write(c.socket_cmd_, c.cmd_async_buffers_, c.strand_.wrap(*this));
+      if (ec)
+      {
+        c.handleCmdError(ec);
+        yield break;
+      }
+
+      rearmQuickAck(c.socket_cmd_, c.socket_options_);
+      ++c.cmd_writes_;
+      c.cmd_commands_written_ += batch;
+
+      // Writes are 1 at a time, so the batch is at the end of the commands that haven't been answered already
+      auto now = std::chrono::steady_clock::now();
+      for (auto op = c.cmd_async_in_flight_.rbegin(); op != c.cmd_async_in_flight_.rend() && batch > 0; ++op, --batch)
+      {
+        if (op->sent == std::chrono::steady_clock::time_point())
+        {
+          op->sent = now;
+          c.latency_stats_.get(op->cmd->getCommand()).write.record(now - write_start);
         }
       }
     }
+  }
+}
+
+void Connector::CmdReader::operator()(const boost::system::error_code &ec, std::size_t size)
+{
+  Connector &c = *connector;
+  if (epoch != c.cmd_async_epoch_)
+    return;
+
+  reenter(this)
+  {
+    for (;;)
+    {
+      binary = c.cmd_wire_format_ == wire::Format::Binary;
+      if (binary)
+      {
+        yield boost::asio::async_read_until(c.socket_cmd_, c.cmd_async_buff_, wire::FrameMatcher(),
+                                            c.strand_.wrap(*this));
+      }
+      else
+      {
+        yield boost::asio::async_read_until(c.socket_cmd_, c.cmd_async_buff_, '\n', c.strand_.wrap(*this));
+      }
+
+      if (ec)
+      {
+        c.handleCmdError(ec);
+        yield break;
+      }
+
+      // Responses that arrived together are processed together, so the CmdWriter can refill the window in 1 batch
+      do
+      {
+        if (!binary)
+        {
+          SocketChannel::takeLine(c.cmd_async_buff_, size, c.cmd_async_response_);
+        }
+        else if (wire::takeFrame(c.cmd_async_buff_, size, c.cmd_async_response_))
+        {
+          wire::payloadToText(c.cmd_async_response_);
+        }
+        else
+        {
+          c.handleCmdError(boost::asio::error::message_size);
+          yield break;
+        }
+
+        c.asyncCmdResponse(c.cmd_async_response_);
+      } while (binary == (c.cmd_wire_format_ == wire::Format::Binary) &&
+               (size = SocketChannel::bufferedSize(c.cmd_async_buff_, c.cmd_wire_format_)) != 0);
+
+      // The window has room again
+      c.cmd_wake_timer_.cancel();
+    }
+  }
+}
+
+void Connector::GetExchange::operator()(const boost::system::error_code &ec, std::size_t size)
+{
+  Connector &c = *connector;
+
+  reenter(this)
+  {
+    c.get_write_start_ = std::chrono::steady_clock::now();
+    yield boost::asio::async_write(c.socket_get_, boost::asio::buffer(c.get_send_str_), c.strand_.wrap(*this));
+    if (ec)
+    {
+      c.handleGetError(ec);
+      yield break;
+    }
+
+    rearmQuickAck(c.socket_get_, c.socket_options_);
+    c.get_write_done_ = std::chrono::steady_clock::now();
+    if (latency)
+      latency->write.record(c.get_write_done_ - c.get_write_start_);
+
+    if (c.get_wire_format_ == wire::Format::Binary)
+    {
+      yield boost::asio::async_read_until(c.socket_get_, c.socket_get_buff_, wire::FrameMatcher(),
+                                          c.strand_.wrap(*this));
+    }
     else
     {
-      rate.sleep();
+      yield boost::asio::async_read_until(c.socket_get_, c.socket_get_buff_, '\n', c.strand_.wrap(*this));
+    }
+
+    if (ec)
+    {
+      c.handleGetError(ec);
+      yield break;
+    }
+
+    // Done in time
+    ++c.get_op_id_;
+    c.get_deadline_.cancel();
+    if (latency)
+      latency->response.record(std::chrono::steady_clock::now() - c.get_write_done_);
+
+    // Any answer shows the link is alive
+    if (c.heartbeat_item_)
+      c.heartbeat_item_->deadline = std::chrono::steady_clock::now() + c.heartbeat_item_->period;
+
+    c.get_response_binary_ = false;
+    if (c.get_wire_format_ == wire::Format::Text)
+    {
+      SocketChannel::takeLine(c.socket_get_buff_, size, c.get_response_);
+    }
+    else if (!wire::takeFrame(c.socket_get_buff_, size, c.get_response_))
+    {
+      // The stream can't be trusted anymore
+      c.handleGetError(boost::asio::error::message_size);
+      yield break;
+    }
+    else if (wire::payloadKind(c.get_response_) == wire::PayloadKind::Floats &&
+             wire::decodeFloats(c.get_response_, c.get_groups_))
+    {
+      c.get_response_binary_ = true;
+    }
+    else
+    {
+      wire::payloadToText(c.get_response_);
+    }
+
+    on_response(c.get_response_);
+  }
+}
+
+#include <boost/asio/unyield.hpp>
+
+void Connector::asyncCmdResponse(std::string &response)
+{
+  if (cmd_async_in_flight_.empty())
+  {
+    logger_.INFO() << "Connector async Cmd flushed a message: " << response;
+    return;
+  }
+
+  CmdOp op = std::move(cmd_async_in_flight_.front());
+  cmd_async_in_flight_.pop_front();
+
+  // Includes the time it waited for the responses of the commands ahead of it.  The response can beat the write
+  // handler.
+  auto now = std::chrono::steady_clock::now();
+  if (op.sent == std::chrono::steady_clock::time_point())
+    op.sent = now;
+  latency_stats_.get(op.cmd->getCommand()).response.record(now - op.sent);
+
+  if (op.switch_format)
+  {
+    if (op.cmd->checkResponse(response))
+    {
+      cmd_wire_format_ = wire_format_.load();
+      logger_.INFO() << " Cmd socket switched to the " << (cmd_wire_format_ == wire::Format::Binary ? "binary" : "text")
+                     << " wire format";
+    }
+    else
+    {
+      cmd_wire_format_failed_ = true;
+      logger_.ERROR() << " The robot refused to switch the Cmd socket's wire format: " << response;
+    }
+  }
+  else if (op.promise)
+  {
+    op.promise->set_value(response);
+  }
+  else
+  {
+    processCmdResponse(*op.cmd, response);
+  }
+}
+
+void Connector::handleCmdError(const boost::system::error_code &ec)
+{
+  // Ends the coroutines
+  ++cmd_async_epoch_;
+  cmd_wake_timer_.cancel();
+
+  logger_.INFO() << " Connector async Cmd error: " << ec.message() << ".  " << cmd_async_in_flight_.size()
+                 << " commands were in flight";
+
+  // sendCommand() callers get the error
+  auto error = std::make_exception_ptr(boost::system::system_error(ec));
+  std::deque<RobotCommandPtr> unanswered;
+  for (auto &op : cmd_async_in_flight_)
+  {
+    if (op.promise)
+      op.promise->set_exception(error);
+    else if (!op.switch_format)
+      unanswered.push_back(op.cmd);
+  }
+  cmd_async_in_flight_.clear();
+
+  // Canceled.  Anything in flight was aborted and any late responses will be discarded.
+  if (ec == boost::asio::error::operation_aborted && !stopping_ && ros::ok())
+  {
+    cmd_async_buff_.consume(cmd_async_buff_.size());
+    CmdReader(this, cmd_async_epoch_)();
+    CmdWriter(this, cmd_async_epoch_)();
+    return;
+  }
+
+  for (auto &op : cmd_async_requests_)
+    op.promise->set_exception(error);
+  cmd_async_requests_.clear();
+
+  if (stopping_ || !ros::ok())
+    return;
+
+  if (clearCommandsOnCmdError(ec))
+  {
+    logger_.INFO() << " Connector async Cmd is clearing any remaining commands due to the socket error";
+    clearCommands();
+  }
+  else
+  {
+    // Preserve the list.  Unanswered commands are sent again first after reconnecting, unless the list gets cleared.
+    logger_.INFO() << "Socket has to reconnect.  Not clearing command list.";
+
+    if (cmd_retry_epoch_ != command_queue_.clearEpoch())
+      cmd_retry_.clear();
+    cmd_retry_epoch_ = command_queue_.clearEpoch();
+    cmd_retry_.insert(cmd_retry_.begin(), unanswered.begin(), unanswered.end());
+  }
+
+  boost::system::error_code ignored;
+  socket_cmd_.close(ignored);
+  connectSocket(host_, port_, RobotCommand::CommandType::Cmd);
+}
+
+bool Connector::takeNextCommand(RobotCommandPtr &cmd)
+{
+  if (!cmd_retry_.empty())
+  {
+    if (cmd_retry_epoch_ == command_queue_.clearEpoch())
+    {
+      cmd = cmd_retry_.front();
+      cmd_retry_.pop_front();
+      return true;
+    }
+    cmd_retry_.clear();
+  }
+
+  return command_queue_.pop(cmd);
+}
+
+bool Connector::processCmdResponse(const RobotCommand &cmd, std::string &response)
+{
+  robot_movement_interface::Result result;
+  result.command_id = cmd.getCommandId();
+
+  bool response_ok = cmd.checkResponse(response);
+  if (response_ok)
+  {
+    logger_.INFO() << " Connector::cmdThread sendCommand OK. Response: " << response << "\n";
+    result.result_code = 0;
+  }
+  else
+  {
+    /// OK only indicates that the command was received and processed successfully and execution should continue,
+    /// not that the actual result was good/true/whatever.  A not-OK response is always a problem.
+    logger_.ERROR() << " Connector::cmdThread sendCommand NOT OK. Response: " << response << "\n";
+
+    result.result_code = 1;
+
+    ///@todo think about how this might affect the order of responses.
+    // Clear the list if set.
+    if (clear_commands_on_error_)
+    {
+      logger_.ERROR() << " Connector::cmdThread is clearing any remaining commands after receiving an error";
+      clearCommands();
     }
   }
+
+  result.additional_information = response;
+
+  result.header.stamp = ros::Time::now();
+  command_result_pub_.publish(result);
+
+  return response_ok;
 }
 
-void Connector::publishState()
+sensor_msgs::JointState Connector::jointStateFromSample(const RobotStateSample &sample) const
 {
+  sensor_msgs::JointState joint_state;
+  joint_state.header.stamp = ros::Time(sample.stamp_sec, sample.stamp_nsec);
+  joint_state.name = joint_names_;
+  joint_state.position.assign(sample.position, sample.position + sample.num_positions);
+  joint_state.velocity.assign(sample.velocity, sample.velocity + sample.num_velocities);
+  return joint_state;
+}
+
+void Connector::publishState(const RobotStateSample &sample)
+{
+  robot_movement_interface::EulerFrame tool_frame;
+  tool_frame.x = sample.tool_frame[0];
+  tool_frame.y = sample.tool_frame[1];
+  tool_frame.z = sample.tool_frame[2];
+  tool_frame.alpha = sample.tool_frame[3];
+  tool_frame.beta = sample.tool_frame[4];
+  tool_frame.gamma = sample.tool_frame[5];
+
   // Publish the required YPR pose as-is
-  tool_frame_pub_.publish(last_tool_frame_);
+  tool_frame_pub_.publish(tool_frame);
 
   // Publish the reported tcp as a PoseStamped.  This makes it easier to use in other tools like RmiCommander or
   // monitoring.
+  geometry_msgs::PoseStamped tool_frame_pose;
+  tool_frame_pose.header.stamp = ros::Time(sample.tool_frame_stamp_sec, sample.tool_frame_stamp_nsec);
 
   if (ns_ != "/")
-    last_tool_frame_pose_.header.frame_id = ns_ + "_tool_frame_pose";
+    tool_frame_pose.header.frame_id = ns_ + "_tool_frame_pose";
   else
-    last_tool_frame_pose_.header.frame_id = ns_ + "tool_frame_pose";
+    tool_frame_pose.header.frame_id = ns_ + "tool_frame_pose";
 
-  last_tool_frame_pose_.pose.position.x = last_tool_frame_.x;
-  last_tool_frame_pose_.pose.position.y = last_tool_frame_.y;
-  last_tool_frame_pose_.pose.position.z = last_tool_frame_.z;
+  tool_frame_pose.pose.position.x = tool_frame.x;
+  tool_frame_pose.pose.position.y = tool_frame.y;
+  tool_frame_pose.pose.position.z = tool_frame.z;
 
   // Change the reported pose's orientation into a quaternion.  Easiest way is ypr->matrix->quaternion
   tf2::Matrix3x3 matrix;
-  matrix.setEulerYPR(last_tool_frame_.alpha, last_tool_frame_.beta, last_tool_frame_.gamma);
+  matrix.setEulerYPR(tool_frame.alpha, tool_frame.beta, tool_frame.gamma);
 
   tf2::Quaternion quat;
   matrix.getRotation(quat);
 
-  last_tool_frame_pose_.pose.orientation.w = quat.w();
-  last_tool_frame_pose_.pose.orientation.x = quat.x();
-  last_tool_frame_pose_.pose.orientation.y = quat.y();
-  last_tool_frame_pose_.pose.orientation.z = quat.z();
+  tool_frame_pose.pose.orientation.w = quat.w();
+  tool_frame_pose.pose.orientation.x = quat.x();
+  tool_frame_pose.pose.orientation.y = quat.y();
+  tool_frame_pose.pose.orientation.z = quat.z();
 
-  tool_frame_pose_pub_.publish(last_tool_frame_pose_);
+  tool_frame_pose_pub_.publish(tool_frame_pose);
 
   // Publish it as a transform for other ROS stuff that can handle tf
   geometry_msgs::TransformStamped tf;
-  tf.header.stamp = last_tool_frame_pose_.header.stamp;
+  tf.header.stamp = tool_frame_pose.header.stamp;
   tf.header.frame_id = "world";  // Is there a better way to detect the current root fixed transform?
-  tf.child_frame_id = last_tool_frame_pose_.header.frame_id;
+  tf.child_frame_id = tool_frame_pose.header.frame_id;
 
-  tf.transform.translation.x = last_tool_frame_pose_.pose.position.x;
-  tf.transform.translation.y = last_tool_frame_pose_.pose.position.y;
-  tf.transform.translation.z = last_tool_frame_pose_.pose.position.z;
-  tf.transform.rotation = last_tool_frame_pose_.pose.orientation;
+  tf.transform.translation.x = tool_frame_pose.pose.position.x;
+  tf.transform.translation.y = tool_frame_pose.pose.position.y;
+  tf.transform.translation.z = tool_frame_pose.pose.position.z;
+  tf.transform.rotation = tool_frame_pose.pose.orientation;
   tool_frame_pose_br_.sendTransform(tf);
 }
 
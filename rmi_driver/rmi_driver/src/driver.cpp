@@ -51,6 +51,7 @@ void Driver::loadPlugin(const ConnectionConfig &con_cfg, CmdRegLoaderPtr &cmd_re
   // cmh_loader->createInstance() returns a boost::shared_ptr but I want a std one.
   cmd_register = cmd_reg_loader->createUniqueInstance(con_cfg.rmi_plugin_lookup_name_);
   cmd_register->initialize(con_cfg.joints_);
+  cmd_register->setRequestedWireFormat(con_cfg.wire_format_);
   logger_.INFO() << "Loaded the plugin successfully";
 
   // Display some info about the loaded plugin
@@ -69,8 +70,19 @@ void Driver::run()
 
 void Driver::start()
 {
-  io_service_thread_ = std::thread(&Driver::run, this);
-  util::setThreadName(io_service_thread_, "io_svc_thr");
+  // In shared_thread_pool mode every Connector runs on these threads instead of its own
+  unsigned int io_threads = 1;
+  if (config_.shared_thread_pool_)
+  {
+    io_threads = config_.io_threads_ > 0 ? config_.io_threads_ : std::max(1u, std::thread::hardware_concurrency());
+    logger_.INFO() << "Shared thread pool mode.  " << io_threads << " io_service threads run all the connections";
+  }
+
+  for (unsigned int i = 0; i < io_threads; ++i)
+  {
+    io_service_threads_.emplace_back(&Driver::run, this);
+    util::setThreadName(io_service_threads_.back(), i == 0 ? "io_svc_thr" : "io_svc_thr" + std::to_string(i));
+  }
   //  io_service_thread_ = std::thread([&]() {
   //    io_service_.run();
   //    std::cout << "io_service_thread_ ending";
@@ -92,7 +104,7 @@ void Driver::start()
 
       // Add the connection from the current config
       this->addConnection(con_cfg.ns_, con_cfg.ip_address_, con_cfg.port_, con_cfg.joints_, cmd_reg_loader,
-                          cmd_register);
+                          cmd_register, con_cfg);
     }
     catch (pluginlib::PluginlibException &ex)
     {
@@ -102,6 +114,8 @@ void Driver::start()
 
   // Create ros publishers and subscribers
   joint_state_publisher_ = nh_.advertise<sensor_msgs::JointState>("joint_states", 1);
+  if (config_.diagnostics_period_ > 0)
+    diagnostics_publisher_ = nh_.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
   // command_list_sub_ = nh_.subscribe("command_list", 1, &Driver::subCB_CommandList, this);
 
   // Publish joint states.  Will aggregate multiple robots.
@@ -124,8 +138,11 @@ void Driver::stop()
   work_.reset();
   io_service_.stop();
 
-  if (io_service_thread_.joinable())
-    io_service_thread_.join();
+  for (auto &thread : io_service_threads_)
+  {
+    if (thread.joinable())
+      thread.join();
+  }
 
   std::cout << "Joined io_service_thread_\n";
 
@@ -136,18 +153,23 @@ void Driver::stop()
 }
 
 void Driver::addConnection(std::string ns, std::string host, int port, std::vector<std::string> joint_names,
-                           CmdRegLoaderPtr cmd_reg_loader, CommandRegisterPtr cmd_register)
+                           CmdRegLoaderPtr cmd_reg_loader, CommandRegisterPtr cmd_register,
+                           const ConnectionConfig &con_cfg)
 {
   conn_num_++;
 
   // Make a new Connector and add it
+  ConnectionConfig connector_cfg = con_cfg;
+  connector_cfg.async_cmd_ = con_cfg.async_cmd_ || config_.shared_thread_pool_;
+
   auto shared = std::make_shared<Connector>(ns, io_service_, host, port, joint_names, cmd_reg_loader, cmd_register,
-                                            config_.clear_commands_on_error_);
+                                            config_.clear_commands_on_error_, connector_cfg);
   conn_map_.emplace(conn_num_, shared);
 
   if (config_.use_rmi_driver_jta_)
   {
-    auto jta = std::make_shared<JointTrajectoryAction>(ns, joint_names, cmd_register->getJtaCommandHandler());
+    auto jta = std::make_shared<JointTrajectoryAction>(ns, joint_names, cmd_register->getJtaCommandHandler(),
+                                                       con_cfg.jta_decimation_tolerance_);
     jta_map_.emplace(conn_num_, jta);
   }
   else
@@ -166,12 +188,15 @@ void Driver::publishJointState()
   logger_.INFO() << "Driver pub starting";
 
   sensor_msgs::JointState stateFull;
+  ros::Time next_diagnostics = ros::Time::now();
   while (!ros::isShuttingDown())
   {
     stateFull = sensor_msgs::JointState();
     for (auto &&conn : conn_map_)
     {
-      auto lastState = conn.second->getLastJointState();
+      // Use 1 sample for both so the joint state and tool frame match
+      auto sample = conn.second->getStateSample();
+      auto lastState = conn.second->jointStateFromSample(sample);
       stateFull.header = lastState.header;
 
       stateFull.position.insert(stateFull.position.end(), lastState.position.begin(), lastState.position.end());
@@ -180,10 +205,24 @@ void Driver::publishJointState()
       stateFull.effort.insert(stateFull.effort.begin(), lastState.name.size(), 0);
 
       // Publish the individual state topics for this connection (tool_frame)
-      conn.second->publishState();
+      conn.second->publishState(sample);
     }
     // stateFull.header.stamp = ros::Time::now();
     joint_state_publisher_.publish(stateFull);
+
+    if (config_.diagnostics_period_ > 0 && ros::Time::now() >= next_diagnostics)
+    {
+      next_diagnostics = ros::Time::now() + ros::Duration(config_.diagnostics_period_);
+
+      diagnostic_msgs::DiagnosticArray diagnostics;
+      diagnostics.header.stamp = ros::Time::now();
+      for (auto &&conn : conn_map_)
+        conn.second->getDiagnostics(diagnostics.status);
+      for (auto &&jta : jta_map_)
+        jta.second->getDiagnostics(diagnostics.status);
+      diagnostics_publisher_.publish(diagnostics);
+    }
+
     if (ros::ok())
       pub_rate.sleep();
   }
@@ -28,6 +28,7 @@
  */
 
 #include "rmi_driver/joint_trajectory_action.h"
+#include "rmi_driver/trajectory_decimation.h"
 #include "rmi_driver/util.h"
 
 #include <vector>
@@ -35,13 +36,15 @@
 namespace rmi_driver
 {
 JointTrajectoryAction::JointTrajectoryAction(std::string ns, const std::vector<std::string> &joint_names,
-                                             JtaCommandHandler *jta_handler)
+                                             JtaCommandHandler *jta_handler,
+                                             const std::vector<double> &decimation_tolerance)
   : action_server_(nh_, ns + "/joint_trajectory_action", boost::bind(&JointTrajectoryAction::goalCB, this, _1),
                    boost::bind(&JointTrajectoryAction::cancelCB, this, _1), false)
   , conf_joint_names_(joint_names)
   , ns_(ns)
   , nh_(ns)
   , jta_handler_(jta_handler)
+  , decimation_tolerance_(decimation_tolerance)
   , has_goal_(false)
   , logger_("JTA", ns)
 {
@@ -52,13 +55,17 @@ JointTrajectoryAction::JointTrajectoryAction(std::string ns, const std::vector<s
   action_server_.start();
 
   logger_.INFO() << "joint_trajectory_handler started on topic " << ns + "/joint_trajectory_action";
+
+  if (!decimation_tolerance_.empty() && decimation_tolerance_.size() != conf_joint_names_.size())
+  {
+    logger_.ERROR() << "Got " << decimation_tolerance_.size() << " decimation tolerances for "
+                    << conf_joint_names_.size() << " joints.  Goals won't be decimated";
+    decimation_tolerance_.clear();
+  }
 }
 
 void JointTrajectoryAction::newGoal(JointTractoryActionServer::GoalHandle &gh)
 {
-  // Will contain the full trajectory in the correct order.  It's much easier to rearrange everything now in 1 batch
-  trajectory_msgs::JointTrajectory traj_sorted;
-
   auto &traj = gh.getGoal()->trajectory;
 
   auto &joint_names = traj.joint_names;
@@ -91,25 +98,46 @@ void JointTrajectoryAction::newGoal(JointTractoryActionServer::GoalHandle &gh)
     return;
   }
 
-  traj_sorted.header = traj.header;
-  traj_sorted.joint_names = util::sortVectorByIndices<std::string>(mapping, traj.joint_names);
-
   last_cmd_id_ = 0;  // Reset the target cmd_id
 
-  try
+  // Only a decimated goal is copied, and only the points that are kept
+  const trajectory_msgs::JointTrajectory *jta_traj = &traj;
+  trajectory_msgs::JointTrajectory decimated;
+  if (!decimation_tolerance_.empty())
   {
-    for (auto &&point : traj.points)
-    {
-      trajectory_msgs::JointTrajectoryPoint jtp;
+    // The tolerances are in the driver's joint order, the points are in the goal's
+    std::vector<double> tolerances(mapping.size());
+    for (size_t i = 0; i < mapping.size(); ++i)
+      tolerances[mapping[i]] = decimation_tolerance_[i];
 
-      jtp.positions = util::sortVectorByIndices<double>(mapping, point.positions);
-      jtp.velocities = util::sortVectorByIndices<double>(mapping, point.velocities);
-      jtp.accelerations = util::sortVectorByIndices<double>(mapping, point.accelerations);
-      jtp.effort = util::sortVectorByIndices<double>(mapping, point.effort);
-      jtp.time_from_start = point.time_from_start;
+    std::vector<size_t> keep;
+    if (!decimateTrajectory(traj.points, tolerances, keep))
+    {
+      reject(control_msgs::FollowJointTrajectoryResult::INVALID_GOAL, "A point doesn't have 1 position per joint");
+      return;
+    }
 
-      traj_sorted.points.push_back(jtp);
+    size_t removed = traj.points.size() - keep.size();
+    if (removed > 0)
+    {
+      decimated.points.reserve(keep.size());
+      for (size_t idx : keep)
+        decimated.points.push_back(traj.points[idx]);
+      jta_traj = &decimated;
     }
+
+    ++decimated_goals_;
+    decimation_points_in_ += traj.points.size();
+    decimation_points_removed_ += removed;
+    last_goal_points_removed_ = removed;
+    logger_.INFO() << "Decimation removed " << removed << " of " << traj.points.size() << " points from the goal";
+  }
+
+  // The points are put in the driver's joint order as they're turned into commands.  No sorted copy is made.
+  robot_movement_interface::CommandList cmd_list;
+  try
+  {
+    cmd_list = jta_handler_->processJta(*jta_traj, mapping);
   }
   catch (const std::runtime_error &error)
   {
@@ -117,8 +145,6 @@ void JointTrajectoryAction::newGoal(JointTractoryActionServer::GoalHandle &gh)
     return;
   }
 
-  robot_movement_interface::CommandList cmd_list = jta_handler_->processJta(traj_sorted);
-
   if (cmd_list.commands.empty())
   {
     reject(control_msgs::FollowJointTrajectoryResult::INVALID_GOAL, "Unable to create a CommandList");
@@ -131,6 +157,32 @@ void JointTrajectoryAction::newGoal(JointTractoryActionServer::GoalHandle &gh)
   pub_rmi_.publish(cmd_list);
 }
 
+void JointTrajectoryAction::getDiagnostics(std::vector<diagnostic_msgs::DiagnosticStatus> &status) const
+{
+  if (decimation_tolerance_.empty())
+    return;
+
+  auto add_value = [](diagnostic_msgs::DiagnosticStatus &entry, const std::string &key, uint64_t value) {
+    diagnostic_msgs::KeyValue key_value;
+    key_value.key = key;
+    key_value.value = std::to_string(value);
+    entry.values.push_back(key_value);
+  };
+
+  uint64_t points_in = decimation_points_in_;
+  uint64_t removed = decimation_points_removed_;
+
+  diagnostic_msgs::DiagnosticStatus entry;
+  entry.level = diagnostic_msgs::DiagnosticStatus::OK;
+  entry.name = "rmi_driver" + ns_ + " jta decimation";
+  entry.message = std::to_string(removed) + " of " + std::to_string(points_in) + " points removed";
+  add_value(entry, "goals", decimated_goals_);
+  add_value(entry, "points", points_in);
+  add_value(entry, "points removed", removed);
+  add_value(entry, "points removed from the last goal", last_goal_points_removed_);
+  status.push_back(entry);
+}
+
 void JointTrajectoryAction::goalCB(JointTractoryActionServer::GoalHandle gh)
 {
   logger_.INFO() << "goalCB new goal received";
@@ -152,8 +204,19 @@ void JointTrajectoryAction::subCB_CommandResult(const robot_movement_interface::
 {
   if (has_goal_)
   {
+    // The robot can't be reached to ABORT, and the Connector already dropped the commands
+    if (msg->result_code == CommandResultCodes::CONNECTION_LOST)
+    {
+      control_msgs::FollowJointTrajectoryResult rslt;
+      rslt.error_code = -100;
+      rslt.error_string = msg->additional_information;
+
+      active_goal_.setAborted(rslt, rslt.error_string);
+      has_goal_ = false;
+      logger_.ERROR() << "JointTrajectoryAction::abort: " << rslt.error_string;
+    }
     // If any message is an error, just stop
-    if (msg->result_code != CommandResultCodes::OK && msg->result_code != CommandResultCodes::ABORT_OK)
+    else if (msg->result_code != CommandResultCodes::OK && msg->result_code != CommandResultCodes::ABORT_OK)
     {
       abortGoal(-100, "subCB_CommandResult received a msg with a not-ok result code");
     }
@@ -32,6 +32,37 @@
 
 namespace rmi_driver
 {
+/**
+ * \brief Load an optional member of a connection.  out is left unchanged if the key doesn't exist.
+ *
+ * @return False if the key exists but has the wrong type
+ */
+template <typename T>
+static bool parseOptional(XmlRpc::XmlRpcValue& value, const std::string& key, XmlRpc::XmlRpcValue::Type type, T& out)
+{
+  if (!value.hasMember(key))
+    return true;
+
+  if (value[key].getType() != type)
+  {
+    ROS_ERROR_STREAM("ConnectionConfig '" << key << "'field has an invalid type");
+    return false;
+  }
+  out = static_cast<T>(value[key]);
+  return true;
+}
+
+// A double written without a decimal point is loaded as an int
+static bool parseOptional(XmlRpc::XmlRpcValue& value, const std::string& key, double& out)
+{
+  if (value.hasMember(key) && value[key].getType() == XmlRpc::XmlRpcValue::TypeInt)
+  {
+    out = static_cast<int>(value[key]);
+    return true;
+  }
+  return parseOptional(value, key, XmlRpc::XmlRpcValue::TypeDouble, out);
+}
+
 bool DriverConfig::loadConfig(ros::NodeHandle& nh)
 {
   ROS_INFO_STREAM(__func__ << " loading");
@@ -43,6 +74,12 @@ bool DriverConfig::loadConfig(ros::NodeHandle& nh)
 
   loadParam(nh, "/rmi_driver/use_rmi_driver_jta", use_rmi_driver_jta_, true);
 
+  loadParam(nh, "/rmi_driver/diagnostics_period", diagnostics_period_, 1.0);
+
+  loadParam(nh, "/rmi_driver/shared_thread_pool", shared_thread_pool_, false);
+
+  loadParam(nh, "/rmi_driver/io_threads", io_threads_, 0);
+
   // Load the connections
   std::string config_name = "rmi_driver_map";
   return getListParam(config_name, connections_);
@@ -111,6 +148,195 @@ bool ConnectionConfig::parse(XmlRpc::XmlRpcValue& value)
     return false;
   }
 
+  // Optional tuning params
+  if (!parseOptional(value, "cmd_pipeline_depth", XmlRpc::XmlRpcValue::TypeInt, this->cmd_pipeline_depth_))
+    return false;
+  if (this->cmd_pipeline_depth_ < 1)
+  {
+    ROS_ERROR_STREAM("ConnectionConfig 'cmd_pipeline_depth' must be >= 1");
+    return false;
+  }
+
+  if (!parseOptional(value, "cmd_batch_size", XmlRpc::XmlRpcValue::TypeInt, this->cmd_batch_size_))
+    return false;
+  if (this->cmd_batch_size_ < 1)
+  {
+    ROS_ERROR_STREAM("ConnectionConfig 'cmd_batch_size' must be >= 1");
+    return false;
+  }
+
+  if (!parseOptional(value, "cmd_batch_bytes", XmlRpc::XmlRpcValue::TypeInt, this->cmd_batch_bytes_))
+    return false;
+  if (this->cmd_batch_bytes_ < 1)
+  {
+    ROS_ERROR_STREAM("ConnectionConfig 'cmd_batch_bytes' must be >= 1");
+    return false;
+  }
+
+  if (!parseOptional(value, "cmd_queue_size", XmlRpc::XmlRpcValue::TypeInt, this->cmd_queue_size_))
+    return false;
+  if (this->cmd_queue_size_ < 1)
+  {
+    ROS_ERROR_STREAM("ConnectionConfig 'cmd_queue_size' must be >= 1");
+    return false;
+  }
+
+  if (!parseOptional(value, "ingest_threads", XmlRpc::XmlRpcValue::TypeInt, this->ingest_threads_))
+    return false;
+  if (this->ingest_threads_ < 0)
+  {
+    ROS_ERROR_STREAM("ConnectionConfig 'ingest_threads' must be >= 0");
+    return false;
+  }
+
+  if (!parseOptional(value, "ingest_chunk_size", XmlRpc::XmlRpcValue::TypeInt, this->ingest_chunk_size_))
+    return false;
+  if (this->ingest_chunk_size_ < 1)
+  {
+    ROS_ERROR_STREAM("ConnectionConfig 'ingest_chunk_size' must be >= 1");
+    return false;
+  }
+
+  if (!parseOptional(value, "ingest_partial_lists", XmlRpc::XmlRpcValue::TypeBoolean, this->ingest_partial_lists_))
+    return false;
+
+  if (!parseOptional(value, "get_rate", this->get_rate_))
+    return false;
+  if (this->get_rate_ < 0)
+  {
+    ROS_ERROR_STREAM("ConnectionConfig 'get_rate' must be >= 0");
+    return false;
+  }
+
+  key = "get_rates";
+  if (value.hasMember(key))
+  {
+    XmlRpc::XmlRpcValue& rates = value[key];
+    if (rates.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+    {
+      ROS_ERROR_STREAM("ConnectionConfig 'get_rates' must be a map of GET pose type to rate");
+      return false;
+    }
+
+    for (auto it = rates.begin(); it != rates.end(); ++it)
+    {
+      double rate = 0;
+      if (!parseOptional(rates, it->first, rate))
+        return false;
+      if (rate < 0)
+      {
+        ROS_ERROR_STREAM("ConnectionConfig 'get_rates' " << it->first << " must be >= 0");
+        return false;
+      }
+      this->get_rates_[it->first] = rate;
+    }
+  }
+
+  if (!parseOptional(value, "async_cmd", XmlRpc::XmlRpcValue::TypeBoolean, this->async_cmd_))
+    return false;
+
+  key = "socket_options";
+  if (value.hasMember(key))
+  {
+    XmlRpc::XmlRpcValue& options = value[key];
+    if (options.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+    {
+      ROS_ERROR_STREAM("ConnectionConfig 'socket_options' must be a map");
+      return false;
+    }
+
+    SocketOptions& out = this->socket_options_;
+    const auto type_bool = XmlRpc::XmlRpcValue::TypeBoolean;
+    const auto type_int = XmlRpc::XmlRpcValue::TypeInt;
+    if (!parseOptional(options, "tcp_nodelay", type_bool, out.tcp_nodelay) ||
+        !parseOptional(options, "quick_ack", type_bool, out.quick_ack) ||
+        !parseOptional(options, "send_buffer", type_int, out.send_buffer) ||
+        !parseOptional(options, "receive_buffer", type_int, out.receive_buffer) ||
+        !parseOptional(options, "keep_alive", type_bool, out.keep_alive) ||
+        !parseOptional(options, "keep_alive_idle", type_int, out.keep_alive_idle) ||
+        !parseOptional(options, "keep_alive_interval", type_int, out.keep_alive_interval) ||
+        !parseOptional(options, "keep_alive_count", type_int, out.keep_alive_count))
+      return false;
+
+    if (out.send_buffer < 0 || out.receive_buffer < 0 || out.keep_alive_idle < 0 || out.keep_alive_interval < 0 ||
+        out.keep_alive_count < 0)
+    {
+      ROS_ERROR_STREAM("ConnectionConfig 'socket_options' sizes and times must be >= 0");
+      return false;
+    }
+  }
+
+  std::string wire_format = "text";
+  if (!parseOptional(value, "wire_format", XmlRpc::XmlRpcValue::TypeString, wire_format))
+    return false;
+  if (!wire::parseFormat(wire_format, this->wire_format_))
+  {
+    ROS_ERROR_STREAM("ConnectionConfig 'wire_format' must be text or binary");
+    return false;
+  }
+
+  if (!parseOptional(value, "status_stream_rate", this->status_stream_rate_))
+    return false;
+  if (this->status_stream_rate_ < 0)
+  {
+    ROS_ERROR_STREAM("ConnectionConfig 'status_stream_rate' must be >= 0");
+    return false;
+  }
+
+  if (!parseOptional(value, "heartbeat_period", this->heartbeat_period_) ||
+      !parseOptional(value, "heartbeat_timeout", this->heartbeat_timeout_))
+    return false;
+  if (this->heartbeat_period_ < 0 || this->heartbeat_timeout_ <= 0)
+  {
+    ROS_ERROR_STREAM("ConnectionConfig 'heartbeat_period' must be >= 0 and 'heartbeat_timeout' > 0");
+    return false;
+  }
+
+  // 1 tolerance for every joint, or 1 per joint
+  key = "jta_decimation_tolerance";
+  if (value.hasMember(key))
+  {
+    XmlRpc::XmlRpcValue& tolerance = value[key];
+    this->jta_decimation_tolerance_.clear();
+    if (tolerance.getType() == XmlRpc::XmlRpcValue::TypeArray)
+    {
+      for (int i = 0; i < tolerance.size(); ++i)
+      {
+        if (tolerance[i].getType() == XmlRpc::XmlRpcValue::TypeInt)
+          this->jta_decimation_tolerance_.push_back(static_cast<int>(tolerance[i]));
+        else if (tolerance[i].getType() == XmlRpc::XmlRpcValue::TypeDouble)
+          this->jta_decimation_tolerance_.push_back(static_cast<double>(tolerance[i]));
+        else
+        {
+          ROS_ERROR_STREAM("ConnectionConfig 'jta_decimation_tolerance' must be numbers");
+          return false;
+        }
+      }
+    }
+    else
+    {
+      double tol = 0;
+      if (!parseOptional(value, key, tol))
+        return false;
+      if (tol > 0)
+        this->jta_decimation_tolerance_.assign(this->joints_.size(), tol);
+    }
+
+    if (!this->jta_decimation_tolerance_.empty() && this->jta_decimation_tolerance_.size() != this->joints_.size())
+    {
+      ROS_ERROR_STREAM("ConnectionConfig 'jta_decimation_tolerance' must be 1 value or 1 per joint");
+      return false;
+    }
+    for (double tol : this->jta_decimation_tolerance_)
+    {
+      if (tol < 0)
+      {
+        ROS_ERROR_STREAM("ConnectionConfig 'jta_decimation_tolerance' must be >= 0");
+        return false;
+      }
+    }
+  }
+
   return true;
 }
 
@@ -29,6 +29,8 @@
 
 #include <rmi_driver/rotation_utils.h>
 
+#include <cmath>
+
 namespace rmi_driver
 {
 namespace util
@@ -83,6 +85,33 @@ tf2::Quaternion RotationUtils::quatFromZYZ(const tf2Scalar& Z, const tf2Scalar&
   return quat.normalize();
 }
 
+void RotationUtils::zyzToZyx(double Z, double Y, double ZZ, double& yaw, double& pitch, double& roll)
+{
+  double cz = std::cos(Z), sz = std::sin(Z);
+  double cy = std::cos(Y), sy = std::sin(Y);
+  double czz = std::cos(ZZ), szz = std::sin(ZZ);
+
+  // Rz(Z) * Ry(Y) * Rz(ZZ)
+  double r20 = -sy * czz;
+
+  // Gimbal lock.  Rare enough to let tf2 handle it exactly like it always has.
+  if (std::fabs(r20) >= 1)
+  {
+    rotZYZ(Z, Y, ZZ).getEulerYPR(yaw, pitch, roll);
+    return;
+  }
+
+  double r00 = cz * cy * czz - sz * szz;
+  double r10 = sz * cy * czz + cz * szz;
+  double r21 = sy * szz;
+  double r22 = cy;
+
+  // cos(pitch) > 0, so atan2 doesn't need the entries divided by it
+  pitch = -std::asin(r20);
+  roll = std::atan2(r21, r22);
+  yaw = std::atan2(r10, r00);
+}
+
 bool RotationUtils::approxEqual(const tf2::Quaternion& quat1, const tf2::Quaternion& quat2, double range)
 {
   // https://answers.unity.com/questions/288338/how-do-i-compare-quaternions.html
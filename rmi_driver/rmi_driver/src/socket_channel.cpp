@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+#include "rmi_driver/socket_channel.h"
+#include <algorithm>
+
+namespace rmi_driver
+{
+void SocketChannel::Completion::reset()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  done = false;
+  ec = boost::system::error_code();
+  size = 0;
+}
+
+void SocketChannel::Completion::set(const boost::system::error_code& e, std::size_t s)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+    ec = e;
+    size = s;
+  }
+  cond.notify_all();
+}
+
+bool SocketChannel::Completion::waitFor(std::chrono::milliseconds timeout)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  return cond.wait_for(lock, timeout, [this]() { return done; });
+}
+
+void SocketChannel::Completion::wait()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  cond.wait(lock, [this]() { return done; });
+}
+
+void SocketChannel::throwIfError(const Completion& completion)
+{
+  if (completion.ec)
+    throw boost::system::system_error(completion.ec);
+}
+
+template <typename ConstBufferSequence>
+void SocketChannel::writeBuffers(const ConstBufferSequence& buffers)
+{
+  write_done_.reset();
+
+  boost::asio::async_write(socket_, buffers,
+                           makeAllocHandler(write_memory_, [this](const boost::system::error_code& e, std::size_t size) {
+                             write_done_.set(e, size);
+                           }));
+
+  write_done_.wait();
+  throwIfError(write_done_);
+}
+
+void SocketChannel::write(const std::string& data)
+{
+  writeBuffers(boost::asio::buffer(data));
+}
+
+void SocketChannel::write(const std::vector<boost::asio::const_buffer>& buffers)
+{
+  writeBuffers(buffers);
+}
+
+void SocketChannel::asyncReadLine()
+{
+  if (read_pending_)
+    return;
+
+  read_pending_ = true;
+  read_done_.reset();
+
+  auto handler = makeAllocHandler(
+      read_memory_, [this](const boost::system::error_code& e, std::size_t size) { read_done_.set(e, size); });
+
+  if (format_ == wire::Format::Binary)
+    boost::asio::async_read_until(socket_, buff_, wire::FrameMatcher(), handler);
+  else
+    boost::asio::async_read_until(socket_, buff_, '\n', handler);
+}
+
+bool SocketChannel::waitReadLine(std::string& line, std::chrono::milliseconds timeout)
+{
+  if (!read_done_.waitFor(timeout))
+    return false;
+
+  read_pending_ = false;
+  throwIfError(read_done_);
+
+  takeMessage(line, read_done_.size);
+  return true;
+}
+
+void SocketChannel::waitReadLine(std::string& line)
+{
+  read_done_.wait();
+
+  read_pending_ = false;
+  throwIfError(read_done_);
+
+  takeMessage(line, read_done_.size);
+}
+
+void SocketChannel::waitReadDone()
+{
+  if (!read_pending_)
+    return;
+
+  read_done_.wait();
+  read_pending_ = false;
+}
+
+bool SocketChannel::takeBufferedLine(std::string& line)
+{
+  if (read_pending_)
+    return false;
+
+  std::size_t size = bufferedSize(buff_, format_);
+  if (size == 0)
+    return false;
+
+  takeMessage(line, size);
+  return true;
+}
+
+void SocketChannel::request(const std::string& data, std::string& response)
+{
+  write(data);
+  asyncReadLine();
+  waitReadLine(response);
+}
+
+void SocketChannel::takeMessage(std::string& line, std::size_t size)
+{
+  if (format_ == wire::Format::Text)
+  {
+    takeLine(buff_, size, line);
+    return;
+  }
+
+  // The stream can't be trusted after a broken frame.  Treat it like a socket error so it reconnects.
+  if (!wire::takeFrame(buff_, size, line))
+    throw boost::system::system_error(boost::asio::error::message_size);
+
+  wire::payloadToText(line);
+}
+
+void SocketChannel::takeLine(boost::asio::streambuf& buff, std::size_t size, std::string& line)
+{
+  auto begin = boost::asio::buffers_begin(buff.data());
+
+  // size includes the delimiter
+  line.assign(begin, begin + (size > 0 ? size - 1 : 0));
+  buff.consume(size);
+}
+
+std::size_t SocketChannel::bufferedSize(const boost::asio::streambuf& buff, wire::Format format)
+{
+  auto begin = boost::asio::buffers_begin(buff.data());
+  auto end = boost::asio::buffers_end(buff.data());
+
+  if (format == wire::Format::Binary)
+  {
+    auto match = wire::FrameMatcher()(begin, end);
+    return match.second ? match.first - begin : 0;
+  }
+
+  auto newline = std::find(begin, end, '\n');
+  return newline == end ? 0 : newline - begin + 1;
+}
+
+}  // namespace rmi_driver
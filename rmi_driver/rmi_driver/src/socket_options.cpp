@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+#include "rmi_driver/socket_options.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+namespace rmi_driver
+{
+namespace
+{
+#ifdef TCP_KEEPIDLE
+typedef boost::asio::detail::socket_option::integer<IPPROTO_TCP, TCP_KEEPIDLE> keep_alive_idle;
+typedef boost::asio::detail::socket_option::integer<IPPROTO_TCP, TCP_KEEPINTVL> keep_alive_interval;
+typedef boost::asio::detail::socket_option::integer<IPPROTO_TCP, TCP_KEEPCNT> keep_alive_count;
+#endif
+
+#ifdef TCP_QUICKACK
+typedef boost::asio::detail::socket_option::boolean<IPPROTO_TCP, TCP_QUICKACK> quick_ack;
+#endif
+
+template <typename Option>
+void setOption(boost::asio::ip::tcp::socket& socket, const Option& option, const char* name, std::string& errors)
+{
+  boost::system::error_code ec;
+  socket.set_option(option, ec);
+  if (ec)
+    errors += std::string(errors.empty() ? "" : ", ") + name + ": " + ec.message();
+}
+}  // namespace
+
+std::string applySocketOptions(boost::asio::ip::tcp::socket& socket, const SocketOptions& options)
+{
+  using boost::asio::socket_base;
+  std::string errors;
+
+  setOption(socket, boost::asio::ip::tcp::no_delay(options.tcp_nodelay), "tcp_nodelay", errors);
+
+  if (options.send_buffer > 0)
+    setOption(socket, socket_base::send_buffer_size(options.send_buffer), "send_buffer", errors);
+  if (options.receive_buffer > 0)
+    setOption(socket, socket_base::receive_buffer_size(options.receive_buffer), "receive_buffer", errors);
+
+  setOption(socket, socket_base::keep_alive(options.keep_alive), "keep_alive", errors);
+#ifdef TCP_KEEPIDLE
+  if (options.keep_alive)
+  {
+    if (options.keep_alive_idle > 0)
+      setOption(socket, keep_alive_idle(options.keep_alive_idle), "keep_alive_idle", errors);
+    if (options.keep_alive_interval > 0)
+      setOption(socket, keep_alive_interval(options.keep_alive_interval), "keep_alive_interval", errors);
+    if (options.keep_alive_count > 0)
+      setOption(socket, keep_alive_count(options.keep_alive_count), "keep_alive_count", errors);
+  }
+#endif
+
+  rearmQuickAck(socket, options);
+
+  return errors;
+}
+
+void rearmQuickAck(boost::asio::ip::tcp::socket& socket, const SocketOptions& options)
+{
+#ifdef TCP_QUICKACK
+  if (!options.quick_ack)
+    return;
+
+  // Best effort.  It's only a hint to the stack.
+  boost::system::error_code ignored;
+  socket.set_option(quick_ack(true), ignored);
+#endif
+}
+
+}  // namespace rmi_driver
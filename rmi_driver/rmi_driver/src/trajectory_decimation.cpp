@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+#include "rmi_driver/trajectory_decimation.h"
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace rmi_driver
+{
+bool decimateTrajectory(const std::vector<trajectory_msgs::JointTrajectoryPoint>& points,
+                        const std::vector<double>& tolerances, std::vector<std::size_t>& keep)
+{
+  const std::size_t num_points = points.size();
+  const std::size_t num_joints = tolerances.size();
+
+  keep.clear();
+  bool valid = true;
+  for (const auto& point : points)
+    valid = valid && point.positions.size() == num_joints;
+
+  if (!valid || num_points <= 2)
+  {
+    for (std::size_t i = 0; i < num_points; ++i)
+      keep.push_back(i);
+    return valid;
+  }
+
+  std::vector<char> kept(num_points, 0);
+  kept.front() = kept.back() = 1;
+
+  // Segments that still have to be checked.  A stack instead of recursion, so a 100k point goal can't overflow.
+  std::vector<std::pair<std::size_t, std::size_t>> segments;
+  segments.emplace_back(0, num_points - 1);
+
+  while (!segments.empty())
+  {
+    std::size_t first = segments.back().first;
+    std::size_t last = segments.back().second;
+    segments.pop_back();
+    if (last - first < 2)
+      continue;
+
+    const auto& p0 = points[first];
+    const auto& p1 = points[last];
+    double t0 = p0.time_from_start.toSec();
+    double duration = p1.time_from_start.toSec() - t0;
+
+    // The point that's furthest off the line, relative to the tolerance of the joint
+    double worst = 1.0;
+    std::size_t worst_idx = 0;
+    for (std::size_t k = first + 1; k < last; ++k)
+    {
+      double s = duration > 0 ? (points[k].time_from_start.toSec() - t0) / duration :
+                                static_cast<double>(k - first) / (last - first);
+
+      for (std::size_t j = 0; j < num_joints; ++j)
+      {
+        double expected = p0.positions[j] + s * (p1.positions[j] - p0.positions[j]);
+        double deviation = std::fabs(points[k].positions[j] - expected);
+        if (deviation <= tolerances[j])
+          continue;
+
+        double ratio = tolerances[j] > 0 ? deviation / tolerances[j] : std::numeric_limits<double>::infinity();
+        if (ratio > worst)
+        {
+          worst = ratio;
+          worst_idx = k;
+        }
+      }
+    }
+
+    if (worst_idx != 0)
+    {
+      kept[worst_idx] = 1;
+      segments.emplace_back(first, worst_idx);
+      segments.emplace_back(worst_idx, last);
+    }
+  }
+
+  for (std::size_t i = 0; i < num_points; ++i)
+  {
+    if (kept[i])
+      keep.push_back(i);
+  }
+  return true;
+}
+
+}  // namespace rmi_driver
@@ -32,7 +32,12 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/tokenizer.hpp>
 
-#include <boost/spirit/include/qi.hpp>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
 
 namespace rmi_driver
 {
@@ -48,88 +53,245 @@ double degToRad(double degrees)
   return degrees * (M_PI / 180.0);
 }
 
-std::string floatToStringNoTrailing(float fval, int precision)
+namespace
+{
+/// Remove trailing '0's, then trailing '.'s, like floatToStringNoTrailing() always has.  Returns the new end.
+const char* trimNoTrailing(const char* begin, const char* end)
+{
+  while (end != begin && end[-1] == '0')
+    --end;
+  while (end != begin && end[-1] == '.')
+    --end;
+  return end;
+}
+
+/// A float times 10^12 needs 24 + 28 bits for the 5^12 part, so it's exact in a double.  Higher precisions aren't.
+const int kMaxFastPrecision = 12;
+const double kPow10[kMaxFastPrecision + 1] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12 };
+
+/// Largest scaled value that still fits in a uint64_t after rounding
+const double kMaxFastScaled = 1.8e19;
+
+/// The iostream formatting, for what the fast path can't do exactly
+void appendFloatStream(std::string& out, float fval, int precision)
 {
-  // Convert the value to a string with fixed precision
   std::ostringstream oss;
   oss << std::setprecision(precision) << std::fixed;
   oss << fval;
   auto str = oss.str();
-  // Remove extra trailing 0s or .
-  boost::trim_right_if(str, boost::is_any_of("0"));
-  boost::trim_right_if(str, boost::is_any_of("."));
+  out.append(str.data(), trimNoTrailing(str.data(), str.data() + str.size()));
+}
+}  // namespace
 
+std::string floatToStringNoTrailing(float fval, int precision)
+{
+  std::string str;
+  appendFloatNoTrailing(str, fval, precision);
   return str;
 }
 
-using boost::spirit::qi::double_;
-using boost::spirit::qi::parse;
+void appendFloatNoTrailing(std::string& out, float fval, int precision)
+{
+  if (precision < 0 || precision > kMaxFastPrecision || !std::isfinite(fval))
+  {
+    appendFloatStream(out, fval, precision);
+    return;
+  }
 
-namespace qi = boost::spirit::qi;
+  // The scaled value is exact, so rounding it once in the current rounding mode gives the same digits as printf.
+  double scaled = std::fabs(static_cast<double>(fval) * kPow10[precision]);
+  if (scaled >= kMaxFastScaled)
+  {
+    appendFloatStream(out, fval, precision);
+    return;
+  }
 
-std::vector<double> stringToDoubleVec(const std::string& s)
+  uint64_t digits = static_cast<uint64_t>(std::nearbyint(scaled));
+
+  // Written backwards from the end.  Sign, 20 digits, '.' and 12 decimals fit.
+  char buff[40];
+  char* end = buff + sizeof(buff);
+  char* begin = end;
+
+  for (int i = 0; i < precision; ++i)
+  {
+    *--begin = static_cast<char>('0' + digits % 10);
+    digits /= 10;
+  }
+  if (precision > 0)
+    *--begin = '.';
+
+  do
+  {
+    *--begin = static_cast<char>('0' + digits % 10);
+    digits /= 10;
+  } while (digits != 0);
+
+  // printf keeps the sign of values that round to 0, and of -0
+  if (std::signbit(fval))
+    *--begin = '-';
+
+  out.append(begin, trimNoTrailing(begin, end) - begin);
+}
+
+namespace
 {
-  std::vector<double> doubleVec;
+/// Powers of 10 that a double holds exactly
+const double kExactPow10[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                               1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
 
-  // So, boost::split is the least efficient thing ever.  Use qi instead.
-
-  // std::vector<std::string> strVec;
-
-  //
-  //  // Split the string at spaces into a vector of strings
-  //  // boost::split(strVec, s, boost::is_any_of(" "), boost::token_compress_on);
-  //  boost::split(strVec, s, boost::is_space(), boost::token_compress_on);
-  //  t.stop();
-  //
-  //  auto time_total = t.getTime();
-  //  std::cout << "duration boost::split " << t.getTime() << " ";
-  //
-  //  t.reset();
-  //  t.start();
-  //  // Insert the double value of each entry
-  //
-  //  doubleVec.reserve(10);
-  //  std::transform(strVec.begin(), strVec.end(), std::back_inserter(doubleVec),
-  //                 [](const std::string& val) { return boost::lexical_cast<double>(val); });
-  //  t.stop();
-  //
-  //  time_total += t.getTime();
-  //  std::cout << "duration transform: " << t.getTime() << " total: " << time_total << " (" << s << ")" << std::endl;
-  //
-  //  // Clock::time_point t0 = Clock::now();
-  //
-  //  {
-  //    std::vector<double> doubleVec;
-  //    t.reset();
-  //    t.start();
-  //    auto s_trim = boost::trim_copy(s);
-  //    doubleVec.reserve(10);
-  //    std::stringstream ss(s_trim);
-  //
-  //    double d;
-  //    while (ss >> d)
-  //      doubleVec.push_back(d);
-  //
-  //    t.stop();
-  //    std::cout << "duration ss: " << t.getTime() << std::endl;
-  //  }
+/// Max significant digits that fit in the uint64 mantissa
+const int kMaxMantissaDigits = 19;
+
+inline bool isDigit(char c)
+{
+  return static_cast<unsigned char>(c - '0') < 10;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define RMI_DRIVER_SWAR_DIGITS 1
+
+/// True if all 8 chars of a little endian chunk are '0'..'9'
+inline bool allDigits8(std::uint64_t chunk)
+{
+  return ((chunk & 0xF0F0F0F0F0F0F0F0ull) | (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ==
+         0x3333333333333333ull;
+}
+
+/// Value of 8 digits in a little endian chunk.  3 multiplies instead of 8.
+inline std::uint32_t parseDigits8(std::uint64_t chunk)
+{
+  chunk = ((chunk & 0x0F0F0F0F0F0F0F0Full) * 2561) >> 8;
+  chunk = ((chunk & 0x00FF00FF00FF00FFull) * 6553601) >> 16;
+  return static_cast<std::uint32_t>(((chunk & 0x0000FFFF0000FFFFull) * 42949672960001ull) >> 32);
+}
+#endif
+
+/// Add a run of digits to mantissa, 8 at a time while they fit.  num_digits counts every digit, even ones that didn't.
+inline const char* scanDigits(const char* p, const char* end, std::uint64_t& mantissa, int& num_digits)
+{
+#ifdef RMI_DRIVER_SWAR_DIGITS
+  while (end - p >= 8 && num_digits + 8 <= kMaxMantissaDigits)
+  {
+    std::uint64_t chunk;
+    std::memcpy(&chunk, p, sizeof(chunk));
+    if (!allDigits8(chunk))
+      break;
+
+    mantissa = mantissa * 100000000 + parseDigits8(chunk);
+    num_digits += 8;
+    p += 8;
+  }
+#endif
 
-  std::string::const_iterator start = s.begin();
-  std::string::const_iterator end = s.end();
+  for (; p != end && isDigit(*p); ++p)
+  {
+    if (num_digits < kMaxMantissaDigits)
+      mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+    ++num_digits;
+  }
+  return p;
+}
 
-  std::string s_trim;
+/// strtod for everything the fast path can't do exactly.  The whole token has to be a number.
+const char* parseDoubleSlow(const char* begin, const char* end, double& value)
+{
+  std::string token(begin, end);
+  char* parsed_end = nullptr;
+  value = std::strtod(token.c_str(), &parsed_end);
+  if (parsed_end != token.c_str() + token.size() || token.empty())
+    return nullptr;
 
-  // If it starts or ends with whitespace, trim it
-  if (*start == ' ' || *end == ' ')
+  return end;
+}
+
+}  // namespace
+
+const char* parseDouble(const char* begin, const char* end, double& value)
+{
+  const char* p = begin;
+  bool negative = false;
+  if (p != end && (*p == '-' || *p == '+'))
   {
-    s_trim = boost::trim_copy(s);
-    start = s_trim.begin();
-    end = s_trim.end();
+    negative = *p == '-';
+    ++p;
   }
 
-  bool r;
+  std::uint64_t mantissa = 0;
+  int num_digits = 0;
+  int exponent = 0;
+
+  p = scanDigits(p, end, mantissa, num_digits);
+  if (p != end && *p == '.')
+  {
+    const char* frac_begin = p + 1;
+    p = scanDigits(frac_begin, end, mantissa, num_digits);
+    exponent = -static_cast<int>(p - frac_begin);
+  }
+
+  if (num_digits == 0)
+  {
+    // nan, inf or not a number at all
+    const char* token_end = begin;
+    while (token_end != end && !isNumberSeparator(*token_end))
+      ++token_end;
+    return parseDoubleSlow(begin, token_end, value);
+  }
+
+  if (p != end && (*p == 'e' || *p == 'E'))
+  {
+    const char* e = p + 1;
+    bool exp_negative = false;
+    if (e != end && (*e == '-' || *e == '+'))
+    {
+      exp_negative = *e == '-';
+      ++e;
+    }
+
+    // "1e" isn't an exponent.  The number ends before the 'e', like qi.
+    if (e != end && isDigit(*e))
+    {
+      int exp_value = 0;
+      for (; e != end && isDigit(*e); ++e)
+      {
+        if (exp_value < 100000)
+          exp_value = exp_value * 10 + (*e - '0');
+      }
+      exponent += exp_negative ? -exp_value : exp_value;
+      p = e;
+    }
+  }
+
+  // Digits past the 19th were dropped.  Let strtod round them.
+  if (num_digits > kMaxMantissaDigits)
+    return parseDoubleSlow(begin, p, value);
+
+  // Both the mantissa and the power of 10 are exact doubles, so 1 multiply or divide rounds correctly
+  if (mantissa == 0)
+  {
+    value = 0.0;
+  }
+  else if (mantissa <= (std::uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+  {
+    value = static_cast<double>(mantissa);
+    value = exponent < 0 ? value / kExactPow10[-exponent] : value * kExactPow10[exponent];
+  }
+  else
+  {
+    return parseDoubleSlow(begin, p, value);
+  }
+
+  if (negative)
+    value = -value;
+  return p;
+}
+
+std::vector<double> stringToDoubleVec(const std::string& s)
+{
+  std::vector<double> doubleVec;
 
-  r = qi::parse(start, end, (double_ % ' '), doubleVec);
+  // Keeps the numbers before anything that isn't one, like the old qi parser did
+  parseDoubles(s, doubleVec);
 
   return doubleVec;
 }
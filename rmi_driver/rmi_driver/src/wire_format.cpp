@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2017, Doug Smith, KEBA Corp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Doug Smith
+ */
+
+#include "rmi_driver/wire_format.h"
+
+#include <boost/algorithm/string.hpp>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace rmi_driver
+{
+namespace wire
+{
+namespace
+{
+bool getU8(const std::string& data, std::size_t& pos, std::uint8_t& val)
+{
+  if (pos + 1 > data.size())
+    return false;
+  val = static_cast<std::uint8_t>(data[pos++]);
+  return true;
+}
+
+bool getU16(const std::string& data, std::size_t& pos, std::uint16_t& val)
+{
+  if (pos + 2 > data.size())
+    return false;
+  val = static_cast<std::uint16_t>(static_cast<std::uint8_t>(data[pos]) |
+                                   (static_cast<std::uint8_t>(data[pos + 1]) << 8));
+  pos += 2;
+  return true;
+}
+
+float getFloat(const std::string& data, std::size_t pos)
+{
+  std::uint32_t bits = 0;
+  for (int i = 0; i < 4; ++i)
+    bits |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[pos + i])) << (8 * i);
+
+  float val;
+  std::memcpy(&val, &bits, sizeof(val));
+  return val;
+}
+}  // namespace
+
+bool parseFormat(const std::string& str, Format& format)
+{
+  if (boost::iequals(str, "text"))
+    format = Format::Text;
+  else if (boost::iequals(str, "binary"))
+    format = Format::Binary;
+  else
+    return false;
+
+  return true;
+}
+
+std::size_t beginFrame(std::string& out, PayloadKind kind)
+{
+  std::size_t offset = out.size();
+  out.append(kHeaderSize, '\0');
+  putU8(out, static_cast<std::uint8_t>(kind));
+  return offset;
+}
+
+void endFrame(std::string& out, std::size_t offset)
+{
+  std::uint32_t len = static_cast<std::uint32_t>(out.size() - offset - kHeaderSize);
+  for (std::size_t i = 0; i < kHeaderSize; ++i)
+    out[offset + i] = static_cast<char>((len >> (8 * i)) & 0xff);
+}
+
+void appendTextFrame(std::string& out, const std::string& text)
+{
+  std::size_t offset = beginFrame(out, PayloadKind::Text);
+  out += text;
+  endFrame(out, offset);
+}
+
+void putU8(std::string& out, std::uint8_t val)
+{
+  out += static_cast<char>(val);
+}
+
+void putU16(std::string& out, std::uint16_t val)
+{
+  out += static_cast<char>(val & 0xff);
+  out += static_cast<char>((val >> 8) & 0xff);
+}
+
+bool takeFrame(boost::asio::streambuf& buff, std::size_t size, std::string& payload)
+{
+  payload.clear();
+  if (size < kHeaderSize)
+  {
+    buff.consume(size);
+    return false;
+  }
+
+  auto begin = boost::asio::buffers_begin(buff.data());
+
+  std::uint32_t len = 0;
+  for (std::size_t i = 0; i < kHeaderSize; ++i)
+    len |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(begin[i])) << (8 * i);
+
+  bool ok = (len == size - kHeaderSize);
+  if (ok)
+    payload.assign(begin + kHeaderSize, begin + size);
+
+  buff.consume(size);
+  return ok;
+}
+
+bool decodeFloats(const std::string& payload, FloatGroups& groups)
+{
+  std::size_t pos = 0;
+  std::uint8_t kind, num_groups;
+  if (!getU8(payload, pos, kind) || kind != static_cast<std::uint8_t>(PayloadKind::Floats))
+    return false;
+  if (!getU8(payload, pos, num_groups))
+    return false;
+
+  groups.resize(num_groups);
+  for (auto&& group : groups)
+  {
+    std::uint16_t count;
+    if (!getU16(payload, pos, count) || pos + count * 4u > payload.size())
+      return false;
+
+    group.resize(count);
+    for (auto&& val : group)
+    {
+      val = getFloat(payload, pos);
+      pos += 4;
+    }
+  }
+
+  return pos == payload.size();
+}
+
+void payloadToText(std::string& payload)
+{
+  if (payloadKind(payload) != PayloadKind::Floats)
+  {
+    if (!payload.empty())
+      payload.erase(0, 1);
+    return;
+  }
+
+  FloatGroups groups;
+  if (!decodeFloats(payload, groups))
+  {
+    payload = "error: invalid binary response";
+    return;
+  }
+
+  std::ostringstream oss;
+  oss << std::setprecision(std::numeric_limits<float>::max_digits10);
+  for (auto&& group : groups)
+  {
+    for (std::size_t i = 0; i < group.size(); ++i)
+      oss << (i ? " " : "") << group[i];
+    oss << ';';
+  }
+  payload = oss.str();
+}
+
+}  // namespace wire
+}  // namespace rmi_driver
@@ -30,13 +30,29 @@
 #include <gtest/gtest.h>
 #include <ros/ros.h>
 
+#include <array>
+#include <boost/algorithm/string.hpp>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
 #include <memory>
+#include <random>
 
+#include <rmi_driver/command_list_converter.h>
 #include <rmi_driver/commands.h>
 #include <rmi_driver/connector.h>
 #include <rmi_driver/driver.h>
+#include <rmi_driver/fixed_vector.h>
+#include <rmi_driver/latency_stats.h>
 #include <rmi_driver/rotation_utils.h>
+#include <rmi_driver/spsc_ring.h>
+#include <rmi_driver/state_snapshot.h>
+#include <rmi_driver/trajectory_decimation.h>
+#include <rmi_driver/util.h>
+#include <rmi_driver/wire_format.h>
 
 using namespace rmi_driver;
 
@@ -185,6 +201,14 @@ TEST(TestSuite, load_config)
 
   test_data_.config_loaded_ = test_data_.config_.loadConfig(nh);
   EXPECT_TRUE(test_data_.config_loaded_);
+
+  // Per item Get rates
+  ASSERT_EQ(test_data_.config_.connections_.size(), 2);
+  auto& rates = test_data_.config_.connections_[1].get_rates_;
+  ASSERT_EQ(rates.size(), 2);
+  EXPECT_DOUBLE_EQ(rates["JOINT_POSITION"], 0);
+  EXPECT_DOUBLE_EQ(rates["TOOL_FRAME"], 10);
+  EXPECT_TRUE(test_data_.config_.connections_[0].get_rates_.empty());
 }
 
 TEST(TestSuite, load_plugin)
@@ -350,6 +374,813 @@ TEST(TestSuite, rotations)
 
   quat = setQuat(1, 0, 0, 0);
   EXPECT_TRUE(testQuat(quat, quat_to_comp, 0.0001));
+
+  // zyzToZyx matches the tf2 matrix version, gimbal lock included
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<double> angle(-M_PI, M_PI);
+  std::vector<std::array<double, 3>> zyz{ { 0, M_PI / 2, 0 }, { 0.3, -M_PI / 2, M_PI }, { 0, 0, 0 }, { 1, M_PI, -1 } };
+  for (int i = 0; i < 1000; ++i)
+    zyz.push_back({ angle(gen), angle(gen), angle(gen) });
+
+  for (const auto& a : zyz)
+  {
+    double yaw, pitch, roll;
+    double tf_yaw, tf_pitch, tf_roll;
+    RotationUtils::zyzToZyx(a[0], a[1], a[2], yaw, pitch, roll);
+    RotationUtils::rotZYZ(a[0], a[1], a[2]).getEulerYPR(tf_yaw, tf_pitch, tf_roll);
+    EXPECT_NEAR(tf_yaw, yaw, 1e-9);
+    EXPECT_NEAR(tf_pitch, pitch, 1e-9);
+    EXPECT_NEAR(tf_roll, roll, 1e-9);
+  }
+}
+
+TEST(TestSuite, spsc_ring)
+{
+  SpscRing<int> ring(3);
+  int val = -1;
+  EXPECT_EQ(4, ring.capacity());
+  EXPECT_FALSE(ring.front(val));
+  EXPECT_FALSE(ring.pop());
+
+  for (int i = 0; i < 4; i++)
+    EXPECT_TRUE(ring.push(i));
+  EXPECT_FALSE(ring.push(4));
+  EXPECT_EQ(4, ring.size());
+  EXPECT_EQ(4, ring.highWater());
+
+  ASSERT_TRUE(ring.front(val));
+  EXPECT_EQ(0, val);
+  EXPECT_TRUE(ring.pop());
+  EXPECT_FALSE(ring.popIf(0));
+  ASSERT_TRUE(ring.front(val));
+  EXPECT_EQ(1, val);
+
+  // Entries pushed after a clear survive it
+  auto epoch = ring.clearEpoch();
+  EXPECT_EQ(3, ring.clear());
+  EXPECT_NE(epoch, ring.clearEpoch());
+  EXPECT_TRUE(ring.empty());
+  EXPECT_TRUE(ring.push(10));
+  EXPECT_EQ(1, ring.size());
+  ASSERT_TRUE(ring.front(val));
+  EXPECT_EQ(10, val);
+  EXPECT_TRUE(ring.popIf(10));
+  EXPECT_FALSE(ring.pop(val));
+  EXPECT_EQ(4, ring.freeSpace());
+  EXPECT_EQ(4, ring.highWater());
+
+  // Clear then refill at capacity without the consumer running in between
+  for (int i = 0; i < 4; i++)
+    EXPECT_TRUE(ring.push(i));
+  ASSERT_TRUE(ring.front(val));
+  EXPECT_EQ(0, ring.freeSpace());
+  EXPECT_EQ(4, ring.clear());
+  EXPECT_EQ(4, ring.freeSpace());
+  for (int i = 20; i < 24; i++)
+    EXPECT_TRUE(ring.push(i));
+  EXPECT_FALSE(ring.push(24));
+  EXPECT_FALSE(ring.popIf(val));
+  for (int i = 20; i < 24; i++)
+  {
+    ASSERT_TRUE(ring.pop(val));
+    EXPECT_EQ(i, val);
+  }
+  EXPECT_TRUE(ring.empty());
+
+  // Order is kept across threads
+  SpscRing<int> shared_ring(64);
+  const int count = 100000;
+  std::thread producer([&]() {
+    for (int i = 0; i < count; i++)
+      while (!shared_ring.push(i))
+        std::this_thread::yield();
+  });
+
+  int expected = 0;
+  while (expected < count)
+  {
+    if (!shared_ring.front(val))
+      continue;
+    ASSERT_EQ(expected, val);
+    shared_ring.pop();
+    expected++;
+  }
+  producer.join();
+
+  // The producer refills cleared slots while the consumer is reading.  What's left is still in order.
+  SpscRing<int> cleared_ring(16);
+  std::atomic<bool> done{ false };
+  std::thread clearing_producer([&]() {
+    for (int i = 1; i <= count; i++)
+    {
+      if (i % 50 == 0)
+        cleared_ring.clear();
+      while (!cleared_ring.push(i))
+        std::this_thread::yield();
+    }
+    done = true;
+  });
+
+  int last = 0;
+  while (!done || !cleared_ring.empty())
+  {
+    if (!cleared_ring.pop(val))
+      continue;
+    ASSERT_LT(last, val);
+    last = val;
+  }
+  clearing_producer.join();
+  EXPECT_EQ(count, last);
+}
+
+TEST(TestSuite, state_snapshot)
+{
+  std::vector<double> joints{ 1, 2, 3, 4, 5, 6, 7 };
+  RobotStateSample sample;
+  ASSERT_TRUE(sample.setPositions(joints));
+  ASSERT_EQ(7, sample.num_positions);
+  ASSERT_EQ(7, sample.position[6]);
+
+  joints.resize(RobotStateSample::kMaxJoints + 1);
+  ASSERT_FALSE(sample.setPositions(joints));
+  ASSERT_EQ(RobotStateSample::kMaxJoints, sample.num_positions);
+
+  SeqLock<RobotStateSample> snapshot;
+  ASSERT_EQ(0, snapshot.count());
+  ASSERT_EQ(0, snapshot.load().num_positions);
+
+  // Every field of a stored sample is set to the same value, so a torn read would show up as a mismatch
+  const uint32_t count = 100000;
+  std::thread writer([&]() {
+    RobotStateSample sample;
+    for (uint32_t i = 1; i <= count; i++)
+    {
+      sample.stamp_sec = sample.stamp_nsec = sample.num_positions = i;
+      std::fill(std::begin(sample.position), std::end(sample.position), i);
+      std::fill(std::begin(sample.tool_frame), std::end(sample.tool_frame), i);
+      snapshot.store(sample);
+    }
+  });
+
+  uint32_t last = 0;
+  while (last < count)
+  {
+    RobotStateSample read = snapshot.load();
+    ASSERT_GE(read.stamp_sec, last);
+    ASSERT_EQ(read.stamp_sec, read.stamp_nsec);
+    ASSERT_EQ(read.stamp_sec, read.num_positions);
+    for (double val : read.position)
+      ASSERT_EQ(read.stamp_sec, val);
+    for (double val : read.tool_frame)
+      ASSERT_EQ(read.stamp_sec, val);
+    last = read.stamp_sec;
+  }
+  writer.join();
+  ASSERT_EQ(count, snapshot.count());
+}
+
+/// Changes the format by overriding toString(bool)
+class PrefixedCommand : public RobotCommand
+{
+public:
+  using RobotCommand::RobotCommand;
+
+  std::string toString(bool append_newline = true) const override
+  {
+    return "x_" + RobotCommand::toString(append_newline);
+  }
+};
+
+TEST(TestSuite, wire_format)
+{
+  wire::Format format;
+  ASSERT_TRUE(wire::parseFormat("Binary", format));
+  ASSERT_EQ(wire::Format::Binary, format);
+  ASSERT_FALSE(wire::parseFormat("json", format));
+
+  // Numeric params are encoded as a Command payload
+  RobotCommand cmd(RobotCommand::CommandType::Cmd, "ptp joints", std::vector<float>{ 1, 2.5, -3 });
+  cmd.addParam("dyn", std::vector<float>{ 100 });
+  ASSERT_EQ("ptp joints : 1 2.5 -3;dyn : 100;\n", cmd.toString());
+
+  // The text is kept until the command changes, and the text format writes it as is
+  const std::string& text = cmd.getText();
+  ASSERT_EQ(cmd.toString(), text);
+  std::string scratch;
+  ASSERT_EQ(&text, &cmd.wireData(scratch, wire::Format::Text));
+  ASSERT_EQ(&text, &cmd.getText());
+  std::ostringstream oss;
+  oss << cmd;
+  ASSERT_EQ(cmd.toString(false), oss.str());
+  RobotCommand copy(cmd);
+  copy.addParam("velros", std::vector<float>{ 50 });
+  ASSERT_EQ("ptp joints : 1 2.5 -3;dyn : 100;velros : 50;\n", copy.getText());
+  ASSERT_EQ("ptp joints : 1 2.5 -3;dyn : 100;\n", cmd.getText());
+
+  // An overridden toString is what gets sent
+  PrefixedCommand prefixed(RobotCommand::CommandType::Cmd, "ptp joints", std::vector<float>{ 1 });
+  ASSERT_EQ("x_ptp joints : 1;\n", prefixed.getText());
+  ASSERT_EQ("x_ptp joints : 1;\n", prefixed.wireData(scratch, wire::Format::Text));
+
+  std::string out;
+  cmd.toWire(out, wire::Format::Binary);
+  ASSERT_EQ(4 + 1 + 1 + (1 + 10 + 2 + 12) + (1 + 3 + 2 + 4), out.size());
+  ASSERT_EQ(out.size() - 4, static_cast<uint8_t>(out[0]));
+  ASSERT_EQ(static_cast<char>(wire::PayloadKind::Command), out[4]);
+
+  // A text param can't be encoded, so it's sent as text in a frame
+  cmd.addParam("aux1", "5");
+  cmd.toWire(out, wire::Format::Binary);
+  ASSERT_EQ(static_cast<char>(wire::PayloadKind::Text), out[4]);
+  ASSERT_EQ(cmd.toString(false), out.substr(5));
+
+  // Floats response split across 2 reads
+  std::string frame;
+  std::size_t offset = wire::beginFrame(frame, wire::PayloadKind::Floats);
+  wire::putU8(frame, 2);
+  wire::putFloatGroup(frame, std::vector<double>{ 0.5, -1.25 });
+  wire::putFloatGroup(frame, std::vector<double>{});
+  wire::endFrame(frame, offset);
+
+  wire::FrameMatcher matcher;
+  ASSERT_FALSE(matcher(frame.begin(), frame.end() - 1).second);
+  auto match = matcher(frame.begin(), frame.end());
+  ASSERT_TRUE(match.second);
+  ASSERT_TRUE(match.first == frame.end());
+
+  boost::asio::streambuf buff;
+  std::ostream os(&buff);
+  os << frame << "next";
+  ASSERT_EQ(frame.size(), SocketChannel::bufferedSize(buff, wire::Format::Binary));
+  std::string payload;
+  ASSERT_TRUE(wire::takeFrame(buff, frame.size(), payload));
+  ASSERT_EQ(4, buff.size());
+
+  // A partial frame, then 2 responses that arrived in 1 read
+  boost::asio::streambuf lines;
+  std::ostream lines_os(&lines);
+  lines_os << frame.substr(0, frame.size() - 1);
+  ASSERT_EQ(0, SocketChannel::bufferedSize(lines, wire::Format::Binary));
+  lines.consume(lines.size());
+  lines_os << "done\nerror 2\npartial";
+  ASSERT_EQ(5, SocketChannel::bufferedSize(lines, wire::Format::Text));
+  lines.consume(5);
+  ASSERT_EQ(8, SocketChannel::bufferedSize(lines, wire::Format::Text));
+  lines.consume(8);
+  ASSERT_EQ(0, SocketChannel::bufferedSize(lines, wire::Format::Text));
+
+  wire::FloatGroups groups;
+  ASSERT_TRUE(wire::decodeFloats(payload, groups));
+  ASSERT_EQ(2, groups.size());
+  ASSERT_EQ(std::vector<double>({ 0.5, -1.25 }), groups[0]);
+  ASSERT_TRUE(groups[1].empty());
+
+  wire::payloadToText(payload);
+  ASSERT_EQ("0.5 -1.25;;", payload);
+
+  ASSERT_FALSE(wire::decodeFloats(frame.substr(4, frame.size() - 5), groups));
+}
+
+/// floatToStringNoTrailing() before it was rewritten.  The fast version has to produce the same text.
+std::string floatToStringGolden(float fval, int precision)
+{
+  std::ostringstream oss;
+  oss << std::setprecision(precision) << std::fixed;
+  oss << fval;
+  auto str = oss.str();
+  boost::trim_right_if(str, boost::is_any_of("0"));
+  boost::trim_right_if(str, boost::is_any_of("."));
+  return str;
+}
+
+TEST(TestSuite, float_format)
+{
+  std::vector<float> values{ 0.0f,   -0.0f,    0.5f,     1.5f,     2.5f,    -0.5f,    0.00005f, -0.00001f, 100.0f,
+                             1e10f,  -3e38f,   1.17e-38f, 123.456f, 0.1f,    -1.2f,    9.99995f, 1e-45f,
+                             std::numeric_limits<float>::infinity(), std::numeric_limits<float>::quiet_NaN() };
+
+  // Uniform values, random bit patterns to cover every magnitude, and ties like 1.25 at precision 1
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<float> uniform(-2000.0f, 2000.0f);
+  std::uniform_int_distribution<uint32_t> bits;
+  std::uniform_int_distribution<int> ties(-100000, 100000);
+  for (int i = 0; i < 5000; ++i)
+  {
+    values.push_back(uniform(gen));
+
+    uint32_t pattern = bits(gen);
+    float f;
+    std::memcpy(&f, &pattern, sizeof(f));
+    values.push_back(f);
+
+    values.push_back((ties(gen) + 0.5f) / 8.0f);
+  }
+
+  std::string out;
+  for (int precision : { 0, 1, 2, 3, 4, 6, 8, 12, 13 })
+  {
+    for (float f : values)
+    {
+      std::string expected = floatToStringGolden(f, precision);
+      ASSERT_EQ(expected, util::floatToStringNoTrailing(f, precision)) << "precision " << precision;
+
+      out.assign("x");
+      util::appendFloatNoTrailing(out, f, precision);
+      ASSERT_EQ("x" + expected, out);
+    }
+  }
+
+  // Doubles are formatted as floats
+  std::vector<double> vec{ 0.1, -1.23456, 100.0, 0.00004 };
+  ASSERT_EQ("0.1 -1.2346 100 0", util::vecToString(vec, 4));
+  out = "ptp : ";
+  util::appendVecToString(out, vec, 2);
+  ASSERT_EQ("ptp : 0.1 -1.23 100 0", out);
+  ASSERT_EQ("", util::vecToString(std::vector<float>(), 4));
+}
+
+TEST(TestSuite, parse_doubles)
+{
+  // Every double strtod can read back, in the formats a controller might send
+  std::mt19937_64 gen(1234);
+  std::uniform_real_distribution<double> uniform(-5000.0, 5000.0);
+  const char* formats[] = { "%.0f", "%.4f", "%.6f", "%.17g", "%g", "%e", "%.25f" };
+  char buf[128];
+  for (int i = 0; i < 20000; ++i)
+  {
+    double d = uniform(gen);
+    if (i % 2)
+    {
+      uint64_t pattern = gen();
+      std::memcpy(&d, &pattern, sizeof(d));
+      if (!std::isfinite(d) || std::fabs(d) > 1e30)
+        continue;
+    }
+
+    int len = std::snprintf(buf, sizeof(buf), formats[i % 7], d);
+    double parsed;
+    ASSERT_EQ(buf + len, util::parseDouble(buf, buf + len, parsed)) << buf;
+    double expected = std::strtod(buf, nullptr);
+    ASSERT_EQ(0, std::memcmp(&expected, &parsed, sizeof(double))) << buf;
+  }
+
+  util::FixedVector<double, 4> vals;
+  ASSERT_TRUE(util::parseDoubles(std::string(" 1 -2.5\t.25  1e3 \r\n"), vals));
+  ASSERT_EQ(4, vals.size());
+  ASSERT_EQ(1.0, vals[0]);
+  ASSERT_EQ(-2.5, vals[1]);
+  ASSERT_EQ(0.25, vals[2]);
+  ASSERT_EQ(1000.0, vals[3]);
+
+  ASSERT_TRUE(util::parseDoubles(std::string(""), vals));
+  ASSERT_TRUE(vals.empty());
+  ASSERT_TRUE(util::parseDoubles(std::string("nan -inf"), vals));
+  ASSERT_TRUE(std::isnan(vals[0]));
+  ASSERT_TRUE(std::isinf(vals[1]));
+
+  // Garbage, a dangling exponent and more values than fit
+  ASSERT_FALSE(util::parseDoubles(std::string("1 2x"), vals));
+  ASSERT_EQ(1, vals.size());
+  ASSERT_FALSE(util::parseDoubles(std::string("1e"), vals));
+  ASSERT_FALSE(util::parseDoubles(std::string("-"), vals));
+  ASSERT_FALSE(util::parseDoubles(std::string("1 2 3 4 5"), vals));
+  ASSERT_EQ(4, vals.size());
+
+  // The input doesn't have to be null terminated
+  std::string digits = "12345678901234567890";
+  ASSERT_TRUE(util::parseDoubles(digits.data(), digits.data() + 9, vals));
+  ASSERT_EQ(123456789.0, vals[0]);
+
+  std::vector<double> expected{ 1, 2, 3.53, 56.563 };
+  ASSERT_EQ(expected, util::stringToDoubleVec(" 1 2 3.53 56.563 "));
+  ASSERT_EQ(std::vector<double>{ 1 }, util::stringToDoubleVec("1 x 3"));
+
+  // A status response is parsed in place into the 3 groups
+  RobotCommandStatus status(RobotCommand::CommandType::Get);
+  ASSERT_TRUE(status.updateData("0.1 -0.2 0.3;1 2 3;10 20 30 1.5 -1.5 0;"));
+  ASSERT_EQ(3, status.getJointPositions().size());
+  ASSERT_EQ(-0.2, status.getJointPositions()[1]);
+  ASSERT_EQ(3.0, status.getJointVelocities()[2]);
+  ASSERT_EQ(6, status.getTcpFrame().size());
+  ASSERT_EQ(-1.5, status.getTcpFrame()[4]);
+  ASSERT_TRUE(status.updateData("1;2;3"));
+  ASSERT_TRUE(status.updateData("1;;3;\n"));
+  ASSERT_TRUE(status.getJointVelocities().empty());
+  ASSERT_FALSE(status.updateData("1;2"));
+  ASSERT_FALSE(status.updateData("1;2;3;4"));
+  ASSERT_FALSE(status.updateData("1;x;3"));
+
+  // The old signature and getters still work
+  std::string response = "0.5 -1;0 0;1 2 3 4 5 6";
+  ASSERT_TRUE(status.updateData(response));
+  ASSERT_EQ("0.5 -1", status.getLastJointState());
+  ASSERT_EQ("0 0", status.getLastJointVel());
+  ASSERT_EQ("1 2 3 4 5 6", status.getLastTcpFrame());
+}
+
+TEST(TestSuite, latency_stats)
+{
+  // Buckets are contiguous and ordered
+  for (unsigned i = 1; i < LatencyHistogram::kNumBuckets; ++i)
+  {
+    uint64_t upper = LatencyHistogram::bucketUpperBound(i - 1);
+    ASSERT_EQ(i - 1, LatencyHistogram::bucketIndex(upper));
+    ASSERT_EQ(i, LatencyHistogram::bucketIndex(upper + 1));
+  }
+  ASSERT_EQ(LatencyHistogram::kNumBuckets - 1, LatencyHistogram::bucketIndex(UINT64_MAX));
+
+  // 1us to 1000us, recorded from 4 threads
+  LatencyHistogram histogram;
+  ASSERT_EQ(0, histogram.percentile(0.5));
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t)
+  {
+    threads.emplace_back([&histogram, t]() {
+      for (uint64_t us = 1 + t; us <= 1000; us += 4)
+        histogram.record(std::chrono::microseconds(us));
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  ASSERT_EQ(1000, histogram.count());
+  ASSERT_EQ(1000000, histogram.max());
+  ASSERT_EQ(1000000, histogram.percentile(1));
+  for (double p : { 0.5, 0.9, 0.99 })
+  {
+    double expected = p * 1000000;
+    ASSERT_GE(histogram.percentile(p), expected);
+    ASSERT_LE(histogram.percentile(p), expected * (1 + 1.0 / LatencyHistogram::kSubBuckets));
+  }
+
+  // Same entry for the same name, and the table fills up into other()
+  LatencyStats stats;
+  CommandLatency& ptp = stats.get("ptp");
+  ASSERT_EQ(&ptp, &stats.get(std::string("ptp")));
+  for (size_t i = 0; i < LatencyStats::kMaxCommands; ++i)
+    stats.get("cmd" + std::to_string(i)).write.record(1);
+  ASSERT_EQ(&stats.other(), &stats.get("one too many"));
+
+  size_t names = 0;
+  stats.forEach([&names](const std::string&, const CommandLatency&) { ++names; });
+  ASSERT_EQ(LatencyStats::kMaxCommands + 1, names);
+}
+
+/// The linear search findHandler used to do, with the matching CommandHandler::operator== used to do
+const CommandHandler* findHandlerLinear(const CommandRegister& reg, const robot_movement_interface::Command& msg)
+{
+  for (auto& handler : reg.handlers())
+  {
+    const auto& sample = handler->getSampleCommand();
+    int idx = 0;
+    if (util::usedAndNotEqual(sample.command_type, msg.command_type) ||
+        util::usedAndNotEqual(sample.pose_reference, msg.pose_reference) ||
+        util::usedAndNotEqual(sample.pose_type, msg.pose_type, &idx) ||
+        util::usedAndNotEqualIdx(idx, sample.pose, msg.pose) ||
+        util::usedAndNotEqual(sample.velocity_type, msg.velocity_type, &idx) ||
+        util::usedAndNotEqualIdx(idx, sample.velocity, msg.velocity) ||
+        util::usedAndNotEqual(sample.blending_type, msg.blending_type, &idx) ||
+        util::usedAndNotEqualIdx(idx, sample.blending, msg.blending))
+      continue;
+    return handler.get();
+  }
+  return nullptr;
+}
+
+TEST(TestSuite, find_handler)
+{
+  // Small alphabets so the random samples and messages overlap a lot.  "" and "|" make empty entries.
+  std::vector<std::string> types{ "", "PTP", "LIN", "GET", "PTP|LIN", "GET|", "|PTP" };
+  std::vector<std::string> pose_types{ "", "JOINTS", "QUATERNION", "JOINTS|QUATERNION", "|JOINTS", "QUATERNION|JOINTS|" };
+  std::vector<std::string> dyn_types{ "", "ROS", "|DYN|ROS" };
+  std::vector<std::string> msg_types{ "", "PTP", "LIN", "GET", "WAIT", "JOINTS", "QUATERNION", "ROS", "DYN" };
+
+  std::mt19937 gen(1234);
+  auto pick = [&gen](const std::vector<std::string>& strs) {
+    return strs[std::uniform_int_distribution<std::size_t>(0, strs.size() - 1)(gen)];
+  };
+  auto sizes = [&gen](std::size_t max_count) {
+    std::vector<float> vals(std::uniform_int_distribution<std::size_t>(0, max_count)(gen));
+    for (auto& val : vals)
+      val = std::uniform_int_distribution<int>(0, 3)(gen);
+    return vals;
+  };
+
+  for (int round = 0; round < 20; ++round)
+  {
+    TestCommandRegister reg;
+    for (int i = 0; i < 12; ++i)
+    {
+      robot_movement_interface::Command sample;
+      sample.command_type = pick(types);
+      sample.pose_type = pick(pose_types);
+      sample.pose = sizes(3);
+      sample.velocity_type = pick(dyn_types);
+      sample.velocity = sizes(2);
+      reg.addHandler(CommandHandler::createHandler(sample, nullptr));
+    }
+
+    for (int i = 0; i < 500; ++i)
+    {
+      robot_movement_interface::Command msg;
+      msg.command_type = pick(msg_types);
+      msg.pose_type = pick(msg_types);
+      msg.pose.resize(std::uniform_int_distribution<int>(0, 3)(gen));
+      msg.velocity_type = pick(msg_types);
+      msg.velocity.resize(std::uniform_int_distribution<int>(0, 3)(gen));
+
+      auto expected = findHandlerLinear(reg, msg);
+      ASSERT_EQ(expected, reg.findHandler(msg));
+
+      // operator== still works on its own
+      if (expected)
+        ASSERT_TRUE(*const_cast<CommandHandler*>(expected) == msg);
+    }
+  }
+}
+
+TEST(TestSuite, command_list_converter)
+{
+  // Makes "ptp <id>", or nothing for pose[0] < 0
+  robot_movement_interface::Command sample;
+  sample.command_type = "PTP";
+  auto handler = CommandHandler::createHandler(sample, [](const robot_movement_interface::Command& msg_cmd) {
+    if (msg_cmd.pose[0] < 0)
+      return RobotCommandPtr();
+    return std::make_shared<RobotCommand>(RobotCommand::CommandType::Cmd, "ptp", std::to_string(msg_cmd.command_id));
+  });
+
+  robot_movement_interface::CommandList list;
+  std::vector<const CommandHandler*> handlers;
+  for (int i = 0; i < 1000; ++i)
+  {
+    robot_movement_interface::Command cmd;
+    cmd.command_id = i;
+    cmd.command_type = "PTP";
+    cmd.pose = { 1 };
+    list.commands.push_back(cmd);
+
+    // Every 10th has no handler and is skipped
+    handlers.push_back(i % 10 == 3 ? nullptr : handler.get());
+  }
+
+  CommandListConverter converter(3, 7);
+  std::vector<int> ids;
+  int chunks = 0;
+  auto collect = [&ids, &chunks](std::vector<RobotCommandPtr>& commands) {
+    ++chunks;
+    for (auto& cmd : commands)
+    {
+      RobotCommand expected(RobotCommand::CommandType::Cmd, "ptp", std::to_string(cmd->getCommandId()));
+      EXPECT_EQ(expected.getText(), cmd->getText());
+      ids.push_back(cmd->getCommandId());
+    }
+    return true;
+  };
+
+  ASSERT_TRUE(converter.convert(list, handlers, collect));
+  EXPECT_EQ(143, chunks);
+  ASSERT_EQ(900u, ids.size());
+  for (size_t i = 1; i < ids.size(); ++i)
+    ASSERT_LT(ids[i - 1], ids[i]);
+
+  // A null command fails the list.  The chunks before it are delivered, nothing after it.
+  list.commands[500].pose[0] = -1;
+  ids.clear();
+  chunks = 0;
+  size_t failed_index = 0;
+  ASSERT_FALSE(converter.convert(list, handlers, collect, &failed_index));
+  EXPECT_EQ(500 / 7, chunks);
+  EXPECT_LT(ids.back(), 500);
+  EXPECT_EQ(500u, failed_index);
+
+  // So does the callback, but no message failed
+  list.commands[500].pose[0] = 1;
+  chunks = 0;
+  ASSERT_FALSE(converter.convert(
+      list, handlers, [&chunks](std::vector<RobotCommandPtr>&) { return ++chunks < 5; }, &failed_index));
+  EXPECT_EQ(5, chunks);
+  EXPECT_EQ(list.commands.size(), failed_index);
+
+  // Empty lists are fine
+  ASSERT_TRUE(converter.convert(robot_movement_interface::CommandList(), {}, collect));
+}
+
+TEST(TestSuite, robot_command)
+{
+  RobotCommand cmd(RobotCommand::CommandType::Cmd, "ptp joints", std::vector<float>{ 1, 2.5, 3 });
+  cmd.addParam("velros", std::vector<float>{ 50 });
+  cmd.addParam("aux1", "5");
+  ASSERT_EQ("ptp joints : 1 2.5 3;velros : 50;aux1 : 5;\n", cmd.toString());
+
+  // Replacing the command keeps the params
+  cmd.setCommand("lin joints", std::vector<float>{ 4 });
+  ASSERT_EQ("lin joints : 4;velros : 50;aux1 : 5;", cmd.toString(false));
+  ASSERT_EQ("lin joints", cmd.getCommand());
+
+  auto full_command = cmd.getFullCommand();
+  ASSERT_EQ(3u, full_command.size());
+  ASSERT_EQ(RobotCommand::CommandEntry("velros", "50"), full_command[1]);
+
+  // Copies share the names, not the values
+  RobotCommand copy(cmd);
+  copy.makeCommand(RobotCommand::CommandType::Get, "abort", "", true);
+  ASSERT_EQ("abort;", copy.toString(false));
+  ASSERT_EQ("lin joints : 4;velros : 50;aux1 : 5;", cmd.toString(false));
+  ASSERT_EQ(&cmd.getCommand(), &RobotCommand(RobotCommand::CommandType::Cmd, "lin joints").getCommand());
+
+  // A param without a command
+  RobotCommand no_command;
+  no_command.makeCommand(RobotCommand::CommandType::Cmd, "", "", true);
+  no_command.addParam("speed", "100");
+  ASSERT_EQ(";speed : 100;", no_command.toString(false));
+
+  // Names from messages can't grow the interned names forever.  The ones that don't fit are kept by the command.
+  std::unique_ptr<RobotCommand> many_names(new RobotCommand(RobotCommand::CommandType::Cmd, "ptp joints"));
+  for (int i = 0; i < 2000; ++i)
+    many_names->addParam("name_" + std::to_string(i), "");
+  RobotCommand many_copy(*many_names);
+  many_names.reset();
+  std::string many_text = many_copy.toString(false);
+  ASSERT_EQ(0u, many_text.find("ptp joints;name_0;"));
+  ASSERT_NE(std::string::npos, many_text.find(";name_1999;"));
+
+  // Subclasses that edited full_command_ can write the entries back
+  struct EditedCommand : public RobotCommand
+  {
+    EditedCommand() : RobotCommand(RobotCommand::CommandType::Cmd, "ptp joints", std::vector<float>{ 1, 2 })
+    {
+      auto entries = getFullCommand();
+      entries[0].second = "3 4";
+      entries.emplace_back("speed", "10");
+      setFullCommand(entries);
+    }
+  };
+  ASSERT_EQ("ptp joints : 3 4;speed : 10;", EditedCommand().toString(false));
+
+  // A freed command's memory is reused by the next one
+  auto pooled = makeRobotCommand<RobotCommand>(RobotCommand::CommandType::Cmd, "wait");
+  const void* address = pooled.get();
+  pooled.reset();
+  pooled = makeRobotCommand<RobotCommand>(RobotCommand::CommandType::Cmd, "wait");
+  ASSERT_EQ(address, pooled.get());
+  ASSERT_EQ("wait;\n", pooled->getText());
+}
+
+TEST(TestSuite, jta_mapping)
+{
+  // Adds a wait after the last point, like a plugin would
+  class WaitJtaHandler : public JtaCommandHandler
+  {
+  public:
+    void processLastJtaPoint(const trajectory_msgs::JointTrajectoryPoint& point,
+                             robot_movement_interface::CommandList& cmd_list) override
+    {
+      JtaCommandHandler::processJtaPoint(point, cmd_list);
+      robot_movement_interface::Command cmd;
+      cmd.command_id = getNextCommandId(cmd_list);
+      cmd.command_type = "WAIT";
+      cmd_list.commands.push_back(cmd);
+    }
+
+    bool usesPointHooks() const override
+    {
+      return true;
+    }
+  } handler;
+
+  // Joint n of the driver is at mapping[n] in the goal
+  const std::vector<size_t> mapping{ 2, 0, 3, 1 };
+
+  for (size_t num_points : { 0, 1, 2, 5 })
+  {
+    trajectory_msgs::JointTrajectory traj;
+    trajectory_msgs::JointTrajectory sorted;
+    for (size_t i = 0; i < num_points; ++i)
+    {
+      trajectory_msgs::JointTrajectoryPoint point;
+      for (size_t j = 0; j < mapping.size(); ++j)
+      {
+        point.positions.push_back(i * 10 + j);
+        point.velocities.push_back(i * 10 + j + 0.5);
+      }
+      traj.points.push_back(point);
+
+      point.positions = util::sortVectorByIndices<double>(mapping, point.positions);
+      point.velocities = util::sortVectorByIndices<double>(mapping, point.velocities);
+      sorted.points.push_back(point);
+    }
+
+    auto expected = handler.processJta(sorted);
+    auto cmd_list = handler.processJta(traj, mapping);
+    ASSERT_EQ(expected.commands.size(), cmd_list.commands.size());
+    for (size_t i = 0; i < cmd_list.commands.size(); ++i)
+    {
+      const auto& exp = expected.commands[i];
+      const auto& cmd = cmd_list.commands[i];
+      ASSERT_EQ(exp.command_id, cmd.command_id);
+      ASSERT_EQ(exp.command_type, cmd.command_type);
+      ASSERT_EQ(exp.pose, cmd.pose);
+      ASSERT_EQ(exp.velocity_type, cmd.velocity_type);
+      ASSERT_EQ(exp.velocity, cmd.velocity);
+    }
+
+    // A single point is only the first point
+    if (num_points > 1)
+      ASSERT_EQ("WAIT", cmd_list.commands.back().command_type);
+    if (num_points > 0)
+    {
+      ASSERT_EQ(std::vector<float>({ 2, 0, 3, 1 }), cmd_list.commands.front().pose);
+      ASSERT_TRUE(cmd_list.commands.front().acceleration.empty());
+    }
+  }
+
+  // A point with the wrong number of values
+  trajectory_msgs::JointTrajectory bad;
+  bad.points.resize(3);
+  for (auto& point : bad.points)
+    point.positions = { 1, 2, 3, 4 };
+  bad.points[1].velocities = { 1, 2 };
+  ASSERT_THROW(handler.processJta(bad, mapping), std::runtime_error);
+
+  // A handler that makes the whole list itself still gets the goal, sorted
+  class WholeJtaHandler : public JtaCommandHandler
+  {
+  public:
+    robot_movement_interface::CommandList processJta(const trajectory_msgs::JointTrajectory& joint_trajectory) override
+    {
+      robot_movement_interface::CommandList cmd_list;
+      cmd_list.commands.resize(1);
+      cmd_list.commands[0].command_type = "SPLINE";
+      for (auto&& point : joint_trajectory.points)
+        cmd_list.commands[0].pose.insert(cmd_list.commands[0].pose.end(), point.positions.begin(),
+                                         point.positions.end());
+      return cmd_list;
+    }
+    using JtaCommandHandler::processJta;
+  } whole_handler;
+
+  trajectory_msgs::JointTrajectory goal;
+  goal.joint_names = { "c", "a", "d", "b" };
+  goal.points.resize(2);
+  goal.points[0].positions = { 0, 1, 2, 3 };
+  goal.points[1].positions = { 10, 11, 12, 13 };
+  auto whole_list = whole_handler.processJta(goal, mapping);
+  ASSERT_EQ(1u, whole_list.commands.size());
+  ASSERT_EQ("SPLINE", whole_list.commands[0].command_type);
+  ASSERT_EQ(std::vector<float>({ 2, 0, 3, 1, 12, 10, 13, 11 }), whole_list.commands[0].pose);
+  ASSERT_THROW(whole_handler.processJta(bad, mapping), std::runtime_error);
+}
+
+TEST(TestSuite, decimate_trajectory)
+{
+  // 2 joints, 1 point per 10ms.  Joint 0 is a ramp with a corner at t=0.5s, joint 1 a slow sine with some noise.
+  std::vector<trajectory_msgs::JointTrajectoryPoint> points(101);
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> noise(-0.0005, 0.0005);
+  for (size_t i = 0; i < points.size(); ++i)
+  {
+    double t = i * 0.01;
+    points[i].time_from_start = ros::Duration(t);
+    points[i].positions = { t < 0.5 ? t : 1.0 - t, 0.1 * std::sin(t * 3) + noise(gen) };
+  }
+
+  const std::vector<double> tolerances{ 0.001, 0.01 };
+  std::vector<size_t> keep;
+  ASSERT_TRUE(decimateTrajectory(points, tolerances, keep));
+  ASSERT_LT(keep.size(), 20u);
+  ASSERT_EQ(0u, keep.front());
+  ASSERT_EQ(100u, keep.back());
+  ASSERT_NE(keep.end(), std::find(keep.begin(), keep.end(), 50u));
+
+  // Every point that was dropped is within the tolerance of the line between the points kept around it
+  for (size_t k = 1; k < keep.size(); ++k)
+  {
+    const auto& p0 = points[keep[k - 1]];
+    const auto& p1 = points[keep[k]];
+    for (size_t i = keep[k - 1] + 1; i < keep[k]; ++i)
+    {
+      double s = (points[i].time_from_start.toSec() - p0.time_from_start.toSec()) /
+                 (p1.time_from_start.toSec() - p0.time_from_start.toSec());
+      for (size_t j = 0; j < tolerances.size(); ++j)
+        ASSERT_LE(std::fabs(points[i].positions[j] - (p0.positions[j] + s * (p1.positions[j] - p0.positions[j]))),
+                  tolerances[j]);
+    }
+  }
+
+  // A tolerance of 0 keeps everything that isn't on the line
+  ASSERT_TRUE(decimateTrajectory(points, { 0.001, 0 }, keep));
+  ASSERT_EQ(points.size(), keep.size());
+
+  // Short trajectories and bad points keep everything
+  std::vector<trajectory_msgs::JointTrajectoryPoint> two(points.begin(), points.begin() + 2);
+  ASSERT_TRUE(decimateTrajectory(two, tolerances, keep));
+  ASSERT_EQ(2u, keep.size());
+
+  points[7].positions.pop_back();
+  ASSERT_FALSE(decimateTrajectory(points, tolerances, keep));
+  ASSERT_EQ(points.size(), keep.size());
 }
 
 TEST(TestSuite, DISABLED_test2)